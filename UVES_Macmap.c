@@ -19,22 +19,27 @@ int UVES_Macmap(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
 
   /* Loop over science exposures */
   for (i=0; i<nscis; i++) {
+    /* Only objects with science exposures ready for output are written */
+    if (scis[i].hdr.emit!=EMIT_READY) continue;
+
     /* See if this is the first time this object has been encountered */
     first=1;
-    j=0; while (first && j<i)
-      if (!strcmp(scis[j++].hdr.obj,scis[i].hdr.obj)) first=0;
+    for (j=0; first && j<i; j++)
+      if (scis[j].hdr.emit==EMIT_READY &&
+	  !strcmp(scis[j].hdr.obj,scis[i].hdr.obj)) first=0;
 
     /* Is this the first time this object has been encountered */
     if (first) {
       /* Define Macmap file name and open it for writing */
       sprintf(listfile,"%s.macmap",scis[i].hdr.obj);
-      if ((list_file=faskwopen("Macmap file for new object?",listfile,4))==NULL)
-	errormsg("UVES_Macmap(): Cannot open Macmap file for\n\
-\tobject %s for writing",scis[i].hdr.obj);
+      if ((list_file=faskwopen("Macmap file for new object?",listfile,4))==NULL) {
+	nferrormsg("UVES_Macmap(): Cannot open Macmap file for\n\
+\tobject %s for writing",scis[i].hdr.obj); return 0;
+      }
 
-      /* Loop over all science exposures of this object */
-      for (j=i; j<nscis; j++) {
-	if (!strcmp(scis[i].hdr.obj,scis[j].hdr.obj))
+      /* Loop over all science exposures of this object written so far */
+      for (j=0; j<nscis; j++) {
+	if (scis[j].hdr.emit!=EMIT_PEND && !strcmp(scis[i].hdr.obj,scis[j].hdr.obj))
 	  fprintf(list_file,"%-20s %3s %02d  %-20s %3s %02d\n",
 		  scis[j].hdr.obj_31,scis[j].hdr.cwl,scis[j].sciind_31,
 		  scis[j].hdr.obj,scis[j].hdr.cwl,scis[j].sciind);
@@ -1,16 +1,22 @@
 /****************************************************************************
 * Search for calibration frames associated with each science frame and
-* store relationship information
+* store relationship information. Only science frames with
+* mjdlo <= MJD < mjdhi are searched for and stored in scis.
 ****************************************************************************/
 
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "UVES_headsort.h"
 #include "error.h"
 
 int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
-		 calprd *cprd, int ncal) {
+		 calprd *cprd, int ncal, double mjdlo, double mjdhi,
+		 hsstats *st, hsdiag *dg) {
 
+  double   t0=0.0;
+  long     nexam=0,ncand=0,nsel=0; /* Counts for run statistics */
+  int      nc[6];         /* Candidates of each type for trace events */
   int      ncsrch=0;      /* Number of calibrations over total cal. period */
   int      max_ncsrch=0;  /* Maximum # calibrations over total cal. period */
   int      i=0,j=0,k=0;
@@ -18,16 +24,19 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
 
   /* Determine size of calibration search array and allocate memory */
   max_ncsrch=NCALBLK*ncal;
-  if (!(csrch=(calsrch *)malloc((size_t)(max_ncsrch*sizeof(calsrch)))))
-    errormsg("UVES_calsrch(): Could not allocate memory for calibration\n\
-\tsearch array of size %d.",max_ncsrch);
+  if (!(csrch=(calsrch *)malloc((size_t)(max_ncsrch*sizeof(calsrch))))) {
+    nferrormsg("UVES_calsrch(): Could not allocate memory for calibration\n\
+\tsearch array of size %d.",max_ncsrch); return 0;
+  }
 
   /* Find all science frames and flesh-out relevant info (science arm etc.) */
   j=0; for (i=0; i<nhdrs; i++) {
     /* Identify science exposure */
-    if (!strcmp(hdrs[i].typ,"sci")) {
-      /* Copy header structure to science header */
-      scis[j].hdr=hdrs[i];
+    if (!strcmp(hdrs[i].typ,"sci") && hdrs[i].mjd>=mjdlo &&
+	hdrs[i].mjd<mjdhi) {
+      /* Copy header structure to science header, then mark its
+	 diagnostics as recorded for later searches */
+      scis[j].hdr=hdrs[i]; hdrs[i].dgseen|=DGS_MATCH;
       /* Identify which science arm we are using, red or blue */
       if (!scis[j].hdr.arm) strcpy(scis[j].arm,"blue\0");
       else strcpy(scis[j].arm,"red\0");
@@ -51,11 +60,16 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
   }
 
   for (i=0; i<nscis; i++) {
+    t0=UVES_hstrnow(st);
+    /* Count, but do not repeat, diagnostics recorded by an earlier search */
+    if (dg!=NULL) dg->quiet=(scis[i].hdr.dgseen&DGS_MATCH);
+    scis[i].hdr.dgseen|=DGS_MATCH;
 
     /** BIAS **/
     /* Go though header list and determine bias calibration search array */
     for (j=0,k=0; j<nhdrs; j++) {
       if (!strcmp(hdrs[j].obj,"bias")) {
+	nexam++;
 	if (hdrs[j].mjd>scis[i].hdr.mjd-cprd->ndscal_b &&
 	    hdrs[j].mjd<scis[i].hdr.mjd+cprd->ndscal_f &&
 	    !strcmp(hdrs[j].cwl,scis[i].arm) &&
@@ -66,31 +80,38 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
 	  else if (hdrs[j].mjd>scis[i].hdr.mjd_e)
 	    csrch[k].dmjd=hdrs[j].mjd-scis[i].hdr.mjd_e;
 	  else {
-	    warnmsg("UVES_calsrch(): BIAS frame\n\t%s,\n\
+	    UVES_hsdiag(dg,DG_OVERLAP,"BIAS",scis[i].hdr.obj,scis[i].hdr.file,
+			hdrs[j].file,0,0,"UVES_calsrch(): BIAS frame\n\t%s,\n\
 \twhich runs between MJD=%lf-%lf, appears to overlap with associated science frame\n\
 \t%s\n\twhich runs between MJD=%lf-%lf.\n\
 \tSetting time difference relative to middle of science frame.",hdrs[j].file,
-		    hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
-		    scis[i].hdr.mjd_e);
+			hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
+			scis[i].hdr.mjd_e);
 	    csrch[k].dmjd=fabs(0.5*(hdrs[j].mjd+hdrs[j].mjd_e)-
 			       0.5*(scis[i].hdr.mjd+scis[i].hdr.mjd_e));
 	  }
 	  k++;
-	  if (k==max_ncsrch)
-	    errormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
-\tarray exceeded. Increase NCALBLK in UVES_headsort.h");
+	  if (k==max_ncsrch) {
+	    free(csrch);
+	    nferrormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
+\tarray exceeded. Increase NCALBLK in UVES_headsort.h"); return 0;
+	  }
 	}
       }
     }
+    nc[0]=k; ncand+=k;
     if (!(ncsrch=k) && cprd->nbias>0) {
-      warnmsg("UVES_calsrch(): No BIASes found in cal. period for\n\t%s.\n\
+      UVES_hsdiag(dg,DG_NOCAL,"BIAS",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		  cprd->nbias,0,"UVES_calsrch(): No BIASes found in cal. period for\n\t%s.\n\
 \tIncrease calibration period using -c option",scis[i].hdr.file);
       scis[i].nb=0; /* Indicates error for notes file writing */
     }
     else if (cprd->nbias>0) {
       if (ncsrch<cprd->nbias)
-	warnmsg("UVES_calsrch(): %d BIASes requested but only %d found for\n\t%s",
-		cprd->nbias,ncsrch,scis[i].hdr.file);
+	UVES_hsdiag(dg,DG_FEWCAL,"BIAS",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		    cprd->nbias,ncsrch,
+		    "UVES_calsrch(): %d BIASes requested but only %d found for\n\t%s",
+		    cprd->nbias,ncsrch,scis[i].hdr.file);
       /* Sort the cal. search array in order of increasing DMJD */
       qsort(csrch,ncsrch,sizeof(calsrch),qsort_calsrch);
       /* Fill the bias index array with relevant file numbers */
@@ -103,6 +124,7 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
     /* Go though header list and determine flat calibration search array */
     for (j=0,k=0; j<nhdrs; j++) {
       if (!strcmp(hdrs[j].obj,"flat")) {
+	nexam++;
 	if (hdrs[j].mjd>scis[i].hdr.mjd-cprd->ndscal_b &&
 	    hdrs[j].mjd<scis[i].hdr.mjd+cprd->ndscal_f &&
 	    !strcmp(hdrs[j].cwl,scis[i].hdr.cwl) &&
@@ -116,31 +138,38 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
 	  else if (hdrs[j].mjd>scis[i].hdr.mjd_e)
 	    csrch[k].dmjd=hdrs[j].mjd-scis[i].hdr.mjd_e;
 	  else {
-	    warnmsg("UVES_calsrch(): FLAT frame\n\t%s,\n\
+	    UVES_hsdiag(dg,DG_OVERLAP,"FLAT",scis[i].hdr.obj,scis[i].hdr.file,
+			hdrs[j].file,0,0,"UVES_calsrch(): FLAT frame\n\t%s,\n\
 \twhich runs between MJD=%lf-%lf, appears to overlap with associated science frame\n\
 \t%s\n\twhich runs between MJD=%lf-%lf.\n\
 \tSetting time difference relative to middle of science frame.",hdrs[j].file,
-		    hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
-		    scis[i].hdr.mjd_e);
+			hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
+			scis[i].hdr.mjd_e);
 	    csrch[k].dmjd=fabs(0.5*(hdrs[j].mjd+hdrs[j].mjd_e)-
 			  0.5*(scis[i].hdr.mjd+scis[i].hdr.mjd_e));
 	  }
 	  k++;
-	  if (k==max_ncsrch)
-	    errormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
-\tarray exceeded. Increase NCALBLK in UVES_headsort.h");
+	  if (k==max_ncsrch) {
+	    free(csrch);
+	    nferrormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
+\tarray exceeded. Increase NCALBLK in UVES_headsort.h"); return 0;
+	  }
 	}
       }
     }
+    nc[1]=k; ncand+=k;
     if (!(ncsrch=k) && cprd->nflat>0) {
-      warnmsg("UVES_calsrch(): No FLATs found in cal. period for\n\t%s.\n\
+      UVES_hsdiag(dg,DG_NOCAL,"FLAT",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		  cprd->nflat,0,"UVES_calsrch(): No FLATs found in cal. period for\n\t%s.\n\
 \tIncrease calibration period using -c option",scis[i].hdr.file);
       scis[i].nfl=0; /* Indicates error for notes file writing */
     }
     else if (cprd->nflat>0) {
       if (ncsrch<cprd->nflat)
-	warnmsg("UVES_calsrch(): %d FLATs requested but only %d found for\n\t%s",
-		cprd->nflat,ncsrch,scis[i].hdr.file);
+	UVES_hsdiag(dg,DG_FEWCAL,"FLAT",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		    cprd->nflat,ncsrch,
+		    "UVES_calsrch(): %d FLATs requested but only %d found for\n\t%s",
+		    cprd->nflat,ncsrch,scis[i].hdr.file);
       /* Sort the cal. search array in order of increasing DMJD */
       qsort(csrch,ncsrch,sizeof(calsrch),qsort_calsrch);
       /* Fill the flat index array with relevant file numbers */
@@ -153,6 +182,7 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
     /* Go though header list and determine wav calibration search array */
     for (j=0,k=0; j<nhdrs; j++) {
       if (!strcmp(hdrs[j].typ,"wav")) {
+	nexam++;
 	if (hdrs[j].mjd>scis[i].hdr.mjd-cprd->ndscal_b &&
 	    hdrs[j].mjd<scis[i].hdr.mjd+cprd->ndscal_f &&
 	    !strcmp(hdrs[j].cwl,scis[i].hdr.cwl) &&
@@ -166,31 +196,38 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
 	  else if (hdrs[j].mjd>scis[i].hdr.mjd_e)
 	    csrch[k].dmjd=hdrs[j].mjd-scis[i].hdr.mjd_e;
 	  else {
-	    warnmsg("UVES_calsrch(): WAV frame\n\t%s,\n\
+	    UVES_hsdiag(dg,DG_OVERLAP,"WAV",scis[i].hdr.obj,scis[i].hdr.file,
+			hdrs[j].file,0,0,"UVES_calsrch(): WAV frame\n\t%s,\n\
 \twhich runs between MJD=%lf-%lf, appears to overlap with associated science frame\n\
 \t%s\n\twhich runs between MJD=%lf-%lf.\n\
 \ttSetting time difference relative to middle of science frame.",hdrs[j].file,
-		    hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
-		    scis[i].hdr.mjd_e);
+			hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
+			scis[i].hdr.mjd_e);
 	    csrch[k].dmjd=fabs(0.5*(hdrs[j].mjd+hdrs[j].mjd_e)-
 			  0.5*(scis[i].hdr.mjd+scis[i].hdr.mjd_e));
 	  }
 	  k++;
-	  if (k==max_ncsrch)
-	    errormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
-\tarray exceeded. Increase NCALBLK in UVES_headsort.h");
+	  if (k==max_ncsrch) {
+	    free(csrch);
+	    nferrormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
+\tarray exceeded. Increase NCALBLK in UVES_headsort.h"); return 0;
+	  }
 	}
       }
     }
+    nc[2]=k; ncand+=k;
     if (!(ncsrch=k) && cprd->nwav>0) {
-      warnmsg("UVES_calsrch(): No WAVs found in cal. period for\n\t%s.\n\
+      UVES_hsdiag(dg,DG_NOCAL,"WAV",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		  cprd->nwav,0,"UVES_calsrch(): No WAVs found in cal. period for\n\t%s.\n\
 \tIncrease calibration period using -c option",scis[i].hdr.file);
       scis[i].nw=0; /* Indicates error for notes file writing */
     }
     else if (cprd->nwav>0) {
       if (ncsrch<cprd->nwav)
-	warnmsg("UVES_calsrch(): %d WAVs requested but only %d found for\n\t%s",
-		cprd->nwav,ncsrch,scis[i].hdr.file);
+	UVES_hsdiag(dg,DG_FEWCAL,"WAV",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		    cprd->nwav,ncsrch,
+		    "UVES_calsrch(): %d WAVs requested but only %d found for\n\t%s",
+		    cprd->nwav,ncsrch,scis[i].hdr.file);
       /* Sort the cal. search array in order of increasing DMJD */
       qsort(csrch,ncsrch,sizeof(calsrch),qsort_calsrch);
       scis[i].nw=MIN(ncsrch,cprd->nwav);
@@ -240,6 +277,7 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
     /* Go though header list and determine ord calibration search array */
     for (j=0,k=0; j<nhdrs; j++) {
       if (!strcmp(hdrs[j].typ,"ord")) {
+	nexam++;
 	if (hdrs[j].mjd>scis[i].hdr.mjd-cprd->ndscal_b &&
 	    hdrs[j].mjd<scis[i].hdr.mjd+cprd->ndscal_f &&
 	    !strcmp(hdrs[j].cwl,scis[i].hdr.cwl) &&
@@ -252,31 +290,38 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
 	  else if (hdrs[j].mjd>scis[i].hdr.mjd_e)
 	    csrch[k].dmjd=hdrs[j].mjd-scis[i].hdr.mjd_e;
 	  else {
-	    warnmsg("UVES_calsrch(): ORD frame\n\t%s,\n\
+	    UVES_hsdiag(dg,DG_OVERLAP,"ORD",scis[i].hdr.obj,scis[i].hdr.file,
+			hdrs[j].file,0,0,"UVES_calsrch(): ORD frame\n\t%s,\n\
 \twhich runs between MJD=%lf-%lf, appears to overlap with associated science frame\n\
 \t%s\n\twhich runs between MJD=%lf-%lf.\n\
 \tSetting time difference relative to middle of science frame.",hdrs[j].file,
-		    hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
-		    scis[i].hdr.mjd_e);
+			hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
+			scis[i].hdr.mjd_e);
 	    csrch[k].dmjd=fabs(0.5*(hdrs[j].mjd+hdrs[j].mjd_e)-
 			  0.5*(scis[i].hdr.mjd+scis[i].hdr.mjd_e));
 	  }
 	  k++;
-	  if (k==max_ncsrch)
-	    errormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
-\tarray exceeded. Increase NCALBLK in UVES_headsort.h");
+	  if (k==max_ncsrch) {
+	    free(csrch);
+	    nferrormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
+\tarray exceeded. Increase NCALBLK in UVES_headsort.h"); return 0;
+	  }
 	}
       }
     }
+    nc[3]=k; ncand+=k;
     if (!(ncsrch=k) && cprd->nord>0) {
-      warnmsg("UVES_calsrch(): No ORDs found in cal. period for\n\t%s.\n\
+      UVES_hsdiag(dg,DG_NOCAL,"ORD",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		  cprd->nord,0,"UVES_calsrch(): No ORDs found in cal. period for\n\t%s.\n\
 \tIncrease calibration period using -c option",scis[i].hdr.file);
       scis[i].no=0; /* Indicates error for notes file writing */
     }
     else if (cprd->nord>0) {
       if (ncsrch<cprd->nord)
-	warnmsg("UVES_calsrch(): %d ORDs requested but only %d found for\n\t%s",
-		cprd->nord,ncsrch,scis[i].hdr.file);
+	UVES_hsdiag(dg,DG_FEWCAL,"ORD",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		    cprd->nord,ncsrch,
+		    "UVES_calsrch(): %d ORDs requested but only %d found for\n\t%s",
+		    cprd->nord,ncsrch,scis[i].hdr.file);
       /* Sort the cal. search array in order of increasing DMJD */
       qsort(csrch,ncsrch,sizeof(calsrch),qsort_calsrch);
       /* Fill the order definition index array with relevant file numbers */
@@ -289,6 +334,7 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
     /* Go though header list and determine fmt calibration search array */
     for (j=0,k=0; j<nhdrs; j++) {
       if (!strcmp(hdrs[j].typ,"fmt")) {
+	nexam++;
 	if (hdrs[j].mjd>scis[i].hdr.mjd-cprd->ndscal_b &&
 	    hdrs[j].mjd<scis[i].hdr.mjd+cprd->ndscal_f &&
 	    !strcmp(hdrs[j].cwl,scis[i].hdr.cwl) &&
@@ -301,31 +347,38 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
 	  else if (hdrs[j].mjd>scis[i].hdr.mjd_e)
 	    csrch[k].dmjd=hdrs[j].mjd-scis[i].hdr.mjd_e;
 	  else {
-	    warnmsg("UVES_calsrch(): FMT frame\n\t%s,\n\
+	    UVES_hsdiag(dg,DG_OVERLAP,"FMT",scis[i].hdr.obj,scis[i].hdr.file,
+			hdrs[j].file,0,0,"UVES_calsrch(): FMT frame\n\t%s,\n\
 \twhich runs between MJD=%lf-%lf, appears to overlap with associated science frame\n\
 \t%s\n\twhich runs between MJD=%lf-%lf.\n\
 \tSetting time difference relative to middle of science frame.",hdrs[j].file,
-		    hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
-		    scis[i].hdr.mjd_e);
+			hdrs[j].mjd,hdrs[j].mjd_e,scis[i].hdr.file,scis[i].hdr.mjd,
+			scis[i].hdr.mjd_e);
 	    csrch[k].dmjd=fabs(0.5*(hdrs[j].mjd+hdrs[j].mjd_e)-
 			  0.5*(scis[i].hdr.mjd+scis[i].hdr.mjd_e));
 	  }
 	  k++;
-	  if (k==max_ncsrch)
-	    errormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
-\tarray exceeded. Increase NCALBLK in UVES_headsort.h");
+	  if (k==max_ncsrch) {
+	    free(csrch);
+	    nferrormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
+\tarray exceeded. Increase NCALBLK in UVES_headsort.h"); return 0;
+	  }
 	}
       }
     }
+    nc[4]=k; ncand+=k;
     if (!(ncsrch=k) && cprd->nfmt>0) {
-      warnmsg("UVES_calsrch(): No FMTs found in cal. period for\n\t%s.\n\
+      UVES_hsdiag(dg,DG_NOCAL,"FMT",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		  cprd->nfmt,0,"UVES_calsrch(): No FMTs found in cal. period for\n\t%s.\n\
 \tIncrease calibration period using -c option",scis[i].hdr.file);
       scis[i].nfm=0; /* Indicates error for notes file writing */
     }
     else if (cprd->nfmt>0) {
       if (ncsrch<cprd->nfmt)
-	warnmsg("UVES_calsrch(): %d FMTs requested but only %d found for\n\t%s",
-		cprd->nfmt,ncsrch,scis[i].hdr.file);
+	UVES_hsdiag(dg,DG_FEWCAL,"FMT",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		    cprd->nfmt,ncsrch,
+		    "UVES_calsrch(): %d FMTs requested but only %d found for\n\t%s",
+		    cprd->nfmt,ncsrch,scis[i].hdr.file);
       /* Sort the cal. search array in order of increasing DMJD */
       qsort(csrch,ncsrch,sizeof(calsrch),qsort_calsrch);
       /* Fill the format check index array with relevant file numbers */
@@ -338,6 +391,7 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
     /* Go though header list and determine std calibration search array */
     for (j=0,k=0; j<nhdrs; j++) {
       if (!strcmp(hdrs[j].typ,"std")) {
+	nexam++;
 	if (hdrs[j].mjd>scis[i].hdr.mjd-cprd->ndscal_b &&
 	    hdrs[j].mjd<scis[i].hdr.mjd+cprd->ndscal_f &&
 	    !strcmp(hdrs[j].cwl,scis[i].hdr.cwl) &&
@@ -346,21 +400,27 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
 	    hdrs[j].biny==scis[i].hdr.biny) {
 	  csrch[k].ind=j;
 	  csrch[k++].dmjd=fabs(hdrs[j].mjd-scis[i].hdr.mjd);
-	  if (k==max_ncsrch)
-	    errormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
-\tarray exceeded. Increase NCALBLK in UVES_headsort.h");
+	  if (k==max_ncsrch) {
+	    free(csrch);
+	    nferrormsg("UVES_calsrch(): Maximum number of elements in cal. search\n\
+\tarray exceeded. Increase NCALBLK in UVES_headsort.h"); return 0;
+	  }
 	}
       }
     }
+    nc[5]=k; ncand+=k;
     if (!(ncsrch=k) && cprd->nstd>0) {
-      warnmsg("UVES_calsrch(): No STDs found in cal. period for\n\t%s.\n\
+      UVES_hsdiag(dg,DG_NOCAL,"STD",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		  cprd->nstd,0,"UVES_calsrch(): No STDs found in cal. period for\n\t%s.\n\
 \tIncrease calibration period using -c option",scis[i].hdr.file);
       scis[i].ns=0; /* Indicates error for notes file writing */
     }
     else if (cprd->nstd>0) {
       if (ncsrch<cprd->nstd)
-	warnmsg("UVES_calsrch(): %d STDs requested but only %d found for\n\t%s",
-		cprd->nstd,ncsrch,scis[i].hdr.file);
+	UVES_hsdiag(dg,DG_FEWCAL,"STD",scis[i].hdr.obj,scis[i].hdr.file,NULL,
+		    cprd->nstd,ncsrch,
+		    "UVES_calsrch(): %d STDs requested but only %d found for\n\t%s",
+		    cprd->nstd,ncsrch,scis[i].hdr.file);
       /* Sort the cal. search array in order of increasing DMJD */
       qsort(csrch,ncsrch,sizeof(calsrch),qsort_calsrch);
       /* Fill the standard index array with relevant file numbers */
@@ -371,7 +431,15 @@ int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
       if (scis[i].ns) strcpy(scis[i].std,hdrs[scis[i].sind[0]].obj);
     }
     else if (!cprd->nstd) scis[i].ns=0;
+    nsel+=scis[i].nb+scis[i].nfl+scis[i].nw+scis[i].no+scis[i].nfm+scis[i].ns;
+    UVES_hstrspan(st,"calsrch",scis[i].hdr.obj,scis[i].hdr.file,t0,
+		  "\"bias\":%d,\"flat\":%d,\"wav\":%d,\"ord\":%d,\"fmt\":%d,\
+\"std\":%d,\"selected\":%d",nc[0],nc[1],nc[2],nc[3],nc[4],nc[5],
+		  scis[i].nb+scis[i].nfl+scis[i].nw+scis[i].no+scis[i].nfm+
+		  scis[i].ns);
   }
+  if (st!=NULL) { st->ncsexam+=nexam; st->ncscand+=ncand; st->ncssel+=nsel; }
+  if (dg!=NULL) dg->quiet=0;
 
   /* Clean up */
   free(csrch);  
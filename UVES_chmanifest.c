@@ -0,0 +1,95 @@
+/****************************************************************************
+* Read a UVES_copyhead manifest. Each line gives a source FITS file, the
+* extension number whose header is to be copied, and one or more target
+* FITS files to append that header to, separated by white space. Blank
+* lines and lines starting with # are ignored. One source entry is made
+* per line (duplicates are merged later by UVES_chprep()) and one target
+* entry per target file. The source and target arrays grow as needed.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "UVES_copyhead.h"
+#include "file.h"
+#include "error.h"
+
+int UVES_chmanifest(char *mfile, chsrc **src, int *nsrc, chtarg **targ,
+		    int *ntarg) {
+
+  int      nsrcmax=*nsrc,ntargmax=*ntarg,ext=0,line=0,nt=0;
+  char     buffer[VVHUGESTRLEN]="\0";
+  char     *cptr=NULL,*save=NULL;
+  FILE     *data_file=NULL;
+  chsrc    *tmpsrc=NULL;
+  chtarg   *tmptarg=NULL;
+
+  /* Open manifest file */
+  if ((data_file=faskropen("Valid manifest file?",mfile,5))==NULL) {
+    nferrormsg("UVES_chmanifest(): Cannot open manifest file %s",mfile);
+    return 0;
+  }
+
+  /* Read one source and its targets from each line */
+  while (fgets(buffer,VVHUGESTRLEN,data_file)!=NULL) {
+    line++;
+    if (strlen(buffer)==VVHUGESTRLEN-1 && buffer[VVHUGESTRLEN-2]!='\n') {
+      DATCLOSE; nferrormsg("UVES_chmanifest(): Line %d of manifest file\n\
+\t%s is too long",line,mfile); return 0;
+    }
+    if ((cptr=strtok_r(buffer," \t\n",&save))==NULL || *cptr=='#') continue;
+    /* Source file and extension */
+    if (*nsrc==nsrcmax) {
+      nsrcmax=(nsrcmax) ? 2*nsrcmax : NCHSRC;
+      if ((tmpsrc=(chsrc *)realloc(*src,(size_t)nsrcmax*sizeof(chsrc)))==NULL) {
+	DATCLOSE; nferrormsg("UVES_chmanifest(): Cannot allocate memory for\n\
+\tsource list of size %d",nsrcmax); return 0;
+      }
+      *src=tmpsrc;
+    }
+    if (strlen(cptr)>=NAMELEN-1) {
+      DATCLOSE; nferrormsg("UVES_chmanifest(): Source file name\n\t%s\n\
+\tspecified on line %d of manifest file %s is too long",cptr,line,mfile);
+      return 0;
+    }
+    strcpy((*src)[*nsrc].file,cptr);
+    if ((cptr=strtok_r(NULL," \t\n",&save))==NULL ||
+	sscanf(cptr,"%d",&ext)!=1 || ext<0) {
+      DATCLOSE; nferrormsg("UVES_chmanifest(): Incorrect format in line %d\n\
+\tof manifest file %s",line,mfile); return 0;
+    }
+    (*src)[*nsrc].ext=ext; (*src)[*nsrc].line=line;
+    (*src)[*nsrc].hb.buf=NULL;
+    /* Target files */
+    nt=0; while ((cptr=strtok_r(NULL," \t\n",&save))!=NULL) {
+      if (*ntarg==ntargmax) {
+	ntargmax=(ntargmax) ? 2*ntargmax : NCHTARG;
+	if ((tmptarg=(chtarg *)realloc(*targ,(size_t)ntargmax*sizeof(chtarg)))
+	    ==NULL) {
+	  DATCLOSE; nferrormsg("UVES_chmanifest(): Cannot allocate memory\n\
+\tfor output file list of size %d",ntargmax); return 0;
+	}
+	*targ=tmptarg;
+      }
+      if (strlen(cptr)>=NAMELEN-1) {
+	DATCLOSE; nferrormsg("UVES_chmanifest(): Output file name\n\t%s\n\
+\tspecified on line %d of manifest file %s is too long",cptr,line,mfile);
+	return 0;
+      }
+      strcpy((*targ)[*ntarg].file,cptr); (*targ)[*ntarg].line=line;
+      (*targ)[(*ntarg)++].src=*nsrc; nt++;
+    }
+    if (!nt) {
+      DATCLOSE; nferrormsg("UVES_chmanifest(): No output files specified\n\
+\ton line %d of manifest file %s",line,mfile); return 0;
+    }
+    (*nsrc)++;
+  }
+  if (!feof(data_file)) {
+    DATCLOSE; nferrormsg("UVES_chmanifest(): Problem reading manifest file\n\
+\t%s on line %d",mfile,line+1); return 0;
+  }
+  DATCLOSE;
+
+  return 1;
+
+}
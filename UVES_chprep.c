@@ -0,0 +1,123 @@
+/****************************************************************************
+* Prepare UVES_copyhead sources and targets for appending. Sources naming
+* the same file and extension are merged so that each source file is
+* opened once and each header is serialised once, whichever target list
+* or manifest line it came from. A single zero-filled buffer, as long as
+* the largest data unit, is shared by all headers. Each target is then
+* pointed at its serialised header. Targets listed more than once are
+* rejected, since appending to one file concurrently would interleave.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "UVES_copyhead.h"
+#include "error.h"
+
+#define FREEPREP free(sord); free(tord);
+
+/* Order sources by file name then extension, keeping input order */
+static int UVES_chsrccmp(const void *a, const void *b) {
+
+  chsrc    *sa=*(chsrc **)a,*sb=*(chsrc **)b;
+  int      c=0;
+
+  if ((c=strcmp(sa->file,sb->file))) return c;
+  if (sa->ext!=sb->ext) return (sa->ext<sb->ext) ? -1 : 1;
+  return (sa<sb) ? -1 : ((sa>sb) ? 1 : 0);
+
+}
+
+/* Order targets by file name, keeping input order */
+static int UVES_chtargcmp(const void *a, const void *b) {
+
+  chtarg   *ta=*(chtarg **)a,*tb=*(chtarg **)b;
+  int      c=0;
+
+  if ((c=strcmp(ta->file,tb->file))) return c;
+  return (ta<tb) ? -1 : ((ta>tb) ? 1 : 0);
+
+}
+
+int UVES_chprep(chsrc *src, int nsrc, chtarg *targ, int ntarg, char **zero) {
+
+  size_t   dmax=0;
+  int      hdunum=0,hdutype=0,status=0;
+  int      i=0,k=0;
+  char     *cur=NULL;
+  chsrc    **sord=NULL;
+  chtarg   **tord=NULL;
+  fitsfile *infits=NULL;
+
+  *zero=NULL;
+  if ((sord=(chsrc **)malloc((size_t)nsrc*sizeof(chsrc *)))==NULL ||
+      (tord=(chtarg **)malloc((size_t)ntarg*sizeof(chtarg *)))==NULL) {
+    FREEPREP; nferrormsg("UVES_chprep(): Cannot allocate memory for\n\
+\tsorting %d sources and %d targets",nsrc,ntarg); return 0;
+  }
+
+  /* Reject targets listed more than once */
+  for (i=0; i<ntarg; i++) tord[i]=&(targ[i]);
+  qsort(tord,ntarg,sizeof(chtarg *),UVES_chtargcmp);
+  for (i=1; i<ntarg; i++) if (!strcmp(tord[i]->file,tord[i-1]->file)) {
+      nferrormsg("UVES_chprep(): Output file %s is listed\n\
+\tmore than once (lines %d and %d)",tord[i]->file,tord[i-1]->line,
+		 tord[i]->line); FREEPREP; return 0;
+    }
+
+  /* Merge sources with the same file and extension */
+  for (i=0; i<nsrc; i++) sord[i]=&(src[i]);
+  qsort(sord,nsrc,sizeof(chsrc *),UVES_chsrccmp);
+  for (i=0; i<nsrc; i++) {
+    if (i && !strcmp(sord[i]->file,sord[i-1]->file) &&
+	sord[i]->ext==sord[i-1]->ext) sord[i]->uniq=sord[i-1]->uniq;
+    else sord[i]->uniq=(int)(sord[i]-src);
+  }
+
+  /* Serialise each unique header, opening each source file once */
+  for (i=0; i<nsrc; i++) {
+    if (sord[i]->uniq!=(int)(sord[i]-src)) continue;
+    if (cur==NULL || strcmp(cur,sord[i]->file)) {
+      if (cur!=NULL) { INCLOSE; cur=NULL; }
+      /* Open input file as FITS file and check number of HDUs */
+      if (fits_open_file(&infits,sord[i]->file,READONLY,&status)) {
+	nferrormsg("UVES_chprep(): Cannot open input FITS file %s",
+		   sord[i]->file); FREEPREP; return 0;
+      }
+      cur=sord[i]->file;
+      if (fits_get_num_hdus(infits,&hdunum,&status)) {
+	INCLOSE; nferrormsg("UVES_chprep(): Cannot find number of HDUs\n\
+\tin file %s",sord[i]->file); FREEPREP; return 0;
+      }
+    }
+    if (sord[i]->ext>hdunum-1) {
+      INCLOSE; nferrormsg("UVES_chprep(): Cannot copy extension number %d\n\
+\tfrom file %s since only %d HDUs exist",sord[i]->ext,sord[i]->file,hdunum);
+      FREEPREP; return 0;
+    }
+    /* Move to target HDU */
+    if (fits_movabs_hdu(infits,sord[i]->ext+1,&hdutype,&status)) {
+      INCLOSE; nferrormsg("UVES_chprep(): Cannot move to extension %d\n\
+\t(HDU %d) in FITS file %s.",sord[i]->ext,sord[i]->ext+1,sord[i]->file);
+      FREEPREP; return 0;
+    }
+    if (!UVES_hdrbuf(infits,sord[i]->file,&(sord[i]->hb))) {
+      INCLOSE; FREEPREP;
+      nferrormsg("UVES_chprep(): Unknown error returned from UVES_hdrbuf()");
+      return 0;
+    }
+    if (sord[i]->hb.dlen>dmax) dmax=sord[i]->hb.dlen;
+  }
+  if (cur!=NULL) { INCLOSE; }
+  FREEPREP;
+
+  /* Share one empty data unit between all headers */
+  if ((*zero=(char *)calloc(dmax+1,1))==NULL) {
+    nferrormsg("UVES_chprep(): Cannot allocate memory for empty\n\
+\tdata unit of length %ld",(long)dmax); return 0;
+  }
+  for (k=0; k<nsrc; k++) if (src[k].uniq==k) src[k].hb.dat=*zero;
+  for (k=0; k<ntarg; k++) targ[k].hb=&(src[src[targ[k].src].uniq].hb);
+
+  return 1;
+
+}
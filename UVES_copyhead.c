@@ -2,6 +2,10 @@
 
 UVES_copyhead: Copy the primary header from one FITS file to a new, empty
 HDU in an existing, non-empty FITS file or list of non-empty FITS files.
+The header is serialised once and appended to each output file with a
+single write, with several output files written concurrently. With
+-manifest, many (source, extension, targets) entries are processed in
+one run, each source header being serialised only once.
 
 ****************************************************************************/
 
@@ -9,18 +13,11 @@ HDU in an existing, non-empty FITS file or list of non-empty FITS files.
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <fitsio.h>
-#include <longnam.h>
-#include "charstr.h"
+#include "UVES_copyhead.h"
 #include "file.h"
+#include "thpool.h"
 #include "error.h"
 
-/* Definitions */
-#define EXT 0
-#define INCLOSE  fits_close_file(infits,&status);
-#define OUTCLOSE  fits_close_file(outfits,&status);
-#define DATCLOSE  fclose(data_file);
-
 /* Global declarations */
 char      *progname;
 
@@ -36,15 +33,37 @@ void usage(void) {
   fprintf(stderr,"\nBy Michael Murphy");
 
   fprintf(stderr,"\nUsage: %s [OPTIONS] [INPUT FITS FILE] [OUTPUT FITS file or list]\n\
-",progname);
+       %s [OPTIONS] -manifest FILE\n",progname,progname);
 
   fprintf(stderr, "\nOptions:\n\
   -h, -help        : Print this message.\n\
-  -ext  = %2d       : Copy header in extension number x from input file.\n\n",
+  -ext  = %2d       : Copy header in extension number x from input file.\n\
+  -nthreads N      : Number of output files to write concurrently (default:\n\
+                         number of processors).\n\
+  -verify          : Reopen each output file with CFITSIO afterwards to check\n\
+                         the new HDU.\n\
+  -manifest FILE   : Read copy jobs from FILE instead of the command line.\n\
+                         Each line gives a source FITS file, the extension\n\
+                         number to copy the header from and one or more\n\
+                         output FITS files. Blank lines and lines starting\n\
+                         with # are ignored.\n\n",
 	  EXT);
   exit(3);
 }
 
+/****************************************************************************
+* Job for the worker thread pool: append the header to output file k
+****************************************************************************/
+
+void UVES_chwork(void *arg, int k) {
+
+  chpool   *pool=(chpool *)arg;
+
+  pool->targ[k].ok=UVES_hdrappend(pool->targ[k].file,pool->targ[k].hb,
+				   pool->verify);
+
+}
+
 /****************************************************************************
 * The main program
 
@@ -54,13 +73,18 @@ void usage(void) {
 
 int main(int argc, char *argv[]) {
 
-  int      ext=-1;
-  int      hdunum=0,hdutype=0,status=0;
-  int      i=0;
+  int      ext=-1,verify=0,nthread=0,nsrc=0,ntarg=0,ntargmax=0,nfail=0;
+  int      status=0;
+  int      i=0,k=0;
   char     infile[NAMELEN]="\0",outfile[NAMELEN]="\0",datfile[NAMELEN]="\0";
+  char     mfile[NAMELEN]="\0";
   char     buffer[LNGSTRLEN]="\0";
+  char     *zero=NULL;
   FILE     *data_file=NULL;
-  fitsfile *infits,*outfits;
+  fitsfile *outfits;
+  chsrc    *src=NULL;
+  chtarg   *targ=NULL,*tmptarg=NULL;
+  chpool   pool;
 
   /* Define the program name from the command line input */
   progname=((progname=strrchr(argv[0],'/'))==NULL) ? argv[0] : progname+1;
@@ -71,6 +95,15 @@ int main(int argc, char *argv[]) {
     if (!strcmp(argv[i],"-ext")) {
       if (sscanf(argv[++i],"%d",&(ext))!=1) usage();
     }
+    else if (!strcmp(argv[i],"-nthreads")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&nthread)!=1 || nthread<1) usage();
+    }
+    else if (!strcmp(argv[i],"-verify")) verify=1;
+    else if (!strcmp(argv[i],"-manifest")) {
+      if (++i>=argc) usage();
+      if (strlen(argv[i])<NAMELEN) strcpy(mfile,argv[i]);
+      else errormsg("Manifest file name too long: %s",argv[i]);
+    }
     else if (!strcmp(argv[i],"-help") || !strcmp(argv[i],"-h")) usage();
     else if (!strncmp(infile,"\0",1)) {
       if (!access(argv[i],R_OK)) {
@@ -88,77 +121,108 @@ int main(int argc, char *argv[]) {
 \tcannot be written to",argv[i]);
     }
   }
-  /* Make sure input and output files were specified */
-  if (!strncmp(infile,"\0",1) || !strncmp(outfile,"\0",1)) usage();
+  /* Make sure input and output files, or a manifest, were specified */
+  if (strncmp(mfile,"\0",1)) {
+    if (strncmp(infile,"\0",1) || ext>=0) usage();
+  }
+  else if (!strncmp(infile,"\0",1) || !strncmp(outfile,"\0",1)) usage();
   /* Make sure extension number makes sense, initialize it if not */
   if (ext<0) ext=EXT;
 
-  /* Open input file as FITS file */
-  if (fits_open_file(&infits,infile,READONLY,&status))
-      errormsg("Cannot open input FITS file %s",infile);
-  /* Check number of HDUs */
-  if (fits_get_num_hdus(infits,&hdunum,&status))
-    errormsg("Cannot find number of HDUs in file %s",infile);
-  if (ext>hdunum-1)
-    errormsg("Cannot copy extension number %d from file\n\
-\t%s since only %d HDUs exist",ext,infile,hdunum);
-  /* Move to target HDU */
-  if (fits_movrel_hdu(infits,ext,&hdutype,&status))
-    errormsg("Cannot move to extension %d (HDU %d)\n\
-\tin FITS file %s.",ext,ext+1,infile);
-
-  /* First attempt to open output file as a FITS file. If this fails,
-     assume it's a list of FITS files */
-  if (!fits_open_file(&outfits,outfile,READWRITE,&status)) {
-    /* This must be a single output FITS file */
-    /* Attempt to copy header */
-    if (fits_copy_header(infits,outfits,&status)) {
-      INCLOSE; OUTCLOSE; errormsg("Failed to copy header from input file %s\n\
-\tto output file %s",infile,outfile);
-    }
-    /* Close the output FITS file */
-    OUTCLOSE;
+  if (strncmp(mfile,"\0",1)) {
+    /* Read sources and targets from manifest */
+    if (!UVES_chmanifest(mfile,&src,&nsrc,&targ,&ntarg))
+      errormsg("Unknown error returned from UVES_chmanifest()");
+    sprintf(datfile,"%s",mfile);
   } else {
-    /* This might be a list of output FITS files */
-    status=0; sprintf(datfile,"%s",outfile);
-    /* Open the output file */
-    if ((data_file=faskropen("Valid list of output FITS files?",datfile,5))==NULL)
-      { INCLOSE; errormsg("Can not open out file %s",datfile); }
-    /* Read the list of putative output FITS files */
-    i=0; while (fgets(buffer,LNGSTRLEN,data_file)!=NULL) {
-      /* Attempt to open this output FITS file */
-      if (sscanf(buffer,"%s",outfile)!=1) {
-	INCLOSE; DATCLOSE;
-	errormsg("Incorrect format in line %d of file %s",i+1,infile);
-      }
-      if (strlen(outfile)>=NAMELEN-1) {
-	INCLOSE; DATCLOSE;
-	errormsg("Output file name\n\t%s\n\tspecified on line %d of output list\n\
+    /* Single source given on command line */
+    if ((src=(chsrc *)malloc(sizeof(chsrc)))==NULL)
+      errormsg("Cannot allocate memory for source list");
+    strcpy(src[0].file,infile); src[0].ext=ext; src[0].line=0; nsrc=1;
+    /* First attempt to open output file as a FITS file. If this fails,
+       assume it's a list of FITS files */
+    if (!fits_open_file(&outfits,outfile,READONLY,&status)) {
+      /* This must be a single output FITS file */
+      OUTCLOSE;
+      if ((targ=(chtarg *)malloc(sizeof(chtarg)))==NULL)
+	errormsg("Cannot allocate memory for output file list");
+      strcpy(targ[0].file,outfile); targ[0].line=0; ntarg=1;
+    } else {
+      /* This might be a list of output FITS files */
+      status=0; sprintf(datfile,"%s",outfile);
+      /* Open the output file */
+      if ((data_file=faskropen("Valid list of output FITS files?",datfile,5))==NULL)
+	errormsg("Can not open out file %s",datfile);
+      /* Read the list of putative output FITS files */
+      i=0; while (fgets(buffer,LNGSTRLEN,data_file)!=NULL) {
+	if (sscanf(buffer,"%s",outfile)!=1) {
+	  DATCLOSE; errormsg("Incorrect format in line %d of file %s",i+1,
+			     datfile);
+	}
+	if (strlen(outfile)>=NAMELEN-1) {
+	  DATCLOSE;
+	  errormsg("Output file name\n\t%s\n\tspecified on line %d of output list\n\
 \tfile %s is too long",outfile,i+1,datfile);
+	}
+	if (ntarg==ntargmax) {
+	  ntargmax=(ntargmax) ? 2*ntargmax : NCHTARG;
+	  if ((tmptarg=(chtarg *)realloc(targ,(size_t)ntargmax*sizeof(chtarg)))
+	      ==NULL) {
+	    DATCLOSE; errormsg("Cannot allocate memory for output file list\n\
+\tof size %d",ntargmax);
+	  }
+	  targ=tmptarg;
+	}
+	strcpy(targ[ntarg].file,outfile); targ[ntarg++].line=i+1;
+	i++;
       }
-      if (fits_open_file(&outfits,outfile,READWRITE,&status)) {
-	INCLOSE; DATCLOSE; errormsg("Cannot open output FITS file %s\n\
-\tspecified on line %d of output file list %s",outfile,i+1,datfile); 
-      }
-      /* Attempt to copy header */
-      if (fits_copy_header(infits,outfits,&status)) {
-	INCLOSE; OUTCLOSE; DATCLOSE;
-	errormsg("Failed to copy header from input file %s\n\
-\tto output file %s specified on line %d\n\
-\tof output file list %s",infile,outfile,i+1,datfile);
+      if (!feof(data_file)) {
+	DATCLOSE; errormsg("Problem reading file %s on line %d",datfile,i+1);
       }
-      /* Close this output FITS file */
-      OUTCLOSE;
-      i++;
+      DATCLOSE;
     }
-    if (!feof(data_file)) {
-      INCLOSE; DATCLOSE;
-      errormsg("Problem reading file %s on line %d",outfile,i+1);
-    }
-    DATCLOSE;
+    for (k=0; k<ntarg; k++) targ[k].src=0;
+  }
+
+  /* Serialise each source header once and attach targets to them */
+  if (!UVES_chprep(src,nsrc,targ,ntarg,&zero))
+    errormsg("Unknown error returned from UVES_chprep()");
+  for (k=0; k<ntarg; k++) targ[k].ok=0;
+  pool.targ=targ; pool.ntarg=ntarg; pool.verify=verify;
+
+  /* Decide how many worker threads to use. Only verification uses
+     CFITSIO, so it alone needs a thread-safe library */
+  nthread=thnum(nthread,ntarg);
+  if (nthread>1 && verify && !fits_is_reentrant()) {
+    warnmsg("CFITSIO library was not built to be thread-safe.\n\
+\tWriting output files one at a time");
+    nthread=1;
   }
-  /* Close the input FITS file */
-  INCLOSE;
+
+  /* Append headers to all output files */
+  if (!thpool_run(nthread,ntarg,UVES_chwork,&pool))
+    errormsg("Unknown error returned from thpool_run()");
+
+  /* Report failures in list order */
+  for (k=0; k<ntarg; k++) {
+    if (targ[k].ok) continue;
+    nfail++;
+    if (targ[k].line)
+      nferrormsg("Failed to copy header from input file %s\n\
+\tto output file %s specified on line %d\n\
+\tof %s %s",src[targ[k].src].file,targ[k].file,targ[k].line,
+		 (strncmp(mfile,"\0",1)) ? "manifest" : "output file list",
+		 datfile);
+    else nferrormsg("Failed to copy header from input file %s\n\
+\tto output file %s",src[targ[k].src].file,targ[k].file);
+  }
+
+  /* Clean up */
+  for (k=0; k<nsrc; k++) if (src[k].uniq==k) free(src[k].hb.buf);
+  free(zero); free(src); free(targ);
+
+  if (nfail) errormsg("Failed to copy header to %d of %d output files",nfail,
+		      ntarg);
 
   return 1;
 
@@ -0,0 +1,58 @@
+/***************************************************************************
+* Definitions, structures and function prototypes for UVES_COPYHEAD
+***************************************************************************/
+
+/* INCLUDE FILES */
+#include <stdio.h>
+#include <fitsio.h>
+#include <longnam.h>
+#include "charstr.h"
+
+/* DEFINITIONS */
+#define EXT 0
+#define FITSBLOCK 2880  /* Length of FITS logical record [bytes]           */
+#define FITSCARD 80     /* Length of FITS header card [bytes]              */
+#define NCHTARG 64      /* Initial size of growable list of target files   */
+#define NCHSRC 16       /* Initial size of growable list of source files   */
+#define INCLOSE  fits_close_file(infits,&status);
+#define OUTCLOSE  fits_close_file(outfits,&status);
+#define DATCLOSE  fclose(data_file);
+
+/* STRUCTURES */
+typedef struct HeadBuf {
+  char   *buf;          /* Serialised header, padded to whole FITS records */
+  char   *dat;          /* Zero-filled data unit (may be shared) */
+  size_t hlen;          /* Length of padded header [bytes] */
+  size_t dlen;          /* Length of padded data unit [bytes] */
+  int    ncard;         /* Number of header cards, excluding END */
+} headbuf;
+
+typedef struct CopyHeadSource {
+  char    file[NAMELEN]; /* Source FITS file name */
+  int     ext;          /* Extension number to copy header from */
+  int     line;         /* Line in manifest (0 if not from manifest) */
+  int     uniq;         /* Index of first source with same file and ext */
+  headbuf hb;           /* Serialised header (only set for unique sources) */
+} chsrc;
+
+typedef struct CopyHeadTarget {
+  char    file[NAMELEN]; /* Target FITS file name */
+  int     line;         /* Line in output list or manifest (0 if neither) */
+  int     src;          /* Index of source to copy header from */
+  int     ok;           /* Was header appended successfully? */
+  headbuf *hb;          /* Serialised header to append */
+} chtarg;
+
+typedef struct CopyHeadPool {
+  chtarg  *targ;        /* Array of targets */
+  int     ntarg;        /* Number of targets */
+  int     verify;       /* Verify each target with CFITSIO afterwards? */
+} chpool;
+
+/* FUNCTION PROTOTYPES */
+int UVES_chmanifest(char *mfile, chsrc **src, int *nsrc, chtarg **targ,
+		    int *ntarg);
+int UVES_chprep(chsrc *src, int nsrc, chtarg *targ, int ntarg, char **zero);
+int UVES_hdrappend(char *outfile, headbuf *hb, int verify);
+int UVES_hdrbuf(fitsfile *infits, char *infile, headbuf *hb);
+void UVES_chwork(void *arg, int k);
@@ -0,0 +1,74 @@
+/****************************************************************************
+* Append a serialised header and empty data unit as a new HDU at the end
+* of an existing, non-empty FITS file with a single O_APPEND write of the
+* header and (zero-filled) data unit together. The
+* target is only checked to start with a SIMPLE card and to be a whole
+* number of FITS records long. If verify is set, the target is then
+* reopened with CFITSIO to check that the new HDU can be read.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "UVES_copyhead.h"
+#include "error.h"
+
+int UVES_hdrappend(char *outfile, headbuf *hb, int verify) {
+
+  ssize_t  nw=0;
+  int      k=0;
+  int      fd=-1,hdunum=0,hdutype=0,nkeys=0,nmore=0,status=0;
+  char     simple[10]="\0";
+  struct   stat st;
+  struct   iovec iov[2];
+  fitsfile *outfits;
+
+  /* Open target and make sure it looks like a complete FITS file */
+  if ((fd=open(outfile,O_RDWR|O_APPEND))<0) {
+    nferrormsg("UVES_hdrappend(): Cannot open output FITS file %s",outfile);
+    return 0;
+  }
+  if (fstat(fd,&st) || !st.st_size || st.st_size%FITSBLOCK ||
+      pread(fd,simple,9,0)!=9 || strncmp(simple,"SIMPLE  =",9)) {
+    close(fd); nferrormsg("UVES_hdrappend(): File %s is not\n\
+\ta complete, non-empty FITS file",outfile); return 0;
+  }
+
+  /* Append header and data unit, resuming after any short write */
+  iov[0].iov_base=hb->buf; iov[0].iov_len=hb->hlen;
+  iov[1].iov_base=hb->dat; iov[1].iov_len=hb->dlen;
+  while (k<2) {
+    if ((nw=writev(fd,iov+k,2-k))<=0) {
+      close(fd); nferrormsg("UVES_hdrappend(): Failed to append header to\n\
+\toutput file %s",outfile); return 0;
+    }
+    while (k<2 && (size_t)nw>=iov[k].iov_len) { nw-=iov[k].iov_len; k++; }
+    if (k<2) { iov[k].iov_base=(char *)iov[k].iov_base+nw; iov[k].iov_len-=nw; }
+  }
+  if (close(fd)) {
+    nferrormsg("UVES_hdrappend(): Failed to append header to\n\
+\toutput file %s",outfile); return 0;
+  }
+
+  /* Optionally verify new HDU with CFITSIO */
+  if (verify) {
+    if (fits_open_file(&outfits,outfile,READONLY,&status)) {
+      nferrormsg("UVES_hdrappend(): Cannot open output FITS file %s\n\
+\tfor verification",outfile); return 0;
+    }
+    if (fits_get_num_hdus(outfits,&hdunum,&status) ||
+	fits_movabs_hdu(outfits,hdunum,&hdutype,&status) ||
+	fits_get_hdrspace(outfits,&nkeys,&nmore,&status) || nkeys!=hb->ncard) {
+      status=0; OUTCLOSE;
+      nferrormsg("UVES_hdrappend(): Verification of new HDU failed\n\
+\tin output file %s",outfile); return 0;
+    }
+    OUTCLOSE;
+  }
+
+  return 1;
+
+}
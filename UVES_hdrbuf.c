@@ -0,0 +1,87 @@
+/****************************************************************************
+* Serialise the current HDU header of an open FITS file, once, into a
+* buffer padded to a whole number of FITS records, and find the size of
+* the input HDU's data unit. The caller supplies the empty (zero-filled)
+* data unit written after the header, since it may be shared. The
+* header is converted exactly as fits_copy_header() does when copying
+* to a new extension: a primary header has its SIMPLE card replaced by
+* an IMAGE XTENSION card, gains PCOUNT and GCOUNT cards and loses its
+* EXTEND card and the standard FITS reference COMMENT cards.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "UVES_copyhead.h"
+#include "error.h"
+
+/* Append a card to the buffer, padding it with blanks */
+static void UVES_hdrcard(char *buf, int *ncard, char *card) {
+
+  size_t   len=strlen(card);
+
+  if (len>FITSCARD) len=FITSCARD;
+  memcpy(buf+(*ncard)*FITSCARD,card,len);
+  memset(buf+(*ncard)*FITSCARD+len,' ',FITSCARD-len);
+  (*ncard)++;
+
+}
+
+int UVES_hdrbuf(fitsfile *infits, char *infile, headbuf *hb) {
+
+  LONGLONG headstart=0,datastart=0,dataend=0;
+  int      nkeys=0,nmore=0,hdunum=0,naxis=0,status=0;
+  int      i=0;
+  char     card[FLEN_CARD]="\0";
+
+  hb->buf=hb->dat=NULL; hb->hlen=hb->dlen=0; hb->ncard=0;
+
+  /* Find number of cards, position of data unit and image dimension */
+  fits_get_hdu_num(infits,&hdunum);
+  if (fits_get_hdrspace(infits,&nkeys,&nmore,&status) ||
+      fits_get_hduaddrll(infits,&headstart,&datastart,&dataend,&status) ||
+      (hdunum==1 && fits_get_img_dim(infits,&naxis,&status))) {
+    nferrormsg("UVES_hdrbuf(): Cannot read header structure of HDU %d\n\
+\tin file %s",hdunum,infile); return 0;
+  }
+
+  /* Allocate padded buffer: allow for two extra cards and END */
+  hb->hlen=((size_t)(nkeys+3)*FITSCARD+FITSBLOCK-1)/FITSBLOCK*FITSBLOCK;
+  hb->dlen=(size_t)(dataend-datastart);
+  if ((hb->buf=(char *)malloc(hb->hlen))==NULL) {
+    nferrormsg("UVES_hdrbuf(): Cannot allocate memory for header\n\
+\tbuffer of length %ld",(long)hb->hlen); return 0;
+  }
+  memset(hb->buf,' ',hb->hlen);
+
+  /* Serialise the cards */
+  for (i=1; i<=nkeys; i++) {
+    if (fits_read_record(infits,i,card,&status)) {
+      free(hb->buf); hb->buf=NULL;
+      nferrormsg("UVES_hdrbuf(): Cannot read header card %d of HDU %d\n\
+\tin file %s",i,hdunum,infile); return 0;
+    }
+    if (hdunum==1) {
+      /* Convert primary header to image extension header */
+      if (i==1) {
+	UVES_hdrcard(hb->buf,&(hb->ncard),"XTENSION= 'IMAGE   '           / IMAGE extension");
+	continue;
+      }
+      if (i>3+naxis && (!strncmp(card,"EXTEND  ",8) ||
+	  !strncmp(card,"COMMENT   FITS (Flexible Image Transport System) format is",58) ||
+	  !strncmp(card,"COMMENT   and Astrophysics', volume 376, page 3",47)))
+	continue;
+      UVES_hdrcard(hb->buf,&(hb->ncard),card);
+      if (i==3+naxis) {
+	UVES_hdrcard(hb->buf,&(hb->ncard),"PCOUNT  =                    0 / number of random group parameters");
+	UVES_hdrcard(hb->buf,&(hb->ncard),"GCOUNT  =                    1 / number of random groups");
+      }
+    } else UVES_hdrcard(hb->buf,&(hb->ncard),card);
+  }
+  /* Terminate the header; the rest of the record is already blank.
+     Removing cards may have shortened it by whole records */
+  memcpy(hb->buf+hb->ncard*FITSCARD,"END",3);
+  hb->hlen=((size_t)(hb->ncard+1)*FITSCARD+FITSBLOCK-1)/FITSBLOCK*FITSBLOCK;
+
+  return 1;
+
+}
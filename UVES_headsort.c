@@ -9,7 +9,6 @@ UVES_headsort: Sort ESO/VLT UVES exposures based on header-card values
 #include <unistd.h>
 #include "UVES_headsort.h"
 #include "file.h"
-#include "memory.h"
 #include "error.h"
 
 /* Global declarations */
@@ -27,7 +26,8 @@ void usage(void) {
   fprintf(stderr,"\nBy Michael Murphy (http://astronomy.swin.edu.au/~mmurphy)\n\
 \nVersion: %4.2lf (19 Feb 2018)\n",VERSION);
 
-  fprintf(stderr,"\nUsage: %s [OPTIONS] [FITS file or list]\n", progname);
+  fprintf(stderr,"\nUsage: %s [OPTIONS] [FITS file or list | -watch DIR]\n",
+	  progname);
 
   fprintf(stderr, "\nOptions:\n\
   -a    = %4.1lf %4.1lf : Attached calibration period: Number of hours before\n\
@@ -48,6 +48,10 @@ void usage(void) {
                        science exposure.\n\
   -redscr           : Turn off reduction script writing.\n\
   -redstd           : Include standards in reduction scripts.\n\
+  -sof              : Write SOF files for individual reduction steps\n\
+                       directly instead of using uves_makesof.csh.\n\
+                       Scripts rewrite them with UVES_makesof, as\n\
+                       \"make redun\" removes them.\n\
   -tharfile = %s\n\
                     : Full absolute pathname of reference laboratory ThAr\n\
                        frame. Only needed if environment variable\n\
@@ -60,18 +64,71 @@ void usage(void) {
                     : Full absolute pathname of flux standard reference\n\
                        frame. Only needed if environment variable\n\
                        UVES_HEADSORT_FLSTFILE not set.\n\
+  -tmpldir DIR      : Directory containing templates (<name>%s) which\n\
+                       override the built-in reduction script templates.\n\
+  -tmpldump DIR     : Write built-in reduction script templates to DIR\n\
+                       and exit.\n\
   -info [opt. FILE] : Write a file containing header info. for FITS file list.\n\
+  -keep-going [opt. FILE] : Leave out FITS files whose headers cannot be\n\
+                       read or are not understood, listing each with the\n\
+                       reason in quarantine report FILE (default %s),\n\
+                       instead of stopping.\n\
   -list             : Write lists of relevant files for each science exposure.\n\
+  -manifest [opt. obj|run] : Write info., SOF and reduction script files as\n\
+                       records in a single indexed manifest file, %s,\n\
+                       in each object directory (obj, default) or in the\n\
+                       current directory for the whole run (run). Use\n\
+                       UVES_manifest to extract individual files.\n\
+  -stats [opt. text|json] : Write wall-clock and CPU time for each stage,\n\
+                       files and header bytes read, calibration frames\n\
+                       examined and selected, directories, links and files\n\
+                       written, and peak memory use to stderr as text\n\
+                       (default) or as a single JSON object.\n\
+  -trace FILE       : Write trace events (JSON, for chrome://tracing or\n\
+                       Perfetto) to FILE for each FITS header read, each\n\
+                       science exposure's calibration search, and the links\n\
+                       and files written for each science exposure.\n\
   -macmap [opt. FILE] : Write a file specifying the mapping of the science\n\
                         object directories and file indices between\n\
                         case-sensitive and case-insensitive operating systems,\n\
                         e.g. Mac and linux, that would have been used before\n\
                         upper-case object names were enforced in Version 0.40.\n\
+  -watch DIR        : Watch directory DIR for new FITS files instead of\n\
+                       reading a FITS file or list. Output for each science\n\
+                       exposure is written once its calibration period (-c\n\
+                       option) has closed. Stop with Ctrl-C (or SIGTERM) to\n\
+                       write output for all remaining science exposures.\n\
+                       Linux only; cannot be used with -manifest.\n\
+  -serve SOCKET     : Instead of writing output, answer calibration lookups\n\
+                       for the science exposures in the FITS file or list\n\
+                       over Unix domain socket SOCKET. Requests are lines\n\
+                       \"ARC <ARCFILE>\", \"PATH <file>\",\n\
+                       \"OBJ <object> <MJD1> <MJD2>\" or \"RELOAD\". New\n\
+                       files in the list are read when it changes, on\n\
+                       RELOAD or on SIGHUP, while lookups go on being\n\
+                       answered. Stop with Ctrl-C (or SIGTERM).\n\
+  -diag [opt. FILE] : Write every calibration search and reduction script\n\
+                       diagnostic as a line of JSON to FILE (default %s).\n\
+                       Otherwise only the first %d of each kind are\n\
+                       printed; all are counted, by kind and by object, in\n\
+                       a summary at the end of the run.\n\
+  -shard K N        : Read and match only shard K (1..N) of the FITS file\n\
+                       list, divided into N time ranges by the times in\n\
+                       the ESO archive file names, and write the results\n\
+                       to %s.K. Shards may be run on different nodes.\n\
+                       Each shard reports the calibration search\n\
+                       diagnostics (-diag) and statistics for the science\n\
+                       exposures in its own time range.\n\
+  -merge N          : Instead of reading a FITS file or list, merge shard\n\
+                       files %s.1..N from the current directory\n\
+                       and write output as for a single run. Run in the\n\
+                       directory where output is to be written. Only\n\
+                       reduction script diagnostics are reported.\n\
   -d                : Debug mode: search for errors associated with given\n\
                        files; don't create any direcories, links or files.\n\
   -h, -help         : Print this message.\n\n",
 	  NHRSACAL_B,NHRSACAL_F,NHRSCAL_B,NHRSCAL_F,NBIAS,NFLAT,NWAV,NORD,NFMT,NSTD,
-	  THARFILE,ATMOFILE,FLSTFILE);
+	  THARFILE,ATMOFILE,FLSTFILE,TMPLEXT,QUARFILE,MFSTFILE,DGFILE,DGNSHOW,SHARDFILE,SHARDFILE);
   exit(3);
 }
 
@@ -84,86 +141,138 @@ void usage(void) {
 
 int main(int argc, char *argv[]) {
 
-  int      debug=0,redscr=1,redstd=0,info=0,list=0,macmap=0;
-  int      nhdrs=0;  /* Number of headers = Number of FITS files */
-  int      ncal=0;   /* Maximum # calibrations selected of any type */
-  int      nscis=0;  /* Number of science frames found in list */
-  int      i=0;
-  char     infile[NAMELEN]="\0",infofile[NAMELEN]="\0",macmapfile[NAMELEN]="\0";
+  int      nmerge=0;
+  int      i=0,j=0;
+  char     infile[NAMELEN]="\0";
   char     buffer[LNGSTRLEN]="\0";
-  char     *tharfile=NULL,*atmofile=NULL,*flstfile=NULL;
-  char     *cptr=NULL;
+  char     *name=NULL,*text=NULL,*watchdir=NULL,*servefile=NULL;
+  char     *tracefile=NULL,*diagfile=NULL;
   FILE     *data_file=NULL;
-  calprd   cprd;    /* Structure holding calibration period info. */
-  header   *hdrs;   /* Array to contain all header info */
-  scihdr   *scis;   /* Array of sci. hdrs with info about associated cals. */
+  hsctx    ctx;     /* Headers, parameters and outputs of this run */
 
   /* Define the program name from the command line input */
   progname=((progname=strrchr(argv[0],'/'))==NULL) ? argv[0] : progname+1;
   /* Must be at least one argument */
   if (argc==1) usage();
-  /* Set reference file path names */
-  tharfile=((cptr=getenv("UVES_HEADSORT_THARFILE"))==NULL) ? THARFILE : cptr; 
-  atmofile=((cptr=getenv("UVES_HEADSORT_ATMOFILE"))==NULL) ? ATMOFILE : cptr; 
-  flstfile=((cptr=getenv("UVES_HEADSORT_FLSTFILE"))==NULL) ? FLSTFILE : cptr; 
-  strcpy(infofile,INFOFILE); strcpy(macmapfile,MACMAPFILE);
-  /* Initialize parameters */
-  if (!UVES_params_init(&cprd)) errormsg("Error returned from UVES_params_init()");
+  /* Initialize parameters and reference file path names */
+  if (!UVES_hsinit(&ctx)) errormsg("Error returned from UVES_hsinit()");
   /* Scan command line for options */
   while (++i<argc) {
-    if (!strcmp(argv[i],"-d")) debug=1; /* Enter debug mode */
+    if (!strcmp(argv[i],"-d")) ctx.debug=1; /* Enter debug mode */
     else if (!strcmp(argv[i],"-a")) {
-      if (sscanf(argv[++i],"%lf",&(cprd.nhrsacal_b))!=1) usage();
-      if (sscanf(argv[++i],"%lf",&(cprd.nhrsacal_f))!=1) usage();
+      if (sscanf(argv[++i],"%lf",&(ctx.cprd.nhrsacal_b))!=1) usage();
+      if (sscanf(argv[++i],"%lf",&(ctx.cprd.nhrsacal_f))!=1) usage();
     }
     else if (!strcmp(argv[i],"-c")) {
-      if (sscanf(argv[++i],"%lf",&(cprd.nhrscal_b))!=1) usage();
-      if (sscanf(argv[++i],"%lf",&(cprd.nhrscal_f))!=1) usage();
+      if (sscanf(argv[++i],"%lf",&(ctx.cprd.nhrscal_b))!=1) usage();
+      if (sscanf(argv[++i],"%lf",&(ctx.cprd.nhrscal_f))!=1) usage();
     }
     else if (!strcmp(argv[i],"-bias")) {
-      if (sscanf(argv[++i],"%d",&(cprd.nbias))!=1) usage();
+      if (sscanf(argv[++i],"%d",&(ctx.cprd.nbias))!=1) usage();
     }
     else if (!strcmp(argv[i],"-flat")) {
-      if (sscanf(argv[++i],"%d",&(cprd.nflat))!=1) usage();
+      if (sscanf(argv[++i],"%d",&(ctx.cprd.nflat))!=1) usage();
     }
     else if (!strcmp(argv[i],"-wav")) {
-      if (sscanf(argv[++i],"%d",&(cprd.nwav))!=1) usage();
+      if (sscanf(argv[++i],"%d",&(ctx.cprd.nwav))!=1) usage();
     }
     else if (!strcmp(argv[i],"-ord")) {
-      if (sscanf(argv[++i],"%d",&(cprd.nord))!=1) usage();
+      if (sscanf(argv[++i],"%d",&(ctx.cprd.nord))!=1) usage();
     }
     else if (!strcmp(argv[i],"-fmt")) {
-      if (sscanf(argv[++i],"%d",&(cprd.nfmt))!=1) usage();
+      if (sscanf(argv[++i],"%d",&(ctx.cprd.nfmt))!=1) usage();
     }
     else if (!strcmp(argv[i],"-std")) {
-      if (sscanf(argv[++i],"%d",&(cprd.nstd))!=1) usage();
-      if (!cprd.nstd) redstd=0;
+      if (sscanf(argv[++i],"%d",&(ctx.cprd.nstd))!=1) usage();
+      if (!ctx.cprd.nstd) ctx.redstd=0;
     }
     else if (!strcmp(argv[i],"-info")) {
-      info=1; if (i+1<argc && strncmp(argv[i+1],"-",1)) {
-	if (sscanf(argv[++i],"%s",infofile)!=1) usage();
+      ctx.info=1; if (i+1<argc && strncmp(argv[i+1],"-",1)) {
+	if (sscanf(argv[++i],"%s",ctx.infofile)!=1) usage();
       }
     }
     else if (!strcmp(argv[i],"-macmap")) {
-      macmap=1; if (i+1<argc && strncmp(argv[i+1],"-",1)) {
-	if (sscanf(argv[++i],"%s",macmapfile)!=1) usage();
+      ctx.macmap=1; if (i+1<argc && strncmp(argv[i+1],"-",1)) {
+	if (sscanf(argv[++i],"%s",ctx.macmapfile)!=1) usage();
       }
     }
-    else if (!strcmp(argv[i],"-list")) list=1;
-    else if (!strcmp(argv[i],"-redscr")) redscr=0;
-    else if (!strcmp(argv[i],"-redstd")) redstd=1;
+    else if (!strcmp(argv[i],"-manifest")) {
+      ctx.mfst.mode=MFST_OBJ; if (i+1<argc && strncmp(argv[i+1],"-",1)) {
+	if (!strcmp(argv[i+1],"obj")) i++;
+	else if (!strcmp(argv[i+1],"run")) { ctx.mfst.mode=MFST_RUN; i++; }
+      }
+    }
+    else if (!strcmp(argv[i],"-stats")) {
+      ctx.st.mode=HSST_TEXT; if (i+1<argc && strncmp(argv[i+1],"-",1)) {
+	if (!strcmp(argv[i+1],"text")) i++;
+	else if (!strcmp(argv[i+1],"json")) { ctx.st.mode=HSST_JSON; i++; }
+      }
+    }
+    else if (!strcmp(argv[i],"-trace")) {
+      if (++i>=argc || !strncmp((tracefile=argv[i]),"-",1))
+	errormsg("Must specify trace-event file name");
+    }
+    else if (!strcmp(argv[i],"-diag")) {
+      diagfile=DGFILE; if (i+1<argc && strncmp(argv[i+1],"-",1))
+	diagfile=argv[++i];
+    }
+    else if (!strcmp(argv[i],"-shard")) {
+      if (i+2>=argc || sscanf(argv[++i],"%d",&(ctx.shard))!=1 ||
+	  sscanf(argv[++i],"%d",&(ctx.nshard))!=1 || ctx.nshard<1 ||
+	  ctx.shard<1 || ctx.shard>ctx.nshard)
+	errormsg("Must specify shard K of N shards, with 1 <= K <= N");
+    }
+    else if (!strcmp(argv[i],"-merge")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&nmerge)!=1 || nmerge<1)
+	errormsg("Must specify number of shard files to merge");
+    }
+    else if (!strcmp(argv[i],"-keep-going")) {
+      ctx.keepgo=1; if (i+1<argc && strncmp(argv[i+1],"-",1)) {
+	if (sscanf(argv[++i],"%s",ctx.quarfile)!=1) usage();
+      }
+    }
+    else if (!strcmp(argv[i],"-list")) ctx.list=1;
+    else if (!strcmp(argv[i],"-redscr")) ctx.redscr=0;
+    else if (!strcmp(argv[i],"-redstd")) ctx.redstd=1;
+    else if (!strcmp(argv[i],"-sof")) ctx.sof=1;
     else if (!strcmp(argv[i],"-tharfile")) {
-      if (++i>=argc || (strrchr((tharfile=argv[i]),'/'))==NULL)
+      if (++i>=argc || (strrchr((ctx.tharfile=argv[i]),'/'))==NULL)
 	errormsg("Must specify full pathname of lab. ThAr frame");
     }
     else if (!strcmp(argv[i],"-atmofile")) {
-      if (++i>=argc || (strrchr((atmofile=argv[i]),'/'))==NULL)
+      if (++i>=argc || (strrchr((ctx.atmofile=argv[i]),'/'))==NULL)
 	errormsg("Must specify full pathname of reference Atmo. frame");
     }
     else if (!strcmp(argv[i],"-flstfile")) {
-      if (++i>=argc || (strrchr((flstfile=argv[i]),'/'))==NULL)
+      if (++i>=argc || (strrchr((ctx.flstfile=argv[i]),'/'))==NULL)
 	errormsg("Must specify full pathname of reference Flx. std. frame");
     }
+    else if (!strcmp(argv[i],"-tmpldir")) {
+      if (++i>=argc || !isdir((ctx.tmpldir=argv[i])))
+	errormsg("Must specify existing template directory");
+    }
+    else if (!strcmp(argv[i],"-watch")) {
+      if (++i>=argc || !isdir((watchdir=argv[i])))
+	errormsg("Must specify existing directory to watch");
+    }
+    else if (!strcmp(argv[i],"-serve")) {
+      if (++i>=argc || !strncmp((servefile=argv[i]),"-",1))
+	errormsg("Must specify socket file name to serve lookups on");
+    }
+    else if (!strcmp(argv[i],"-tmpldump")) {
+      if (++i>=argc || !isdir(argv[i]))
+	errormsg("Must specify existing directory for templates");
+      for (j=0; j<TT_NTMPL; j++) {
+	text=UVES_tmpldef(j,&name);
+	if (strlen(argv[i])+strlen(name)+strlen(TMPLEXT)+2>LNGSTRLEN)
+	  errormsg("Template directory name too long: %s",argv[i]);
+	sprintf(buffer,"%s/%s%s",argv[i],name,TMPLEXT);
+	if ((data_file=faskwopen("Template file?",buffer,4))==NULL)
+	  errormsg("Cannot open template file %s for writing",buffer);
+	fprintf(data_file,"%s",text); fclose(data_file);
+      }
+      exit(0);
+    }
     else if (!strcmp(argv[i],"-help") || !strcmp(argv[i],"-h")) usage();
     else if (!access(argv[i],R_OK)) {
       if (strlen(argv[i])<=NAMELEN) strcpy(infile,argv[i]);
@@ -171,179 +280,76 @@ int main(int argc, char *argv[]) {
     }
     else errormsg("File %s does not exist",argv[i]);
   }
-  /* Make sure an input file was specified */
-  if (!strncmp(infile,"\0",1)) usage();
-  /* Set any unset parameters */
-  if (!UVES_params_set(&cprd)) errormsg("Error returned from UVES_params_set()");
-
-  /* Check that the attached calibration period is shorter than the normal one */
-  if (cprd.nhrsacal_b>cprd.nhrscal_b || cprd.nhrsacal_f>cprd.nhrscal_f)
-    errormsg("Calibration period for attached wavelength calibrations\n\
-\t(currently -a %4.1lf %4.1lf) is outside normal calibration period\n\
-\t(currently -c %4.1lf %4.1lf).",cprd.nhrsacal_b,cprd.nhrsacal_f,
-	     cprd.nhrscal_b,cprd.nhrscal_f);
- 
-  /* Temporary warning message if number of standards requested is > 1 */
-  if (cprd.nstd>1) {
-    warnmsg("At present, there is no provision for selecting more\n\
-\tthan 1 standard exposure per science exposure. Continuing to run with\n\
-\tN=1 for the standard calibration files");
-    cprd.nstd=1;
-  }
-
-  /* Check the ThAr, Atmo and FlSt files for existence if required */
-  if (redscr) {
-    if (access(tharfile,R_OK))
-      warnmsg("ThAr laboratory frame\n\
-\t%s\n\tdoes not exist. Will write reduction preparation scripts regardless.",
-	      tharfile);
-    if (access(atmofile,R_OK))
-      warnmsg("Atmospheric line reference frame\n\
-\t%s\n\tdoes not exist. Will write reduction preparation scripts regardless.",
-	      atmofile);
-    if (access(flstfile,R_OK))
-      warnmsg("Flux standard reference frame\n\
-\t%s\n\tdoes not exist. Will write reduction preparation scripts regardless.",
-	      flstfile);
+  /* Start trace-event file if requested */
+  if (tracefile!=NULL && !UVES_hstropen(&(ctx.st),tracefile))
+    errormsg("Unknown error returned from UVES_hstropen()");
+
+  /* Start NDJSON diagnostics file if requested */
+  if (diagfile!=NULL && !UVES_hsdgopen(&(ctx.dg),diagfile))
+    errormsg("Unknown error returned from UVES_hsdgopen()");
+
+  /* Watch mode: read, match and write as frames arrive */
+  if (watchdir!=NULL) {
+    if (servefile!=NULL) errormsg("Cannot specify both -watch and -serve");
+    if (ctx.nshard || nmerge) errormsg("Cannot use -shard or -merge with -watch");
+    if (strncmp(infile,"\0",1))
+      errormsg("Cannot specify both an input file and -watch");
+    if (!UVES_hswatch(&ctx,watchdir))
+      errormsg("Unknown error returned from UVES_hswatch()");
+    UVES_hsdgrep(&(ctx.dg),stderr); UVES_hsstrep(&ctx,stderr);
+    UVES_hsfree(&ctx);
+    return 1;
   }
 
-  /* Check to make sure maximum number of calibrations requested is OK */
-  ncal=MAX(cprd.nbias,cprd.nflat); ncal=MAX(ncal,(MAX(cprd.nwav,cprd.nfmt)));
-  ncal=MAX(ncal,(MAX(cprd.nord,cprd.nstd)));
-  if (ncal>NCALMAX) errormsg("To many calibrations requested, %d.\n\
-\tIncrease NCALMAX in UVES_headsort.h");
+  if ((ctx.nshard || nmerge) && servefile!=NULL)
+    errormsg("Cannot use -shard or -merge with -serve");
+  if (ctx.nshard && nmerge) errormsg("Cannot specify both -shard and -merge");
 
-  /* Convert calibration periods to days */
-  cprd.ndsacal_f=cprd.nhrsacal_f/24.0; cprd.ndsacal_b=cprd.nhrsacal_b/24.0;
-  cprd.ndscal_f=cprd.nhrscal_f/24.0; cprd.ndscal_b=cprd.nhrscal_b/24.0;
-  
-  /* Open input file, see if it's a list of FITS files or a FITS file iself */
-  if ((data_file=faskropen("Valid input FITS file or list?",infile,5))
-      ==NULL) errormsg("Can not open file %s",infile);
-  
-  /* Read list of FITS file names from input file */
-  if ((cptr=fgets(buffer,LNGSTRLEN,data_file))==NULL) {
-    fclose(data_file); errormsg("Problem reading file %s on line %d",infile,1);
-  }
-
-  if (!strncmp(buffer,"SIMPLE  =",8)) {
-    /* Single file specified that looks suspiciously like a FITS file */
-    fclose(data_file); nhdrs=1;
-    /* Allocate memory for single header */
-    if (!(hdrs=(header *)malloc((size_t)(nhdrs*sizeof(header)))))
-      errormsg("Could not allocate memory for header array of size %d",nhdrs);
-    cptr=((cptr=strrchr(strcpy(hdrs[0].file,infile),'/'))==NULL) ?
-      hdrs[0].file : cptr+1; strcpy(hdrs[0].abfile,cptr);
+  /* Merge mode: headers and matches come from shard files */
+  if (nmerge) {
+    if (strncmp(infile,"\0",1))
+      errormsg("Cannot specify both an input file and -merge");
+    if (!UVES_hsshmerge(&ctx,nmerge))
+      errormsg("Unknown error returned from UVES_hsshmerge()");
   }
   else {
-    /* Check for absolute path names ... a weak check anyway */
-    if (strncmp(buffer,"/",1)) {
-      fclose(data_file);
-      errormsg("FITS file path invalid on line %d in file\n\
-\t%s.\n\tYou must use absolute path names - FITS file names must begin with '/'.",
-	       1,infile);
-    }
-    /* If not FITS file see if it is a list of valid FITS files instead */
-    i=1; while ((cptr=fgets(buffer,LNGSTRLEN,data_file))!=NULL) {
-      /* Check for absolute path names ... a weak check anyway */
-      if (strncmp(buffer,"/",1)) {
-	fclose(data_file);
-	errormsg("FITS file path invalid on line %d in file\n\
-\t%s.\n\tYou must use absolute path names - FITS file names must begin with '/'.",
-		 i+1,infile);
-      }
-      i++;
-    }
-    if (!feof(data_file)) {
-      fclose(data_file);
-      errormsg("Problem reading file %s on line %d",infile,i+1);
-    }
-    else {
-      rewind(data_file); nhdrs=i;
-    }
-
-    /* Allocate enough memory for headers */
-    if (!(hdrs=(header *)malloc((size_t)(nhdrs*sizeof(header)))))
-      errormsg("Could not allocate memory for header array of size %d",nhdrs);
-
-    /* Read in list names of FITS files */
-    for (i=0; i<nhdrs; i++) {
-      cptr=fgets(buffer,LNGSTRLEN,data_file);
-      if (sscanf(buffer,"%s",hdrs[i].file)!=1) {
-	fclose(data_file);
-	errormsg("Incorrect format in line %d of file %s",i,infile);
-      }
-      cptr=((cptr=strrchr(hdrs[i].file,'/'))==NULL) ? hdrs[i].file : cptr+1;
-      strcpy(hdrs[i].abfile,cptr);
-    }
-    fclose(data_file);
-    if (debug)
-      fprintf(stdout,"INFO: Input file %s read successfully ...\n",infile);
-  }
-
-  /* Read in headers from FITS files */
-  for (i=0; i<nhdrs; i++) {
-    if (!UVES_rfitshead(hdrs[i].file,&(hdrs[i])))
-      errormsg("Unknown error returned from UVES_rfitshead()");
-  }
-  if (debug) fprintf(stdout,"INFO: All FITS files read successfully ...\n");
-
-  /* Sort headers in order of increasing MJD */
-  qsort(hdrs,nhdrs,sizeof(header),qsort_mjd);
+    /* Make sure an input file was specified */
+    if (!strncmp(infile,"\0",1)) usage();
 
-  /* Go through list of headers and identify the science exposures and
-     allocate memory enough to hold info about them */
-  for (i=0; i<nhdrs; i++)
-    if (!strcmp(hdrs[i].typ,"sci")) nscis++;
-  if (!(scis=(scihdr *)malloc((size_t)(nscis*sizeof(scihdr)))))
-    errormsg("Could not allocate memory for science header array\n\
-\tof size %d.",nscis);
+    /* Read in and sort headers from FITS file or list */
+    if (!UVES_hsingest(&ctx,infile))
+      errormsg("Unknown error returned from UVES_hsingest()");
 
-  /* Write out header information output file if requested */
-  if (info) {
-    if (!UVES_wheadinfo(hdrs,nhdrs,infofile))
-      errormsg("Uknown error returned from UVES_wheadinfo()");
+    /* Identify calibration files most appropriate for science frames */
+    if (!UVES_hsmatch(&ctx))
+      errormsg("Unknown error returned from UVES_hsmatch()");
   }
 
-  /* Identify calibration files most appropriate for science frames */
-  if (!UVES_calsrch(hdrs,nhdrs,scis,nscis,&cprd,ncal))
-    errormsg("Unknown error returned from UVES_calsrch()");
-  if (debug) fprintf(stdout,"INFO: Search for relevant calibration frames \
-conducted successfully ...\n");
-
-  /* Create a list of relevant files for each science object */
-  if (list) {
-    if (!UVES_list(hdrs,nhdrs,scis,nscis))
-      errormsg("Unknown error returned from UVES_list()");
-    if (debug) fprintf(stdout,"INFO: Created lists of relevant files for each \
-object successfully ...\n");
-  }
-
-  /* Create a map of case-sensitive and case-insensitive object names
-     and file indices */
-  if (macmap) {
-    if (!UVES_Macmap(hdrs,nhdrs,scis,nscis))
-      errormsg("Unknown error returned from UVES_Macmap()");
-    if (debug)
-      fprintf(stdout,"INFO: Created map of case-sensitive vs. insensitive object\n\
-\tnames and file indices successfully ...\n");
+  /* Shard mode: write results for this shard for later merging */
+  if (ctx.nshard) {
+    if (!UVES_hsshwrite(&ctx))
+      errormsg("Unknown error returned from UVES_hsshwrite()");
+    UVES_hsdgrep(&(ctx.dg),stderr); UVES_hsstrep(&ctx,stderr);
+    UVES_hsfree(&ctx);
+    return 1;
   }
 
-  /* Create object subdirectories and symbolic links to FITS file,
-     appropriately named */
-  if (!debug) {
-    if (!UVES_link(hdrs,nhdrs,scis,nscis))
-      errormsg("Unknown error returned from UVES_link()");
+  /* Serve mode: answer calibration lookups instead of writing output */
+  if (servefile!=NULL) {
+    if (!UVES_hsserve(&ctx,servefile,infile))
+      errormsg("Unknown error returned from UVES_hsserve()");
+    UVES_hsdgrep(&(ctx.dg),stderr); UVES_hsstrep(&ctx,stderr);
+    UVES_hsfree(&ctx);
+    return 1;
   }
 
-  /* Write out MIDAS and CPL reduction scripts if required */
-  if (!debug && redscr) {
-    if (!UVES_wredscr(scis,nscis,redstd,tharfile,atmofile,flstfile))
-      errormsg("Unknown error returned from UVES_wredscr()");
-  }
+  /* Write out information files, links and reduction scripts */
+  if (!UVES_hsemit(&ctx))
+    errormsg("Unknown error returned from UVES_hsemit()");
 
-  /* Clean up */
-  free(hdrs); free(scis);
+  /* Report diagnostics and run statistics, then clean up */
+  UVES_hsdgrep(&(ctx.dg),stderr); UVES_hsstrep(&ctx,stderr);
+  UVES_hsfree(&ctx);
 
   return 1;
 
@@ -3,6 +3,7 @@
 ***************************************************************************/
 
 /* INCLUDE FILES */
+#include <pthread.h>
 #include <fitsio.h>
 #include <longnam.h>
 #include "charstr.h"
@@ -37,6 +38,117 @@
                         /* Default name for header info. output file */
 #define MACMAPFILE "UVES_headsort.macmap"
                         /* Default name for Macmap output file */
+#define MFSTFILE  "UVES_headsort.manifest"
+                        /* Name of manifest file(s) in run/object directories */
+#define QUARFILE  "UVES_headsort.quarantine"
+                        /* Default name for quarantine report file */
+#define SHARDFILE "UVES_headsort.shard"
+                        /* Name of shard files, to which .<K> is appended */
+#define SHARDMAGIC "#UVESSH"  /* Magic string on first line of shard files   */
+#define SHARDVERS  1    /* Version number of shard file format               */
+#define SHARDSLACK (1.0/24.0) /* Allowed difference between time in archive  */
+                        /*    file name and MJD in header [days]             */
+#define MFSTMAGIC "#UVESMF"  /* Magic string on first line of manifest files  */
+#define MFSTVERS   1    /* Version number of manifest file format            */
+#define MFSTTRLEN 30    /* Length of fixed-width trailer line in manifests   */
+#define MFSTNREC  8     /* Max. # records being assembled at once            */
+#define MFSTNFD   32    /* Max. # manifest files held open at once           */
+#define MFST_NONE  0    /* Write individual files (no manifest)              */
+#define MFST_OBJ   1    /* Write one manifest per object directory           */
+#define MFST_RUN   2    /* Write one manifest for whole run                  */
+#define EMIT_PEND  0    /* Science exposure not yet written to output        */
+#define EMIT_READY 1    /* Science exposure being written to output          */
+#define EMIT_DONE  2    /* Science exposure written to output                */
+#define DGS_MATCH  1    /* Cal. search diagnostics of sci. frame recorded    */
+#define DGS_EMIT   2    /* Red. script diagnostics of sci. frame recorded    */
+#define NHDRBLK   64    /* Headers allocated at a time when adding headers   */
+#define WATCHPOLL 60    /* Seconds between checks for closed cal. periods    */
+#define WATCHBUF 16384 /* Size of buffer for inotify events [bytes]          */
+#define WATCHLAG 600    /* Seconds allowed for frames started in a cal.      */
+                        /*    period to arrive after the period closes       */
+#define NSRVCLI   64    /* Max. # clients connected to query server          */
+#define SRVPOLL 1000    /* Milliseconds between checks for input list change */
+#define HSST_OFF   0    /* Don't report run statistics                       */
+#define HSST_TEXT  1    /* Report run statistics as text                     */
+#define HSST_JSON  2    /* Report run statistics as JSON                     */
+                        /* Stages timed for run statistics                   */
+#define HSST_INGEST 0   /* Reading FITS headers                              */
+#define HSST_SORT  1    /* Sorting headers by MJD                            */
+#define HSST_MATCH 2    /* Selecting calibrations                            */
+#define HSST_INFO  3    /* Writing header info., list and Macmap files       */
+#define HSST_LINK  4    /* Creating object directories, links, info and SOFs */
+#define HSST_REDSCR 5   /* Compiling templates, writing reduction scripts    */
+#define HSST_MFST  6    /* Writing manifest indices                          */
+#define HSST_NSTAGE 7   /* Number of stages                                  */
+#define DG_OVERLAP 0    /* Calibration frame overlaps science exposure       */
+#define DG_NOCAL   1    /* No calibrations of a type in calibration period   */
+#define DG_FEWCAL  2    /* Fewer calibrations of a type found than requested */
+#define DG_EMPTYSCR 3   /* Empty reduction script written                    */
+#define DG_NOSTD   4    /* Standards left out of reduction script            */
+#define DG_NCODE   5    /* Number of diagnostic codes                        */
+#define DGNSHOW    3    /* Number of diagnostics of each code printed in full*/
+#define DGFILE "UVES_headsort.diag"
+                        /* Default name for NDJSON diagnostics file */
+#define NSOFSTEP   8    /* Number of reduction steps with their own SOF file */
+#define NSOFREC (6*NCALMAX+18) /* Max. number of records in master SOF file  */
+#define TMPLEXT   ".tmpl"  /* Extension of template files in template dir.   */
+#define TMPLNEST  16    /* Max. nesting depth of sections in templates       */
+                        /* Reduction script templates                        */
+#define TT_PREPPRG 0    /* MIDAS reduction preparation script                */
+#define TT_PREPCPL 1    /* CPL reduction preparation script                  */
+#define TT_MASTPRG 2    /* MIDAS reduction master script                     */
+#define TT_MASTCPL 3    /* CPL reduction master script                       */
+#define TT_MAKE    4    /* Makefile for object directory                     */
+#define TT_REDPRG  5    /* MIDAS reduction script for single exposure        */
+#define TT_REDCPL  6    /* CPL reduction script for single exposure          */
+#define TT_NTMPL   7    /* Number of templates                               */
+                        /* Fields which may be referenced in templates       */
+#define TF_PROG    0    /* Program name                                      */
+#define TF_FILE    1    /* Name of file being written                        */
+#define TF_OBJ     2    /* Object name                                       */
+#define TF_CWL     3    /* Central wavelength                                */
+#define TF_IND     4    /* Science exposure index                            */
+#define TF_CI      5    /* _<cwl>_<ind>_                                     */
+#define TF_CIA     6    /* <cwl>_<ind>                                       */
+#define TF_BIN     7    /* Binning, e.g. 1x1                                 */
+#define TF_SWID    8    /* Slit width string                                 */
+#define TF_STD     9    /* Standard star name                                */
+#define TF_THAR   10    /* Laboratory ThAr frame                             */
+#define TF_ATMO   11    /* Reference atmospheric line frame                  */
+#define TF_FLST   12    /* Reference flux standards frame                    */
+#define TF_TOL    13    /* MIDAS wavelength calibration tolerance            */
+#define TF_TOLW   14    /* CPL final wavelength calibration tolerance        */
+#define TF_TOLC   15    /* CPL initial wavelength calibration tolerance      */
+#define TF_MINL   16    /* Minimum number of ThAr lines to search for        */
+#define TF_MAXL   17    /* Maximum number of ThAr lines to search for        */
+#define TF_MISS   18    /* Type of missing calibration (empty if none)       */
+#define TF_NOSTDR 19    /* Set if standards not requested                    */
+#define TF_NOSTD  20    /* Set if standards requested but none found         */
+#define TF_DOSTD  21    /* Set if standards to be reduced                    */
+#define TF_REDU   22    /* Prefix of MIDAS reduced science catalogue         */
+#define TF_RMGLOB 23    /* Glob for CPL intermediate products                */
+#define TF_ARM    24    /* Chip suffix (b, l or u)                           */
+#define TF_ARMU   25    /* Chip suffix in MIDAS table names (_, L or U)      */
+#define TF_CHIP   26    /* CPL chip name (blue, redl or redu)                */
+#define TF_CCD    27    /* CCD name (EEV or MIT)                             */
+#define TF_LREF   28    /* Reference line table suffix                       */
+#define TF_NORD   29    /* Number of orders pipeline is to find              */
+#define TF_DEG    30    /* Degree of CPL wavelength polynomial               */
+#define TF_PCOPT  31    /* CPL option for processing this chip only          */
+#define TF_CHARG  32    /* Chip argument for helper scripts                  */
+#define TF_SOF    33    /* Set if per-step SOF files already written         */
+#define TF_NFIELD 34    /* Number of template fields                         */
+                        /* Lists which may be looped over in templates       */
+#define TL_CHIP    0    /* Chips of the science exposure                     */
+#define TL_SCI     1    /* Science exposures of the object                   */
+#define TL_NLIST   2    /* Number of template lists                          */
+                        /* Template operation types                          */
+#define TO_LIT     0    /* Literal text                                      */
+#define TO_FIELD   1    /* Field value                                       */
+#define TO_IF      2    /* Section rendered if field is set                  */
+#define TO_NOT     3    /* Section rendered if field is not set              */
+#define TO_EACH    4    /* Section rendered for each item of list            */
+#define TO_END     5    /* End of section                                    */
 #define THARFILE  "/usr/local/uves/calib/uves/ech/cal/thargood_3.tfits"
                         /* Default path for laboratory ThAr frame */
 #define ATMOFILE  "/usr/local/uves/calib/uves/ech/cal/atmoexan.tfits"
@@ -69,6 +181,10 @@ typedef struct Header {
   char     mod[FLEN_KEYWORD];     /* Mode of observation (i.e. dichroic?)    */
   char     lnktrg[LNGSTRLEN];     /* Target for link                         */
   char     lnkpth[LNGSTRLEN];     /* Path for link to target                 */
+  int      emit;                  /* Output state of sci. frame (EMIT_*)     */
+  int      dgseen;                /* Diagnostics already recorded (DGS_*)    */
+  long     nbyte;                 /* Size of FITS headers read [bytes]       */
+  int      nhdu;                  /* Number of HDUs visited when read        */
 } header;
 
 typedef struct SciHdr {
@@ -117,17 +233,239 @@ typedef struct CalSrch {
   int      ind;         /* Index of cal. frame in array of headers           */
 } calsrch;
 
+typedef struct MfstRec {
+  long     off;         /* Byte offset of record contents in manifest        */
+  long     len;         /* Length of record contents [bytes]                 */
+  char     name[NAMELEN]; /* File name relative to manifest's directory      */
+} mfstrec;
+
+typedef struct MfstTrg {
+  int      nrec;        /* Number of records written to manifest             */
+  int      nrecmax;     /* Number of records allocated in index              */
+  int      last;        /* Counter value at last use (for closing old files) */
+  long     size;        /* Current size of manifest file [bytes]             */
+  char     file[NAMELEN]; /* Name of manifest file                           */
+  FILE     *fp;         /* Manifest file pointer, NULL when closed           */
+  mfstrec  *rec;        /* Index of records written to manifest              */
+} mfsttrg;
+
+typedef struct Manifest {
+  int      mode;        /* MFST_NONE, MFST_OBJ or MFST_RUN                   */
+  int      ntrg;        /* Number of manifest files                          */
+  int      ntrgmax;     /* Number of manifest files allocated                */
+  int      nfd;         /* Number of manifest files currently open           */
+  int      count;       /* Counter of records written                        */
+  long     nfile;       /* Number of output files (or records) written       */
+  long     nbyte;       /* Number of bytes in output files (or records)      */
+  mfsttrg  *trg;        /* Array of manifest files                           */
+  FILE     *rfp[MFSTNREC];  /* Memory streams for records being assembled    */
+  char     *rbuf[MFSTNREC]; /* Buffers holding records being assembled       */
+  size_t   rsize[MFSTNREC]; /* Sizes of records being assembled              */
+  char     rname[MFSTNREC][NAMELEN]; /* Names of records being assembled     */
+} manifest;
+
+typedef struct SofRec {
+  char     file[LNGSTRLEN]; /* Name of frame                                 */
+  char     tag[NAMELEN];    /* Classification tag of frame                   */
+  char     red[NAMELEN];    /* Reduction steps in which frame is used        */
+} sofrec;
+
+typedef struct TmplOp {
+  int      type;        /* Operation type (TO_*)                             */
+  int      arg;         /* Field or list index                               */
+  int      off;         /* Offset of literal text in template source         */
+  int      len;         /* Length of literal text                            */
+  int      end;         /* Index of operation ending this section            */
+} tmplop;
+
+typedef struct Tmpl {
+  int      nop;         /* Number of operations                              */
+  char     name[NAMELEN]; /* Template name                                   */
+  char     *text;       /* Template source                                   */
+  tmplop   *op;         /* Compiled operations                               */
+} tmpl;
+
+typedef struct TmplCtx {
+  int      val[TF_NFIELD];    /* Arena offsets of field values (-1=unset)   */
+  int      nitem[TL_NLIST];   /* Number of items in each list               */
+  int      nitemmax[TL_NLIST];/* Number of items allocated in each list     */
+  int      *item[TL_NLIST];   /* Arena offsets of field values of items     */
+  int      narena;            /* Number of bytes used in arena              */
+  int      narenamax;         /* Number of bytes allocated in arena         */
+  char     *arena;            /* Storage for field value strings            */
+} tmplctx;
+
+typedef struct TmplBuf {
+  long     n;           /* Number of bytes rendered                          */
+  long     nmax;        /* Number of bytes allocated                         */
+  char     *buf;        /* Rendered text                                     */
+} tmplbuf;
+
+typedef struct SrvCli {
+  int      fd;          /* Client socket, -1 if slot unused                  */
+  int      nin;         /* Number of bytes of incomplete request in in       */
+  int      wait;        /* Reload whose result client awaits, 0 if none      */
+  long     nout;        /* Number of bytes of response in out                */
+  long     noutmax;     /* Number of bytes allocated in out                  */
+  long     off;         /* Number of bytes of response already sent          */
+  char     in[VVVLNGSTRLEN]; /* Incomplete request line                      */
+  char     *out;        /* Response not yet sent                             */
+} srvcli;
+
+typedef struct HSStats {
+  int      mode;        /* HSST_OFF, HSST_TEXT or HSST_JSON                  */
+  int      stage;       /* Stage being timed, -1 if none                     */
+  int      ncall[HSST_NSTAGE]; /* Number of times each stage has run         */
+  double   wall[HSST_NSTAGE];  /* Wall-clock time spent in each stage [s]    */
+  double   cpu[HSST_NSTAGE];   /* CPU time spent in each stage [s]           */
+  double   wall0;       /* Wall-clock time at start of stage being timed [s] */
+  double   cpu0;        /* CPU time at start of stage being timed [s]        */
+  long     nread;       /* Number of FITS files read                         */
+  long     nbread;      /* Number of FITS header bytes read                  */
+  long     ncsexam;     /* Number of cal. frames examined in UVES_calsrch()  */
+  long     ncscand;     /* Number in cal. period with matching setting       */
+  long     ncssel;      /* Number selected                                   */
+  long     ndir;        /* Number of object directories created              */
+  long     nlink;       /* Number of symbolic links created                  */
+  FILE     *trfp;       /* Trace-event file, NULL if not tracing             */
+  double   trt0;        /* Wall-clock time at which tracing started [us]     */
+  int      ntrev;       /* Number of trace events written                    */
+} hsstats;
+
+typedef struct DGObj {
+  char     obj[FLEN_KEYWORD]; /* Object name                                 */
+  long     n[DG_NCODE]; /* Number of diagnostics of each code                */
+} dgobj;
+
+typedef struct HSDiag {
+  int      nshow;       /* Number of each code printed in full, <0 for all   */
+  int      nobj;        /* Number of objects with diagnostics                */
+  int      nobjmax;     /* Number of objects allocated                       */
+  int      last;        /* Index of object of last diagnostic                */
+  int      quiet;       /* Count diagnostics but do not print or write them  */
+  long     n[DG_NCODE]; /* Number of diagnostics of each code                */
+  FILE     *fp;         /* NDJSON file of all diagnostics, or NULL           */
+  dgobj    *objs;       /* Diagnostic counts for each object                 */
+} hsdiag;
+
+/* Context for running UVES_headsort as a library: UVES_hsinit() sets
+   defaults, UVES_hsingest() reads the headers, UVES_hsmatch() selects
+   the calibrations for each science exposure and UVES_hsemit() writes
+   the outputs. Matching and emitting may be repeated, with different
+   parameters, on the same set of headers, and UVES_hsadd() adds single
+   headers to the set as new frames arrive. All functions return 0 on
+   error, after printing a message, instead of exiting. The context
+   itself belongs to the caller; UVES_hsfree() releases the memory it
+   points to. Programs linking the library must define progname. */
+typedef struct HSCtx {
+  calprd   cprd;        /* Calibration period and numbers of calibrations    */
+  int      debug;       /* Debug mode: don't write links or files            */
+  int      redscr;      /* Write reduction scripts?                          */
+  int      redstd;      /* Include standards in reduction scripts?           */
+  int      sof;         /* Write SOF files for individual reduction steps?   */
+  int      info;        /* Write header info. file?                          */
+  int      list;        /* Write lists of relevant files?                    */
+  int      macmap;      /* Write Macmap files?                               */
+  int      nhdrs;       /* Number of headers = Number of FITS files          */
+  int      nhdrsmax;    /* Number of headers allocated                       */
+  int      nscis;       /* Number of science frames                          */
+  int      ncal;        /* Maximum # calibrations selected of any type       */
+  int      keepgo;      /* Quarantine unreadable frames instead of stopping? */
+  int      nquar;       /* Number of frames quarantined                      */
+  int      shard;       /* Shard of archive to match (1..nshard)             */
+  int      nshard;      /* Number of shards, 0 if not sharded                */
+  double   shlo;        /* MJD range of frames owned by this shard,          */
+  double   shhi;        /*    shlo <= MJD < shhi                             */
+  char     infofile[NAMELEN];   /* Name of header info. file                 */
+  char     macmapfile[NAMELEN]; /* Name of Macmap file                       */
+  char     quarfile[NAMELEN];   /* Name of quarantine report file            */
+  FILE     *quarfp;     /* Quarantine report, NULL until a frame is excluded */
+  char     *tharfile;   /* Reference laboratory ThAr frame                   */
+  char     *atmofile;   /* Reference atmospheric line frame                  */
+  char     *flstfile;   /* Flux standard reference frame                     */
+  char     *tmpldir;    /* Directory of overriding templates (or NULL)       */
+  double   tnow;        /* Emit only sci. frames whose forward cal. period   */
+                        /*    closed before this MJD (0=emit all)            */
+  manifest mfst;        /* Manifest for output files                         */
+  hsstats  st;          /* Run statistics                                    */
+  hsdiag   dg;          /* Diagnostics from calibration search and scripts   */
+  tmpl     *tmpls[TT_NTMPL]; /* Compiled reduction script templates          */
+  header   *hdrs;       /* Array of header info, sorted by MJD               */
+  scihdr   *scis;       /* Array of sci. hdrs with info about assoc. cals.   */
+} hsctx;
+
+/* Reload of the input list by the query server, run in its own thread
+   on a copy of the context being served */
+typedef struct SrvRl {
+  hsctx    ctx;         /* Copy of context, with new headers and matches     */
+  hsctx    *old;        /* Context being served, read only during reload     */
+  char     *infile;     /* Input FITS file or list                           */
+  int      *arc;        /* Index of new science exposures by ARCFILE         */
+  int      *pth;        /* Index of new science exposures by path            */
+  int      nadd;        /* Number of new files read                          */
+  int      ret;         /* 1 if reload succeeded, 0 if not                   */
+  int      gen;         /* Number of reloads started                         */
+  int      busy;        /* Reload in progress?                               */
+  int      thread;      /* Reload running in its own thread?                 */
+  int      fd[2];       /* Pipe written to when reload is done               */
+  pthread_t th;         /* Reload thread                                     */
+  char     reason[VLNGSTRLEN]; /* Reason for failure                         */
+} srvrl;
+
 /* FUNCTION PROTOTYPES */
 int qsort_calsrch(const void *csrch1, const void *csrch2);
 int qsort_mjd(const void *hdr1, const void *hdr2);
 int UVES_calsrch(header *hdrs, int nhdrs, scihdr *scis, int nscis,
-		 calprd *cprd, int ncal);
-int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis);
+		 calprd *cprd, int ncal, double mjdlo, double mjdhi,
+		 hsstats *st, hsdiag *dg);
+int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis, int sof,
+	      manifest *mfst, hsstats *st);
+int UVES_hsadd(hsctx *ctx, char *file);
+int UVES_hsemit(hsctx *ctx);
+void UVES_hsfree(hsctx *ctx);
+int UVES_hsinit(hsctx *ctx);
+int UVES_hsingest(hsctx *ctx, char *infile);
+int UVES_hsmatch(hsctx *ctx);
+int UVES_hsserve(hsctx *ctx, char *sockfile, char *infile);
+void UVES_hsstbeg(hsstats *st, int stage);
+void UVES_hsstend(hsstats *st);
+int UVES_hsstrep(hsctx *ctx, FILE *fp);
+int UVES_hstropen(hsstats *st, char *file);
+double UVES_hstrnow(hsstats *st);
+void UVES_hstrspan(hsstats *st, char *cat, char *name, char *file, double t0,
+		   char *fmt, ...);
+int UVES_hstrclose(hsstats *st);
+int UVES_hsquar(hsctx *ctx, char *file);
+void UVES_hstresc(FILE *fp, char *str);
+void UVES_hsdiag(hsdiag *dg, int code, char *type, char *obj, char *sci,
+		 char *cal, int nreq, int nfnd, char *fmt, ...);
+void UVES_hsdgclr(hsdiag *dg, int code);
+int UVES_hsdgopen(hsdiag *dg, char *file);
+int UVES_hsdgrep(hsdiag *dg, FILE *fp);
+void UVES_hsdgfree(hsdiag *dg);
+int UVES_hsshsel(hsctx *ctx, header *hdrs, int *nhdrs);
+int UVES_hsshwrite(hsctx *ctx);
+int UVES_hsshmerge(hsctx *ctx, int nshard);
+int UVES_hswatch(hsctx *ctx, char *dir);
 int UVES_list(header *hdrs, int nhdrs, scihdr *scis, int nscis);
 int UVES_Macmap(header *hdrs, int nhdrs, scihdr *scis, int nscis);
+int UVES_mfclose(manifest *mfst, FILE *fp);
+int UVES_mffinish(manifest *mfst);
+FILE *UVES_mfopen(manifest *mfst, char *query, char *filename);
 int UVES_params_init(calprd *cprd);
 int UVES_params_set(calprd *cprd);
 int UVES_rfitshead(char *infile, header *hdr);
+int UVES_sofsplit(sofrec *recs, int nrec, char *base, manifest *mfst);
+int UVES_tmpladd(tmplctx *ctx, int list);
+int UVES_tmplclear(tmplctx *ctx);
+tmpl *UVES_tmplcomp(char *name, char *text);
+char *UVES_tmpldef(int type, char **name);
+void UVES_tmplfree(tmpl *tp);
+int UVES_tmplitem(tmplctx *ctx, int list, int field, char *fmt, ...);
+tmpl *UVES_tmplload(int type, char *tmpldir);
+int UVES_tmplrend(tmpl *tp, tmplctx *ctx, tmplbuf *buf);
+int UVES_tmplset(tmplctx *ctx, int field, char *fmt, ...);
 int UVES_wheadinfo(header *hdrs, int ndrs, char *outfile);
-int UVES_wredscr(scihdr *scis, int nscis, int redstd, char *tharfile,
-		 char *atmofile, char *flstfile);
+int UVES_wredscr(scihdr *scis, int nscis, int redstd, int sof,
+		 char *tharfile, char *atmofile, char *flstfile, tmpl **tmpls,
+		 manifest *mfst, hsdiag *dg);
@@ -0,0 +1,80 @@
+/****************************************************************************
+* Read the header of a single FITS file and insert it into the
+* time-sorted headers held by a UVES_headsort context. A file already
+* held is re-read and replaced, unless it is a science exposure that
+* has already been written to output. Science frame information is
+* discarded, since it refers to headers by index, so UVES_hsmatch()
+* must be called before the next UVES_hsemit().
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "UVES_headsort.h"
+#include "error.h"
+
+int UVES_hsadd(hsctx *ctx, char *file) {
+
+  double   t0=0.0;
+  int      lo=0,hi=0,mid=0;
+  int      i=0;
+  char     *cptr=NULL;
+  header   hdr;
+  header   *hdrs=NULL;
+
+  /* Read header */
+  if (strlen(file)>=LNGSTRLEN) {
+    nferrormsg("UVES_hsadd(): File name too long:\n\t%s",file); return 0;
+  }
+  strcpy(hdr.file,file);
+  cptr=((cptr=strrchr(hdr.file,'/'))==NULL) ? hdr.file : cptr+1;
+  strcpy(hdr.abfile,cptr);
+  UVES_hsstbeg(&(ctx->st),HSST_INGEST); t0=UVES_hstrnow(&(ctx->st));
+  if (!UVES_rfitshead(hdr.file,&hdr)) {
+    if (ctx->keepgo) UVES_hsquar(ctx,hdr.file);
+    nferrormsg("UVES_hsadd(): Unknown error returned from UVES_rfitshead()");
+    return 0;
+  }
+  UVES_hstrspan(&(ctx->st),"ingest","rfitshead",hdr.file,t0,
+		"\"bytes\":%ld,\"hdus\":%d",hdr.nbyte,hdr.nhdu);
+  hdr.emit=EMIT_PEND; hdr.dgseen=0; ctx->st.nread++; ctx->st.nbread+=hdr.nbyte;
+  UVES_hsstend(&(ctx->st));
+
+  /* Remove any previous version of the same file */
+  for (i=0; i<ctx->nhdrs; i++) if (!strcmp(ctx->hdrs[i].file,file)) break;
+  if (i<ctx->nhdrs) {
+    if (ctx->hdrs[i].emit!=EMIT_PEND) {
+      warnmsg("UVES_hsadd(): File %s\n\thas already been written to output.\n\
+\tIgnoring new version",file); return 1;
+    }
+    memmove(&(ctx->hdrs[i]),&(ctx->hdrs[i+1]),
+	    (size_t)((ctx->nhdrs-i-1)*sizeof(header)));
+    ctx->nhdrs--;
+  }
+
+  /* Expand header array if necessary */
+  if (ctx->nhdrs==ctx->nhdrsmax) {
+    if (!(hdrs=(header *)realloc(ctx->hdrs,(size_t)((ctx->nhdrsmax+NHDRBLK)*
+						    sizeof(header))))) {
+      nferrormsg("UVES_hsadd(): Could not allocate memory for header\n\
+\tarray of size %d",ctx->nhdrsmax+NHDRBLK); return 0;
+    }
+    ctx->hdrs=hdrs; ctx->nhdrsmax+=NHDRBLK;
+  }
+
+  /* Insert header after all those with earlier or equal MJD */
+  lo=0; hi=ctx->nhdrs;
+  while (lo<hi) {
+    mid=(lo+hi)/2;
+    if (ctx->hdrs[mid].mjd<=hdr.mjd) lo=mid+1; else hi=mid;
+  }
+  memmove(&(ctx->hdrs[lo+1]),&(ctx->hdrs[lo]),
+	  (size_t)((ctx->nhdrs-lo)*sizeof(header)));
+  ctx->hdrs[lo]=hdr; ctx->nhdrs++;
+
+  /* Science frame information refers to headers by index */
+  if (ctx->scis!=NULL) { free(ctx->scis); ctx->scis=NULL; }
+  ctx->nscis=0;
+
+  return 1;
+
+}
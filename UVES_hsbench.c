@@ -0,0 +1,229 @@
+/****************************************************************************
+
+UVES_hsbench: Time each stage of UVES_headsort on a synthetic UVES
+archive of a given number of frames, reporting throughput and peak
+memory use in a fixed, machine-readable format.
+
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "UVES_headsort.h"
+#include "UVES_hsbench.h"
+#include "file.h"
+#include "error.h"
+
+/* Global declarations */
+char      *progname;
+
+/****************************************************************************
+* Print the usage message
+****************************************************************************/
+
+void usage(void) {
+
+  fprintf(stderr,"\n%s: Time each stage of UVES_headsort on a synthetic\n\
+\tUVES archive\n",progname);
+
+  fprintf(stderr,"\nBy Michael Murphy (http://astronomy.swin.edu.au/~mmurphy)\n\
+\nVersion: %4.2lf (19 Feb 2018)\n",VERSION);
+
+  fprintf(stderr,"\nUsage: %s [OPTIONS]\n",progname);
+
+  fprintf(stderr, "\nOptions:\n\
+  -h, -help        : Print this message.\n\
+  -n = %-7d     : Number of synthetic frames.\n\
+  -dir = %s\n\
+                   : Scratch directory. The archive is written to DIR/raw,\n\
+                         listed in DIR/synth.list, and UVES_headsort output\n\
+                         is written to DIR/out, which must not exist.\n\
+  -seed = %-4d      : Seed for synthetic archive.\n\
+  -reuse           : Use the archive already listed in DIR/synth.list\n\
+                         instead of writing a new one.\n\
+  -noheader        : Do not print the column header line.\n\
+\nOne line is printed for each stage: stage name, number of frames,\n\
+wall-clock time [s], frames per second, and peak resident memory of the\n\
+process so far [kB]. Stage \"total\" sums all stages after \"synth\".\n\n",
+	  NBENCH,BENCHDIR,BENCHSEED);
+  exit(3);
+}
+
+/****************************************************************************
+* Wall-clock time [s]
+****************************************************************************/
+
+double UVES_hsbtime(void) {
+
+  struct   timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (double)ts.tv_sec+1.e-9*(double)ts.tv_nsec;
+
+}
+
+/****************************************************************************
+* Print timing of one stage, with peak resident memory so far
+****************************************************************************/
+
+void UVES_hsbrep(char *stage, int nframes, double sec) {
+
+  long     rss=0;
+  struct   rusage ru;
+
+  getrusage(RUSAGE_SELF,&ru);
+  /* ru_maxrss is in bytes on Mac OS X, kB elsewhere */
+#ifdef __APPLE__
+  rss=ru.ru_maxrss/1024;
+#else
+  rss=ru.ru_maxrss;
+#endif
+  fprintf(stdout,"%-8s %8d %12.6lf %14.1lf %10ld\n",stage,nframes,sec,
+	  (sec>0.0) ? (double)nframes/sec : 0.0,rss);
+  fflush(stdout);
+
+}
+
+/****************************************************************************
+* The main program
+
+  Things to do:
+
+****************************************************************************/
+
+int main(int argc, char *argv[]) {
+
+  double   t=0.0,ttot=0.0;
+  int      nframes=NBENCH,seed=BENCHSEED,reuse=0,nohead=0,nhdrs=0;
+  int      i=0;
+  char     dir[PATH_MAX]="\0",rawdir[PATH_MAX]="\0",outdir[PATH_MAX]="\0";
+  char     listfile[PATH_MAX]="\0",buffer[LNGSTRLEN]="\0";
+  char     *bdir=BENCHDIR,*cptr=NULL;
+  FILE     *data_file=NULL;
+  header   *hdrs=NULL;
+  hsctx    ctx;
+
+  /* Define the program name from the command line input */
+  progname=((progname=strrchr(argv[0],'/'))==NULL) ? argv[0] : progname+1;
+  /* Scan command line for options */
+  while (++i<argc) {
+    if (!strcmp(argv[i],"-n")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&nframes)!=1 || nframes<1) usage();
+    }
+    else if (!strcmp(argv[i],"-dir")) {
+      if (++i>=argc) usage();
+      bdir=argv[i];
+    }
+    else if (!strcmp(argv[i],"-seed")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&seed)!=1) usage();
+    }
+    else if (!strcmp(argv[i],"-reuse")) reuse=1;
+    else if (!strcmp(argv[i],"-noheader")) nohead=1;
+    else if (!strcmp(argv[i],"-help") || !strcmp(argv[i],"-h")) usage();
+    else usage();
+  }
+
+  /* Set up scratch directory, using absolute path names throughout */
+  if (!isdir(bdir) && mkdir(bdir,DIR_PERM))
+    errormsg("Cannot create scratch directory %s",bdir);
+  if (realpath(bdir,dir)==NULL)
+    errormsg("Cannot resolve directory name %s",bdir);
+  sprintf(rawdir,"%s/raw",dir); sprintf(outdir,"%s/out",dir);
+  sprintf(listfile,"%s/synth.list",dir);
+  if (strlen(rawdir)>=LNGSTRLEN-NAMELEN)
+    errormsg("Scratch directory name too long: %s",dir);
+  if (isdir(outdir))
+    errormsg("Output directory %s\n\talready exists. Remove it first",outdir);
+  if (!nohead)
+    fprintf(stdout,"#stage   nframes      seconds       frames/s  maxrss_kB\n");
+
+  /* Write synthetic archive */
+  if (!reuse) {
+    if (!isdir(rawdir) && mkdir(rawdir,DIR_PERM))
+      errormsg("Cannot create directory %s",rawdir);
+    t=UVES_hsbtime();
+    if (!UVES_synth(rawdir,nframes,(unsigned long)seed,listfile))
+      errormsg("Unknown error returned from UVES_synth()");
+    UVES_hsbrep("synth",nframes,UVES_hsbtime()-t);
+  }
+
+  /* Stage 1: Read list of FITS files */
+  t=UVES_hsbtime();
+  if ((data_file=faskropen("List of synthetic FITS files?",listfile,4))==NULL)
+    errormsg("Cannot open file %s",listfile);
+  while (fgets(buffer,LNGSTRLEN,data_file)!=NULL) nhdrs++;
+  if (!nhdrs) errormsg("No FITS files listed in %s",listfile);
+  if (!(hdrs=(header *)malloc((size_t)(nhdrs*sizeof(header)))))
+    errormsg("Could not allocate memory for header array of size %d",nhdrs);
+  rewind(data_file);
+  for (i=0; i<nhdrs; i++) {
+    if (fgets(buffer,LNGSTRLEN,data_file)==NULL ||
+	sscanf(buffer,"%s",hdrs[i].file)!=1)
+      errormsg("Incorrect format in line %d of file %s",i+1,listfile);
+    cptr=((cptr=strrchr(hdrs[i].file,'/'))==NULL) ? hdrs[i].file : cptr+1;
+    strcpy(hdrs[i].abfile,cptr);
+  }
+  fclose(data_file);
+  t=UVES_hsbtime()-t; ttot+=t;
+  UVES_hsbrep("list",nhdrs,t);
+
+  /* Stage 2: Read headers */
+  t=UVES_hsbtime();
+  for (i=0; i<nhdrs; i++) {
+    if (!UVES_rfitshead(hdrs[i].file,&(hdrs[i])))
+      errormsg("Unknown error returned from UVES_rfitshead()");
+    hdrs[i].emit=EMIT_PEND; hdrs[i].dgseen=0;
+  }
+  t=UVES_hsbtime()-t; ttot+=t;
+  UVES_hsbrep("ingest",nhdrs,t);
+
+  /* Stage 3: Sort headers */
+  t=UVES_hsbtime();
+  qsort(hdrs,nhdrs,sizeof(header),qsort_mjd);
+  t=UVES_hsbtime()-t; ttot+=t;
+  UVES_hsbrep("sort",nhdrs,t);
+
+  /* Stage 4: Select calibrations */
+  if (!UVES_hsinit(&ctx)) errormsg("Unknown error returned from UVES_hsinit()");
+  ctx.hdrs=hdrs; ctx.nhdrs=ctx.nhdrsmax=nhdrs;
+  t=UVES_hsbtime();
+  if (!UVES_hsmatch(&ctx)) errormsg("Unknown error returned from UVES_hsmatch()");
+  t=UVES_hsbtime()-t; ttot+=t;
+  UVES_hsbrep("calsrch",nhdrs,t);
+
+  /* Stage 5: Create object directories and links */
+  if (mkdir(outdir,DIR_PERM) || chdir(outdir))
+    errormsg("Cannot create output directory %s",outdir);
+  for (i=0; i<ctx.nscis; i++) ctx.scis[i].hdr.emit=EMIT_READY;
+  t=UVES_hsbtime();
+  if (!UVES_link(ctx.hdrs,ctx.nhdrs,ctx.scis,ctx.nscis,ctx.sof,&(ctx.mfst),
+		 NULL))
+    errormsg("Unknown error returned from UVES_link()");
+  t=UVES_hsbtime()-t; ttot+=t;
+  UVES_hsbrep("link",nhdrs,t);
+
+  /* Stage 6: Compile templates and write reduction scripts */
+  t=UVES_hsbtime();
+  for (i=0; i<TT_NTMPL; i++)
+    if ((ctx.tmpls[i]=UVES_tmplload(i,ctx.tmpldir))==NULL)
+      errormsg("Unknown error returned from UVES_tmplload()");
+  if (!UVES_wredscr(ctx.scis,ctx.nscis,ctx.redstd,ctx.sof,ctx.tharfile,
+		    ctx.atmofile,ctx.flstfile,ctx.tmpls,&(ctx.mfst),
+		    &(ctx.dg)))
+    errormsg("Unknown error returned from UVES_wredscr()");
+  t=UVES_hsbtime()-t; ttot+=t;
+  UVES_hsbrep("wredscr",nhdrs,t);
+
+  UVES_hsbrep("total",nhdrs,ttot);
+
+  /* Clean up */
+  UVES_hsfree(&ctx);
+
+  return 1;
+
+}
@@ -0,0 +1,49 @@
+/***************************************************************************
+* Definitions, structures and function prototypes for UVES_HSBENCH
+***************************************************************************/
+
+/* INCLUDE FILES */
+#include <stdio.h>
+#include "charstr.h"
+
+/* DEFINITIONS */
+#define NBENCH     1000  /* Default number of synthetic frames              */
+#define BENCHDIR "UVES_hsbench.d" /* Default scratch directory              */
+#define BENCHSEED     1  /* Default seed for synthetic archive              */
+#define SYNMJD0 51800.0  /* MJD of first night of synthetic archive         */
+#define SYNNOBJ     400  /* Number of different synthetic science targets   */
+#define SYNNSTD       8  /* Number of different synthetic flux standards    */
+#define SYNNSET       8  /* Number of synthetic instrument settings         */
+#define SYNMAXSET     3  /* Max. number of settings used in a night         */
+#define SYNNBIAS      5  /* Number of biases per arm per night              */
+#define SYNNFLAT      5  /* Number of flats per setting per night           */
+#define SYNPATT     0.3  /* Probability of attached ThAr after science exp. */
+#define SYNOVHD    60.0  /* Overhead between exposures [s]                  */
+#define SYNNIGHT   0.42  /* Length of night [days]                          */
+#define SYNMORN    0.47  /* Start of morning calibrations after night [days]*/
+
+/* STRUCTURES */
+typedef struct SynSet {
+  char     mode[NAMELEN];  /* Instrument mode, e.g. DICHR#1 */
+  double   bwl;         /* Blue arm central wavelength [nm], 0 if unused */
+  double   rwl;         /* Red arm central wavelength [nm], 0 if unused  */
+  int      benc;        /* Nominal blue grating encoder value */
+  int      renc;        /* Nominal red grating encoder value  */
+} synset;
+
+typedef struct SynFrm {
+  double   mjd;         /* MJD of start of exposure */
+  double   et;          /* Exposure time [s] */
+  double   sw;          /* Slit width [arcsec] */
+  int      arm;         /* UVES arm: blue (0) or red (1) */
+  int      bin;         /* Binning factor in both directions */
+  int      enc;         /* Grating encoder value */
+  double   wl;          /* Central wavelength [nm] */
+  char     type[NAMELEN];  /* Value of HIERARCH ESO DPR TYPE */
+  char     catg[NAMELEN];  /* Value of HIERARCH ESO DPR CATG */
+  char     targ[NAMELEN];  /* Target name (science and standards only) */
+  char     mode[NAMELEN];  /* Instrument mode */
+} synfrm;
+
+/* FUNCTION PROTOTYPES */
+int UVES_synth(char *dir, int nframes, unsigned long seed, char *listfile);
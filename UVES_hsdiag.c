@@ -0,0 +1,158 @@
+/****************************************************************************
+* Diagnostics from the calibration search and reduction script writing.
+*
+* Large runs can produce tens of thousands of warnings, mostly the same
+* few kinds repeated for many science exposures. UVES_hsdiag() records
+* each one with a code (DG_*), the calibration type, object, science
+* and calibration file names, and the numbers of calibrations requested
+* and found. Only the first nshow of each code are printed in full; all
+* are counted, per code and per object, and UVES_hsdgrep() prints the
+* counts at the end of the run. If UVES_hsdgopen() has been called, every
+* diagnostic is also written as one line of JSON (NDJSON) to a file.
+*
+* A context may be matched and written out many times (watch and serve
+* modes). UVES_hsmatch() therefore clears the counts with UVES_hsdgclr()
+* so that they describe the latest match, and a science exposure whose
+* diagnostics were recorded by an earlier match or script writing (see
+* DGS_*) sets dg->quiet: its diagnostics are counted again but neither
+* printed nor written again.
+*
+* With a NULL hsdiag pointer, UVES_hsdiag() just prints the warning.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+static char *UVES_dgname[DG_NCODE]={"overlap","nocal","fewcal","emptyscr",
+				    "nostd"};
+static char *UVES_dgdesc[DG_NCODE]={
+  "Calibration frame overlaps science exposure",
+  "No calibrations of a type in calibration period",
+  "Fewer calibrations of a type found than requested",
+  "Empty reduction script written",
+  "Standards left out of reduction script"};
+
+/* Index of object in diagnostic counts, adding it if necessary */
+static int UVES_dgobj(hsdiag *dg, char *obj) {
+
+  int      n=0;
+  int      i=0;
+  dgobj    *objs=NULL;
+
+  if (dg->last>=0 && dg->last<dg->nobj && !strcmp(dg->objs[dg->last].obj,obj))
+    return dg->last;
+  for (i=0; i<dg->nobj; i++) if (!strcmp(dg->objs[i].obj,obj)) break;
+  if (i==dg->nobj) {
+    if (dg->nobj==dg->nobjmax) {
+      n=(dg->nobjmax) ? 2*dg->nobjmax : 64;
+      if (!(objs=(dgobj *)realloc(dg->objs,(size_t)(n*sizeof(dgobj)))))
+	return -1;
+      dg->objs=objs; dg->nobjmax=n;
+    }
+    memset(&(dg->objs[i]),0,sizeof(dgobj));
+    strncpy(dg->objs[i].obj,obj,FLEN_KEYWORD-1); dg->nobj++;
+  }
+
+  return (dg->last=i);
+
+}
+
+void UVES_hsdiag(hsdiag *dg, int code, char *type, char *obj, char *sci,
+		 char *cal, int nreq, int nfnd, char *fmt, ...) {
+
+  int      i=0;
+  char     msg[VVLNGSTRLEN]="\0";
+  va_list  ap;
+
+  /* Count diagnostic */
+  if (dg!=NULL) {
+    dg->n[code]++;
+    if ((i=UVES_dgobj(dg,obj))>=0) dg->objs[i].n[code]++;
+    if (dg->quiet) return;
+  }
+
+  /* Only format message if it is to be printed or written */
+  if (dg!=NULL && dg->fp==NULL && dg->nshow>=0 && dg->n[code]>dg->nshow)
+    return;
+  va_start(ap,fmt); vsnprintf(msg,VVLNGSTRLEN,fmt,ap); va_end(ap);
+
+  if (dg==NULL || dg->nshow<0 || dg->n[code]<=dg->nshow) {
+    warnmsg("%s",msg);
+    if (dg!=NULL && dg->n[code]==dg->nshow)
+      warnmsg("Further diagnostics of this kind (%s) are counted but not\n\
+\tprinted. See summary at end of run.",UVES_dgname[code]);
+  }
+
+  if (dg!=NULL && dg->fp!=NULL) {
+    fprintf(dg->fp,"{\"code\":\"%s\",\"type\":",UVES_dgname[code]);
+    UVES_hstresc(dg->fp,type); fprintf(dg->fp,",\"obj\":");
+    UVES_hstresc(dg->fp,obj); fprintf(dg->fp,",\"sci\":");
+    UVES_hstresc(dg->fp,sci); fprintf(dg->fp,",\"cal\":");
+    if (cal!=NULL) UVES_hstresc(dg->fp,cal);
+    else fprintf(dg->fp,"null");
+    fprintf(dg->fp,",\"requested\":%d,\"found\":%d,\"msg\":",nreq,nfnd);
+    UVES_hstresc(dg->fp,msg); fprintf(dg->fp,"}\n");
+  }
+
+}
+
+void UVES_hsdgclr(hsdiag *dg, int code) {
+
+  int      i=0;
+
+  dg->n[code]=0;
+  for (i=0; i<dg->nobj; i++) dg->objs[i].n[code]=0;
+
+}
+
+int UVES_hsdgopen(hsdiag *dg, char *file) {
+
+  if ((dg->fp=faskwopen("NDJSON diagnostics file?",file,4))==NULL) {
+    nferrormsg("UVES_hsdgopen(): Cannot open diagnostics file\n\t%s\n\
+\tfor writing",file); return 0;
+  }
+
+  return 1;
+
+}
+
+int UVES_hsdgrep(hsdiag *dg, FILE *fp) {
+
+  long     ntot=0,nobj=0;
+  int      i=0,j=0;
+
+  for (i=0; i<DG_NCODE; i++) ntot+=dg->n[i];
+  if (!ntot) return 1;
+
+  fprintf(fp,"DIAG: code         count  description\n");
+  for (i=0; i<DG_NCODE; i++)
+    if (dg->n[i]) fprintf(fp,"DIAG: %-9s %8ld  %s\n",UVES_dgname[i],dg->n[i],
+			  UVES_dgdesc[i]);
+  fprintf(fp,"DIAG: %-9s %8ld\n","total",ntot);
+  fprintf(fp,"DIAG: %-20s","object");
+  for (i=0; i<DG_NCODE; i++) fprintf(fp," %9s",UVES_dgname[i]);
+  fprintf(fp,"\n");
+  for (j=0; j<dg->nobj; j++) {
+    for (i=0,nobj=0; i<DG_NCODE; i++) nobj+=dg->objs[j].n[i];
+    if (!nobj) continue;
+    fprintf(fp,"DIAG: %-20s",dg->objs[j].obj);
+    for (i=0; i<DG_NCODE; i++) fprintf(fp," %9ld",dg->objs[j].n[i]);
+    fprintf(fp,"\n");
+  }
+  fflush(fp);
+
+  return 1;
+
+}
+
+void UVES_hsdgfree(hsdiag *dg) {
+
+  if (dg->fp!=NULL) { fclose(dg->fp); dg->fp=NULL; }
+  if (dg->objs!=NULL) { free(dg->objs); dg->objs=NULL; }
+  dg->nobj=dg->nobjmax=0; dg->last=-1;
+
+}
@@ -0,0 +1,157 @@
+/****************************************************************************
+* Write the outputs requested in a UVES_headsort context from the
+* results of the last call to UVES_hsmatch(): header info. file, file
+* lists, Macmap files, object directories with links, info and SOF
+* files, and reduction scripts. Reduction script templates are
+* compiled on first use and kept in the context for later calls.
+*
+* Science exposures already written by an earlier call are not written
+* again until UVES_hsmatch() is called outside watch mode. If ctx->tnow
+* is set, only those whose forward calibration period closed (allowing
+* WATCHLAG seconds for late frames) before MJD tnow are written;
+* per-object files are then rewritten to include them.
+****************************************************************************/
+
+#include <string.h>
+#include <unistd.h>
+#include "UVES_headsort.h"
+#include "error.h"
+
+/* Mark science exposures being written as done, and their reduction
+   script diagnostics as recorded, in both the science exposure and
+   header arrays */
+static void UVES_hsdone(hsctx *ctx) {
+
+  int      i=0,j=0;
+
+  for (i=0; i<ctx->nscis; i++) {
+    if (ctx->scis[i].hdr.emit!=EMIT_READY) continue;
+    ctx->scis[i].hdr.emit=EMIT_DONE;
+    if (ctx->redscr && !ctx->debug) ctx->scis[i].hdr.dgseen|=DGS_EMIT;
+    for (j=0; j<ctx->nhdrs; j++)
+      if (!strcmp(ctx->hdrs[j].file,ctx->scis[i].hdr.file)) {
+	ctx->hdrs[j].emit=EMIT_DONE;
+	ctx->hdrs[j].dgseen|=ctx->scis[i].hdr.dgseen&DGS_EMIT;
+      }
+  }
+
+}
+
+int UVES_hsemit(hsctx *ctx) {
+
+  int      nready=0;
+  int      i=0,j=0;
+
+  if (ctx->hdrs==NULL || ctx->scis==NULL) {
+    nferrormsg("UVES_hsemit(): Headers have not been read and matched");
+    return 0;
+  }
+
+  /* Select science exposures to be written */
+  for (i=0; i<ctx->nscis; i++) {
+    if (ctx->scis[i].hdr.emit!=EMIT_PEND) continue;
+    if (ctx->tnow>0.0 && ctx->scis[i].hdr.mjd+ctx->cprd.ndscal_f+
+	WATCHLAG/86400.0>ctx->tnow) continue;
+    ctx->scis[i].hdr.emit=EMIT_READY; nready++;
+  }
+  if (ctx->tnow>0.0 && !nready) return 1;
+
+  /* Check the ThAr, Atmo and FlSt files for existence and compile
+     reduction script templates if required and not done already */
+  if (ctx->redscr && ctx->tmpls[0]==NULL) {
+    UVES_hsstbeg(&(ctx->st),HSST_REDSCR);
+    if (access(ctx->tharfile,R_OK))
+      warnmsg("ThAr laboratory frame\n\
+\t%s\n\tdoes not exist. Will write reduction preparation scripts regardless.",
+	      ctx->tharfile);
+    if (access(ctx->atmofile,R_OK))
+      warnmsg("Atmospheric line reference frame\n\
+\t%s\n\tdoes not exist. Will write reduction preparation scripts regardless.",
+	      ctx->atmofile);
+    if (access(ctx->flstfile,R_OK))
+      warnmsg("Flux standard reference frame\n\
+\t%s\n\tdoes not exist. Will write reduction preparation scripts regardless.",
+	      ctx->flstfile);
+    for (j=0; j<TT_NTMPL; j++) {
+      if (ctx->tmpls[j]==NULL &&
+	  (ctx->tmpls[j]=UVES_tmplload(j,ctx->tmpldir))==NULL) {
+	nferrormsg("UVES_hsemit(): Unknown error returned from UVES_tmplload()");
+	return 0;
+      }
+    }
+    UVES_hsstend(&(ctx->st));
+  }
+
+  /* Write out header information output file if requested */
+  UVES_hsstbeg(&(ctx->st),HSST_INFO);
+  if (ctx->info) {
+    if (!UVES_wheadinfo(ctx->hdrs,ctx->nhdrs,ctx->infofile)) {
+      nferrormsg("UVES_hsemit(): Unknown error returned from UVES_wheadinfo()");
+      return 0;
+    }
+  }
+
+  /* Create a list of relevant files for each science object */
+  if (ctx->list) {
+    if (!UVES_list(ctx->hdrs,ctx->nhdrs,ctx->scis,ctx->nscis)) {
+      nferrormsg("UVES_hsemit(): Unknown error returned from UVES_list()");
+      return 0;
+    }
+    if (ctx->debug) fprintf(stdout,"INFO: Created lists of relevant files for \
+each object successfully ...\n");
+  }
+
+  /* Create a map of case-sensitive and case-insensitive object names
+     and file indices */
+  if (ctx->macmap) {
+    if (!UVES_Macmap(ctx->hdrs,ctx->nhdrs,ctx->scis,ctx->nscis)) {
+      nferrormsg("UVES_hsemit(): Unknown error returned from UVES_Macmap()");
+      return 0;
+    }
+    if (ctx->debug)
+      fprintf(stdout,"INFO: Created map of case-sensitive vs. insensitive object\n\
+\tnames and file indices successfully ...\n");
+  }
+
+  UVES_hsstend(&(ctx->st));
+
+  /* Nothing more to do in debug mode */
+  if (ctx->debug) { UVES_hsdone(ctx); return 1; }
+
+  /* Create object subdirectories and symbolic links to FITS file,
+     appropriately named */
+  UVES_hsstbeg(&(ctx->st),HSST_LINK);
+  if (!UVES_link(ctx->hdrs,ctx->nhdrs,ctx->scis,ctx->nscis,ctx->sof,
+		 &(ctx->mfst),&(ctx->st))) {
+    nferrormsg("UVES_hsemit(): Unknown error returned from UVES_link()");
+    return 0;
+  }
+  UVES_hsstend(&(ctx->st));
+
+  /* Write out MIDAS and CPL reduction scripts if required */
+  if (ctx->redscr) {
+    UVES_hsstbeg(&(ctx->st),HSST_REDSCR);
+    if (!UVES_wredscr(ctx->scis,ctx->nscis,ctx->redstd,ctx->sof,ctx->tharfile,
+		      ctx->atmofile,ctx->flstfile,ctx->tmpls,&(ctx->mfst),
+		      &(ctx->dg))) {
+      ctx->dg.quiet=0;
+      nferrormsg("UVES_hsemit(): Unknown error returned from UVES_wredscr()");
+      return 0;
+    }
+    UVES_hsstend(&(ctx->st));
+  }
+
+  /* Write indices of manifest files if required */
+  if (ctx->mfst.mode!=MFST_NONE) {
+    UVES_hsstbeg(&(ctx->st),HSST_MFST);
+    if (!UVES_mffinish(&(ctx->mfst))) {
+      nferrormsg("UVES_hsemit(): Unknown error returned from UVES_mffinish()");
+      return 0;
+    }
+    UVES_hsstend(&(ctx->st));
+  }
+  UVES_hsdone(ctx);
+
+  return 1;
+
+}
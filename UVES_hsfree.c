@@ -0,0 +1,41 @@
+/****************************************************************************
+* Release the memory held by a UVES_headsort context, including any
+* manifest state left behind by a failed UVES_hsemit(). Any trace-event
+* file, quarantine report and diagnostics file are finished and
+* closed. The context itself belongs to the caller and may be re-used
+* after UVES_hsinit().
+****************************************************************************/
+
+#include <stdlib.h>
+#include "UVES_headsort.h"
+
+void UVES_hsfree(hsctx *ctx) {
+
+  int      i=0;
+
+  if (ctx->hdrs!=NULL) { free(ctx->hdrs); ctx->hdrs=NULL; }
+  if (ctx->scis!=NULL) { free(ctx->scis); ctx->scis=NULL; }
+  ctx->nhdrs=ctx->nhdrsmax=ctx->nscis=0;
+  for (i=0; i<TT_NTMPL; i++) {
+    UVES_tmplfree(ctx->tmpls[i]); ctx->tmpls[i]=NULL;
+  }
+
+  /* Manifest files and records still open */
+  for (i=0; i<ctx->mfst.ntrg; i++) {
+    if (ctx->mfst.trg[i].fp!=NULL) fclose(ctx->mfst.trg[i].fp);
+    if (ctx->mfst.trg[i].rec!=NULL) free(ctx->mfst.trg[i].rec);
+  }
+  if (ctx->mfst.trg!=NULL) free(ctx->mfst.trg);
+  ctx->mfst.trg=NULL; ctx->mfst.ntrg=ctx->mfst.ntrgmax=ctx->mfst.nfd=0;
+  for (i=0; i<MFSTNREC; i++) {
+    if (ctx->mfst.rfp[i]!=NULL) fclose(ctx->mfst.rfp[i]);
+    if (ctx->mfst.rbuf[i]!=NULL) free(ctx->mfst.rbuf[i]);
+    ctx->mfst.rfp[i]=NULL; ctx->mfst.rbuf[i]=NULL;
+  }
+
+  /* Trace-event file, quarantine report and diagnostics */
+  UVES_hstrclose(&(ctx->st));
+  if (ctx->quarfp!=NULL) { fclose(ctx->quarfp); ctx->quarfp=NULL; }
+  UVES_hsdgfree(&(ctx->dg));
+
+}
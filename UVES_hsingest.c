@@ -0,0 +1,152 @@
+/****************************************************************************
+* Read the headers of a single FITS file, or of a list of FITS files,
+* into a UVES_headsort context and sort them in order of increasing
+* MJD. Any headers and science frame information already held by the
+* context are discarded.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+int UVES_hsingest(hsctx *ctx, char *infile) {
+
+  double   t0=0.0;
+  int      nhdrs=0;
+  int      i=0,n=0;
+  char     buffer[LNGSTRLEN]="\0";
+  char     *cptr=NULL;
+  FILE     *data_file=NULL;
+  header   *hdrs=NULL;
+
+  UVES_hsstbeg(&(ctx->st),HSST_INGEST);
+
+  /* Open input file, see if it's a list of FITS files or a FITS file iself */
+  if ((data_file=faskropen("Valid input FITS file or list?",infile,4))==NULL) {
+    nferrormsg("UVES_hsingest(): Can not open file %s",infile); return 0;
+  }
+
+  /* Read list of FITS file names from input file */
+  if ((cptr=fgets(buffer,LNGSTRLEN,data_file))==NULL) {
+    fclose(data_file);
+    nferrormsg("UVES_hsingest(): Problem reading file %s on line %d",infile,1);
+    return 0;
+  }
+
+  if (!strncmp(buffer,"SIMPLE  =",8)) {
+    /* Single file specified that looks suspiciously like a FITS file */
+    fclose(data_file); nhdrs=1;
+    /* Allocate memory for single header */
+    if (!(hdrs=(header *)malloc((size_t)(nhdrs*sizeof(header))))) {
+      nferrormsg("UVES_hsingest(): Could not allocate memory for header\n\
+\tarray of size %d",nhdrs); return 0;
+    }
+    cptr=((cptr=strrchr(strcpy(hdrs[0].file,infile),'/'))==NULL) ?
+      hdrs[0].file : cptr+1; strcpy(hdrs[0].abfile,cptr);
+  }
+  else {
+    /* Check for absolute path names ... a weak check anyway */
+    if (strncmp(buffer,"/",1)) {
+      fclose(data_file);
+      nferrormsg("UVES_hsingest(): FITS file path invalid on line %d in file\n\
+\t%s.\n\tYou must use absolute path names - FITS file names must begin with '/'.",
+		 1,infile); return 0;
+    }
+    /* If not FITS file see if it is a list of valid FITS files instead */
+    i=1; while ((cptr=fgets(buffer,LNGSTRLEN,data_file))!=NULL) {
+      /* Check for absolute path names ... a weak check anyway */
+      if (strncmp(buffer,"/",1)) {
+	fclose(data_file);
+	nferrormsg("UVES_hsingest(): FITS file path invalid on line %d in file\n\
+\t%s.\n\tYou must use absolute path names - FITS file names must begin with '/'.",
+		   i+1,infile); return 0;
+      }
+      i++;
+    }
+    if (!feof(data_file)) {
+      fclose(data_file);
+      nferrormsg("UVES_hsingest(): Problem reading file %s on line %d",infile,
+		 i+1); return 0;
+    }
+    rewind(data_file); nhdrs=i;
+
+    /* Allocate enough memory for headers */
+    if (!(hdrs=(header *)malloc((size_t)(nhdrs*sizeof(header))))) {
+      fclose(data_file);
+      nferrormsg("UVES_hsingest(): Could not allocate memory for header\n\
+\tarray of size %d",nhdrs); return 0;
+    }
+
+    /* Read in list names of FITS files */
+    for (i=0; i<nhdrs; i++) {
+      cptr=fgets(buffer,LNGSTRLEN,data_file);
+      if (sscanf(buffer,"%s",hdrs[i].file)!=1) {
+	fclose(data_file); free(hdrs);
+	nferrormsg("UVES_hsingest(): Incorrect format in line %d of file %s",
+		   i+1,infile); return 0;
+      }
+      cptr=((cptr=strrchr(hdrs[i].file,'/'))==NULL) ? hdrs[i].file : cptr+1;
+      strcpy(hdrs[i].abfile,cptr);
+    }
+    fclose(data_file);
+    if (ctx->debug)
+      fprintf(stdout,"INFO: Input file %s read successfully ...\n",infile);
+  }
+
+  /* In shard mode, read only the files this shard needs */
+  if (ctx->nshard) {
+    if (!UVES_hsshsel(ctx,hdrs,&nhdrs)) {
+      free(hdrs);
+      nferrormsg("UVES_hsingest(): Unknown error returned from UVES_hsshsel()");
+      return 0;
+    }
+    if (!nhdrs) {
+      free(hdrs);
+      nferrormsg("UVES_hsingest(): No FITS files for shard %d of %d",
+		 ctx->shard,ctx->nshard); return 0;
+    }
+  }
+
+  /* Read in headers from FITS files */
+  for (i=0,n=0; i<nhdrs; i++) {
+    t0=UVES_hstrnow(&(ctx->st));
+    if (!UVES_rfitshead(hdrs[i].file,&(hdrs[i]))) {
+      /* In keep-going mode, record the frame and leave it out */
+      if (ctx->keepgo && UVES_hsquar(ctx,hdrs[i].file)) continue;
+      free(hdrs);
+      nferrormsg("UVES_hsingest(): Unknown error returned from UVES_rfitshead()");
+      return 0;
+    }
+    UVES_hstrspan(&(ctx->st),"ingest","rfitshead",hdrs[i].file,t0,
+		  "\"bytes\":%ld,\"hdus\":%d",hdrs[i].nbyte,hdrs[i].nhdu);
+    hdrs[i].emit=EMIT_PEND; hdrs[i].dgseen=0; ctx->st.nbread+=hdrs[i].nbyte;
+    if (n<i) hdrs[n]=hdrs[i];
+    n++;
+  }
+  ctx->st.nread+=n; UVES_hsstend(&(ctx->st));
+  if (n<nhdrs) {
+    warnmsg("UVES_hsingest(): %d of %d FITS files could not be read and\n\
+\twere left out. They are listed in %s",nhdrs-n,nhdrs,ctx->quarfile);
+    if (!(nhdrs=n)) {
+      free(hdrs);
+      nferrormsg("UVES_hsingest(): No FITS files could be read"); return 0;
+    }
+  }
+  if (ctx->debug) fprintf(stdout,"INFO: All FITS files read successfully ...\n");
+
+  /* Sort headers in order of increasing MJD */
+  UVES_hsstbeg(&(ctx->st),HSST_SORT);
+  qsort(hdrs,nhdrs,sizeof(header),qsort_mjd);
+  UVES_hsstend(&(ctx->st));
+
+  /* Replace any previous headers, invalidating previous matches */
+  if (ctx->hdrs!=NULL) free(ctx->hdrs);
+  if (ctx->scis!=NULL) free(ctx->scis);
+  ctx->hdrs=hdrs; ctx->nhdrs=ctx->nhdrsmax=nhdrs;
+  ctx->scis=NULL; ctx->nscis=0;
+
+  return 1;
+
+}
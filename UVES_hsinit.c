@@ -0,0 +1,35 @@
+/****************************************************************************
+* Initialise a UVES_headsort context: no headers, default parameters and
+* output options, and reference file path names taken from the
+* environment if set
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "UVES_headsort.h"
+#include "error.h"
+
+int UVES_hsinit(hsctx *ctx) {
+
+  char     *cptr=NULL;
+
+  memset(ctx,0,sizeof(hsctx));
+  ctx->mfst.mode=MFST_NONE; ctx->redscr=1; ctx->st.stage=-1;
+  ctx->dg.nshow=DGNSHOW; ctx->dg.last=-1;
+  strcpy(ctx->infofile,INFOFILE); strcpy(ctx->macmapfile,MACMAPFILE);
+  strcpy(ctx->quarfile,QUARFILE);
+
+  /* Set reference file path names */
+  ctx->tharfile=((cptr=getenv("UVES_HEADSORT_THARFILE"))==NULL) ? THARFILE : cptr;
+  ctx->atmofile=((cptr=getenv("UVES_HEADSORT_ATMOFILE"))==NULL) ? ATMOFILE : cptr;
+  ctx->flstfile=((cptr=getenv("UVES_HEADSORT_FLSTFILE"))==NULL) ? FLSTFILE : cptr;
+
+  /* Initialize parameters */
+  if (!UVES_params_init(&(ctx->cprd))) {
+    nferrormsg("UVES_hsinit(): Error returned from UVES_params_init()");
+    return 0;
+  }
+
+  return 1;
+
+}
@@ -0,0 +1,107 @@
+/****************************************************************************
+* Identify the science exposures among the headers held by a
+* UVES_headsort context and select the calibration frames most
+* appropriate for each. May be called repeatedly, e.g. with different
+* calibration periods, without re-reading the headers. Unless ctx->tnow
+* is set (watch mode), every science exposure is then due to be written
+* again by the next call to UVES_hsemit().
+*
+* In shard mode, only the science exposures the shard owns are matched:
+* those near the edges of its time range are matched, with their full
+* calibration periods, by the shards which own them. The diagnostics
+* and statistics of the calibration search are therefore those of the
+* shard runs; a merge run has none.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include "UVES_headsort.h"
+#include "error.h"
+
+int UVES_hsmatch(hsctx *ctx) {
+
+  double   mjdlo=-DBL_MAX,mjdhi=DBL_MAX;
+  int      nscis=0;
+  int      i=0;
+  calprd   *cprd=&(ctx->cprd);
+  scihdr   *scis=NULL;
+
+  if (ctx->hdrs==NULL) {
+    nferrormsg("UVES_hsmatch(): No headers have been read"); return 0;
+  }
+  UVES_hsstbeg(&(ctx->st),HSST_MATCH);
+
+  /* Set any unset parameters */
+  if (!UVES_params_set(cprd)) {
+    nferrormsg("UVES_hsmatch(): Error returned from UVES_params_set()");
+    return 0;
+  }
+
+  /* Check that the attached calibration period is shorter than the normal one */
+  if (cprd->nhrsacal_b>cprd->nhrscal_b || cprd->nhrsacal_f>cprd->nhrscal_f) {
+    nferrormsg("UVES_hsmatch(): Calibration period for attached wavelength\n\
+\tcalibrations (currently -a %4.1lf %4.1lf) is outside normal calibration\n\
+\tperiod (currently -c %4.1lf %4.1lf).",cprd->nhrsacal_b,cprd->nhrsacal_f,
+	       cprd->nhrscal_b,cprd->nhrscal_f); return 0;
+  }
+
+  /* Temporary warning message if number of standards requested is > 1 */
+  if (cprd->nstd>1) {
+    warnmsg("At present, there is no provision for selecting more\n\
+\tthan 1 standard exposure per science exposure. Continuing to run with\n\
+\tN=1 for the standard calibration files");
+    cprd->nstd=1;
+  }
+
+  /* Check to make sure maximum number of calibrations requested is OK */
+  ctx->ncal=MAX(cprd->nbias,cprd->nflat);
+  ctx->ncal=MAX(ctx->ncal,(MAX(cprd->nwav,cprd->nfmt)));
+  ctx->ncal=MAX(ctx->ncal,(MAX(cprd->nord,cprd->nstd)));
+  if (ctx->ncal>NCALMAX) {
+    nferrormsg("UVES_hsmatch(): To many calibrations requested, %d.\n\
+\tIncrease NCALMAX in UVES_headsort.h",ctx->ncal); return 0;
+  }
+
+  /* Convert calibration periods to days */
+  cprd->ndsacal_f=cprd->nhrsacal_f/24.0; cprd->ndsacal_b=cprd->nhrsacal_b/24.0;
+  cprd->ndscal_f=cprd->nhrscal_f/24.0; cprd->ndscal_b=cprd->nhrscal_b/24.0;
+
+  /* Go through list of headers and identify the science exposures (only
+     those owned in shard mode) and allocate memory enough to hold info
+     about them */
+  if (ctx->nshard) { mjdlo=ctx->shlo; mjdhi=ctx->shhi; }
+  for (i=0; i<ctx->nhdrs; i++)
+    if (!strcmp(ctx->hdrs[i].typ,"sci") && ctx->hdrs[i].mjd>=mjdlo &&
+	ctx->hdrs[i].mjd<mjdhi) nscis++;
+  if (!(scis=(scihdr *)malloc((size_t)((MAX(nscis,1))*sizeof(scihdr))))) {
+    nferrormsg("UVES_hsmatch(): Could not allocate memory for science header\n\
+\tarray of size %d.",nscis); return 0;
+  }
+
+  /* Outside watch mode, a new match is written out afresh in full. The
+     diagnostic counts then describe this match and its output only */
+  for (i=DG_OVERLAP; i<=DG_FEWCAL; i++) UVES_hsdgclr(&(ctx->dg),i);
+  if (ctx->tnow<=0.0) {
+    for (i=0; i<ctx->nhdrs; i++) ctx->hdrs[i].emit=EMIT_PEND;
+    UVES_hsdgclr(&(ctx->dg),DG_EMPTYSCR); UVES_hsdgclr(&(ctx->dg),DG_NOSTD);
+  }
+
+  /* Identify calibration files most appropriate for science frames */
+  if (!UVES_calsrch(ctx->hdrs,ctx->nhdrs,scis,nscis,cprd,ctx->ncal,mjdlo,
+		    mjdhi,&(ctx->st),&(ctx->dg))) {
+    ctx->dg.quiet=0; free(scis);
+    nferrormsg("UVES_hsmatch(): Unknown error returned from UVES_calsrch()");
+    return 0;
+  }
+  if (ctx->debug) fprintf(stdout,"INFO: Search for relevant calibration frames \
+conducted successfully ...\n");
+
+  /* Replace results of any previous match */
+  if (ctx->scis!=NULL) free(ctx->scis);
+  ctx->scis=scis; ctx->nscis=nscis;
+  UVES_hsstend(&(ctx->st));
+
+  return 1;
+
+}
@@ -0,0 +1,36 @@
+/****************************************************************************
+* Record a FITS file whose header could not be read in the quarantine
+* report of a UVES_headsort context (-keep-going option). Each line of
+* the report gives the file name and, after a tab, the reason it was
+* excluded: the last error message sent by nferrormsg(), on one line.
+* The report is only created once a file is quarantined.
+****************************************************************************/
+
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+int UVES_hsquar(hsctx *ctx, char *file) {
+
+  int      sp=0;
+  char     *cptr=NULL;
+
+  if (ctx->quarfp==NULL &&
+      (ctx->quarfp=faskwopen("Quarantine report file?",ctx->quarfile,4))==NULL) {
+    nferrormsg("UVES_hsquar(): Cannot open quarantine report file\n\t%s\n\
+\tfor writing",ctx->quarfile); return 0;
+  }
+
+  /* Write reason with runs of white space, including new lines, as
+     single spaces */
+  fprintf(ctx->quarfp,"%s\t",file);
+  for (cptr=nferrlast; *cptr; cptr++) {
+    if (*cptr==' ' || *cptr=='\t' || *cptr=='\n') sp=1;
+    else { if (sp) fputc(' ',ctx->quarfp); sp=0; fputc(*cptr,ctx->quarfp); }
+  }
+  fputc('\n',ctx->quarfp); fflush(ctx->quarfp);
+  ctx->nquar++;
+
+  return 1;
+
+}
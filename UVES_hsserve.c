@@ -0,0 +1,594 @@
+/****************************************************************************
+* Serve calibration lookups for the science exposures held by a
+* UVES_headsort context over a Unix domain socket. Headers and matches
+* stay in memory, so each lookup is a binary search. Clients are
+* multiplexed with poll() in a single thread. New files are read,
+* matched and indexed in a second thread, on a copy of the context, and
+* the copy is only served once it is complete, so lookups go on being
+* answered from the previous headers and matches meanwhile and never
+* see a half-updated index.
+*
+* Requests are single lines:
+*   ARC <ARCFILE>           <- Science exposure with this ARCFILE
+*   PATH <file>             <- Science exposure with this path name
+*   OBJ <object> <MJD1> <MJD2> <- Science exposures of object (case
+*                              insensitive) starting between MJD1 and MJD2
+*   RELOAD                  <- Read any new files in the input list
+* Responses are, for each science exposure found:
+*   SCI <file> <object> <cwl> <index> <MJD>
+*   <BIAS|FLAT|WAV|ORD|FMT|STD> <file> <MJD>  <- One per calibration
+* followed by "OK <number of science exposures>" (or, for RELOAD, the
+* number of headers held), or a single line "ERR <message>". RELOAD is
+* answered once the input list has been re-read; the client's later
+* requests are answered after that.
+*
+* The input list is re-read when it changes, on RELOAD or on SIGHUP;
+* only files not already held are read. If the list cannot be read, or
+* the new headers cannot be matched, the error is logged (and returned
+* for RELOAD) and the previous headers and matches go on being served.
+* SIGINT or SIGTERM stops the server and removes the socket. An existing
+* socket file is only replaced if no server is accepting connections
+* on it.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "UVES_headsort.h"
+#include "error.h"
+
+#define SRVCLOSE(C) close((C).fd); (C).fd=-1; (C).nin=(C).wait=0; \
+  (C).nout=(C).off=0;
+
+static volatile sig_atomic_t UVES_srvstop=0,UVES_srvhup=0;
+static scihdr *UVES_srvscis=NULL; /* Science exposures being sorted */
+
+/* Signal handlers: stop serving, or re-read input list */
+static void UVES_srvsig(int sig) {
+
+  if (sig==SIGHUP) UVES_srvhup=1;
+  else UVES_srvstop=1;
+
+}
+
+/* Qsort routines for indices of science exposures by ARCFILE and path */
+static int UVES_srvcmparc(const void *i1, const void *i2) {
+
+  return strcmp(UVES_srvscis[*(int *)i1].hdr.dat,
+		UVES_srvscis[*(int *)i2].hdr.dat);
+
+}
+
+static int UVES_srvcmppth(const void *i1, const void *i2) {
+
+  return strcmp(UVES_srvscis[*(int *)i1].hdr.file,
+		UVES_srvscis[*(int *)i2].hdr.file);
+
+}
+
+/* Sort indices of science exposures by ARCFILE and by path */
+static int UVES_srvindex(hsctx *ctx, int **arc, int **pth) {
+
+  int      i=0;
+
+  if (*arc!=NULL) free(*arc);
+  if (*pth!=NULL) free(*pth);
+  *arc=*pth=NULL;
+  if ((*arc=(int *)malloc((size_t)((MAX(ctx->nscis,1))*sizeof(int))))==NULL ||
+      (*pth=(int *)malloc((size_t)((MAX(ctx->nscis,1))*sizeof(int))))==NULL) {
+    nferrormsg("UVES_hsserve(): Cannot allocate memory for index arrays\n\
+\tof size %d",ctx->nscis); return 0;
+  }
+  for (i=0; i<ctx->nscis; i++) (*arc)[i]=(*pth)[i]=i;
+  UVES_srvscis=ctx->scis;
+  qsort(*arc,ctx->nscis,sizeof(int),UVES_srvcmparc);
+  qsort(*pth,ctx->nscis,sizeof(int),UVES_srvcmppth);
+
+  return 1;
+
+}
+
+/* Find science exposure by ARCFILE (pth=0) or path (pth=1) */
+static int UVES_srvfind(hsctx *ctx, int *idx, char *key, int pth) {
+
+  int      lo=0,hi=0,mid=0,cmp=0;
+
+  hi=ctx->nscis-1;
+  while (lo<=hi) {
+    mid=(lo+hi)/2;
+    cmp=strcmp(key,(pth) ? ctx->scis[idx[mid]].hdr.file :
+	       ctx->scis[idx[mid]].hdr.dat);
+    if (!cmp) return idx[mid];
+    if (cmp<0) hi=mid-1; else lo=mid+1;
+  }
+
+  return -1;
+
+}
+
+/* Qsort and bsearch routine for pointers to file names */
+static int UVES_srvcmpstr(const void *s1, const void *s2) {
+
+  return strcmp(*(char **)s1,*(char **)s2);
+
+}
+
+/* Copy the context being served before reading new files into it,
+   since UVES_hsadd() discards the matches */
+static int UVES_srvcopy(srvrl *rl) {
+
+  if (rl->ctx.hdrs!=NULL) return 1;
+  rl->ctx=*(rl->old); rl->ctx.scis=NULL; rl->ctx.nscis=0;
+  if ((rl->ctx.hdrs=(header *)malloc((size_t)((MAX(rl->old->nhdrsmax,1))*
+					      sizeof(header))))==NULL)
+    return 0;
+  memcpy(rl->ctx.hdrs,rl->old->hdrs,(size_t)(rl->old->nhdrs*sizeof(header)));
+
+  return 1;
+
+}
+
+/* Read any files in input list which are not already held into a copy
+   of the context being served, then match and index them. Held files
+   are found by binary search in a sorted list of their paths. If the
+   list cannot be read or the new headers cannot be matched or indexed,
+   the reason is logged and written to rl->reason and rl->ret is set to
+   0 so that the previous headers and matches go on being served */
+static void UVES_srvreload(srvrl *rl) {
+
+  int      i=0;
+  char     buffer[LNGSTRLEN]="\0",file[LNGSTRLEN]="\0";
+  char     *key=file;
+  char     **held=NULL;
+  FILE     *data_file=NULL;
+  hsctx    *old=rl->old;
+
+  rl->ret=1; rl->nadd=0;
+  if ((data_file=fopen(rl->infile,"r"))==NULL) {
+    snprintf(rl->reason,VLNGSTRLEN,"Cannot open input list %s",rl->infile);
+    nferrormsg("UVES_hsserve(): %s",rl->reason); rl->ret=0; return;
+  }
+  if (fgets(buffer,LNGSTRLEN,data_file)!=NULL &&
+      !strncmp(buffer,"SIMPLE  =",8)) {
+    /* Single FITS file: re-read it */
+    fclose(data_file);
+    if ((rl->ret=UVES_srvcopy(rl))) {
+      if (!UVES_hsadd(&(rl->ctx),rl->infile))
+	warnmsg("UVES_hsserve(): Skipping file %s",rl->infile);
+      else rl->nadd++;
+    }
+  }
+  else if ((held=(char **)malloc((size_t)((MAX(old->nhdrs,1))*
+					  sizeof(char *))))==NULL) {
+    fclose(data_file); rl->ret=0;
+  }
+  else {
+    for (i=0; i<old->nhdrs; i++) held[i]=old->hdrs[i].file;
+    qsort(held,old->nhdrs,sizeof(char *),UVES_srvcmpstr);
+    rewind(data_file);
+    while (fgets(buffer,LNGSTRLEN,data_file)!=NULL) {
+      if (sscanf(buffer,"%s",file)!=1 || file[0]!='/') continue;
+      if (bsearch(&key,held,old->nhdrs,sizeof(char *),UVES_srvcmpstr)!=NULL)
+	continue;
+      if (!(rl->ret=UVES_srvcopy(rl))) break;
+      if (!UVES_hsadd(&(rl->ctx),file))
+	warnmsg("UVES_hsserve(): Skipping file %s",file);
+      else rl->nadd++;
+    }
+    fclose(data_file); free(held);
+  }
+  if (!rl->ret) {
+    snprintf(rl->reason,VLNGSTRLEN,"Cannot allocate memory to re-read %s",
+	     rl->infile);
+    nferrormsg("UVES_hsserve(): %s",rl->reason); return;
+  }
+  if (!rl->nadd) return;
+
+  /* Match calibrations and index science exposures */
+  if (!UVES_hsmatch(&(rl->ctx))) {
+    snprintf(rl->reason,VLNGSTRLEN,"Cannot match calibrations for %d new \
+files from %s. Serving previous headers",rl->nadd,rl->infile);
+    nferrormsg("UVES_hsserve(): %s",rl->reason); rl->ret=0; return;
+  }
+  if (!UVES_srvindex(&(rl->ctx),&(rl->arc),&(rl->pth))) {
+    snprintf(rl->reason,VLNGSTRLEN,"Cannot index science exposures for %d \
+new files from %s. Serving previous headers",rl->nadd,rl->infile);
+    nferrormsg("UVES_hsserve(): %s",rl->reason); rl->ret=0; return;
+  }
+  if (old->debug)
+    fprintf(stdout,"INFO: Read %d new files from %s ...\n",rl->nadd,
+	    rl->infile);
+
+}
+
+/* Reload thread: reload, then wake the serving thread */
+static void *UVES_srvrlth(void *arg) {
+
+  srvrl    *rl=(srvrl *)arg;
+
+  UVES_srvreload(rl);
+  while (write(rl->fd[1],"R",1)<0 && errno==EINTR);
+
+  return NULL;
+
+}
+
+/* Start a reload of the input list in its own thread, or in this one if
+   no thread can be started */
+static void UVES_srvrlbeg(srvrl *rl, hsctx *ctx, char *infile) {
+
+  rl->old=ctx; rl->infile=infile; rl->ctx.hdrs=NULL; rl->arc=rl->pth=NULL;
+  rl->reason[0]='\0'; rl->gen++; rl->busy=1; rl->thread=1;
+  if (pthread_create(&(rl->th),NULL,UVES_srvrlth,rl)) {
+    warnmsg("UVES_hsserve(): Cannot start reload thread: reloading %s\n\
+\twhile not answering requests",infile);
+    rl->thread=0; UVES_srvrlth(rl);
+  }
+
+}
+
+/* Finish a reload: serve the new headers and matches if it succeeded,
+   otherwise discard them. Run statistics, diagnostics and quarantined
+   frames are kept either way. Returns rl->ret */
+static int UVES_srvrlend(srvrl *rl, hsctx *ctx, int **arc, int **pth) {
+
+  char     c='\0';
+
+  while (read(rl->fd[0],&c,1)<0 && errno==EINTR);
+  if (rl->thread) pthread_join(rl->th,NULL);
+  rl->busy=0;
+  if (rl->ctx.hdrs==NULL) return rl->ret;
+  if (rl->ret && rl->nadd) {
+    free(ctx->hdrs); if (ctx->scis!=NULL) free(ctx->scis);
+    free(*arc); free(*pth);
+    *ctx=rl->ctx; *arc=rl->arc; *pth=rl->pth;
+  }
+  else {
+    ctx->st=rl->ctx.st; ctx->dg=rl->ctx.dg; ctx->quarfp=rl->ctx.quarfp;
+    ctx->nquar=rl->ctx.nquar;
+    free(rl->ctx.hdrs); if (rl->ctx.scis!=NULL) free(rl->ctx.scis);
+    if (rl->arc!=NULL) free(rl->arc);
+    if (rl->pth!=NULL) free(rl->pth);
+  }
+  rl->ctx.hdrs=NULL; rl->arc=rl->pth=NULL;
+
+  return rl->ret;
+
+}
+
+/* Append formatted text to a client's response */
+static int UVES_srvprintf(srvcli *cli, char *fmt, ...) {
+
+  int      len=0;
+  char     *out=NULL;
+  va_list  ap;
+
+  va_start(ap,fmt); len=vsnprintf(NULL,0,fmt,ap); va_end(ap);
+  if (cli->nout+len+1>cli->noutmax) {
+    cli->noutmax=MAX(2*cli->noutmax,cli->nout+len+1);
+    if ((out=(char *)realloc(cli->out,(size_t)cli->noutmax))==NULL) {
+      nferrormsg("UVES_hsserve(): Cannot allocate memory for response\n\
+\tof size %ld",cli->noutmax); return 0;
+    }
+    cli->out=out;
+  }
+  va_start(ap,fmt); vsnprintf(cli->out+cli->nout,(size_t)(len+1),fmt,ap);
+  va_end(ap);
+  cli->nout+=len;
+
+  return 1;
+
+}
+
+/* Append a science exposure and its calibrations to a response */
+static int UVES_srvsci(srvcli *cli, hsctx *ctx, int i) {
+
+  int      j=0,k=0,n=0;
+  int      *ind=NULL;
+  scihdr   *sci=&(ctx->scis[i]);
+  static char *type[6]={"BIAS","FLAT","WAV","ORD","FMT","STD"};
+
+  if (!UVES_srvprintf(cli,"SCI %s %s %s %2.2d %.8lf\n",sci->hdr.file,
+		      sci->hdr.obj,sci->hdr.cwl,sci->sciind,sci->hdr.mjd))
+    return 0;
+  for (k=0; k<6; k++) {
+    switch (k) {
+    case 0: ind=sci->bind; n=sci->nb; break;
+    case 1: ind=sci->flind; n=sci->nfl; break;
+    case 2: ind=sci->wind; n=sci->nw; break;
+    case 3: ind=sci->oind; n=sci->no; break;
+    case 4: ind=sci->fmind; n=sci->nfm; break;
+    default: ind=sci->sind; n=sci->ns; break;
+    }
+    for (j=0; j<n; j++)
+      if (!UVES_srvprintf(cli,"%s %s %.8lf\n",type[k],ctx->hdrs[ind[j]].file,
+			  ctx->hdrs[ind[j]].mjd)) return 0;
+  }
+
+  return 1;
+
+}
+
+/* Answer a single request. RELOAD is answered when the reload which
+   starts after it has finished */
+static int UVES_srvreq(srvcli *cli, hsctx *ctx, char *req, srvrl *rl,
+		       int **arc, int **pth) {
+
+  double   mjd1=0.0,mjd2=0.0;
+  int      lo=0,hi=0,mid=0,n=0;
+  int      i=0;
+  char     cmd[NAMELEN]="\0",key[VVVLNGSTRLEN]="\0";
+
+  if (sscanf(req,"%63s",cmd)!=1) return 1;
+  if (!strcmp(cmd,"ARC") || !strcmp(cmd,"PATH")) {
+    if (sscanf(req,"%*s %s",key)!=1)
+      return UVES_srvprintf(cli,"ERR Usage: %s <name>\n",cmd);
+    if ((i=UVES_srvfind(ctx,(cmd[0]=='A') ? *arc : *pth,key,cmd[0]=='P'))<0)
+      return UVES_srvprintf(cli,"ERR No science exposure %s\n",key);
+    if (!UVES_srvsci(cli,ctx,i)) return 0;
+    return UVES_srvprintf(cli,"OK 1\n");
+  }
+  else if (!strcmp(cmd,"OBJ")) {
+    if (sscanf(req,"%*s %s %lf %lf",key,&mjd1,&mjd2)!=3)
+      return UVES_srvprintf(cli,"ERR Usage: OBJ <object> <MJD1> <MJD2>\n");
+    /* Science exposures are in order of increasing MJD */
+    lo=0; hi=ctx->nscis;
+    while (lo<hi) {
+      mid=(lo+hi)/2;
+      if (ctx->scis[mid].hdr.mjd<mjd1) lo=mid+1; else hi=mid;
+    }
+    for (i=lo; i<ctx->nscis && ctx->scis[i].hdr.mjd<=mjd2; i++) {
+      if (strcasecmp(ctx->scis[i].hdr.obj,key)) continue;
+      if (!UVES_srvsci(cli,ctx,i)) return 0;
+      n++;
+    }
+    return UVES_srvprintf(cli,"OK %d\n",n);
+  }
+  else if (!strcmp(cmd,"RELOAD")) {
+    UVES_srvhup=1; cli->wait=rl->gen+1;
+    return 1;
+  }
+
+  return UVES_srvprintf(cli,"ERR Unknown request %s\n",cmd);
+
+}
+
+/* Send as much of a client's response as the socket will take */
+static int UVES_srvflush(srvcli *cli) {
+
+  ssize_t  n=0;
+
+  while (cli->off<cli->nout) {
+    if ((n=send(cli->fd,cli->out+cli->off,(size_t)(cli->nout-cli->off),
+		MSG_NOSIGNAL))<0) {
+      if (errno==EAGAIN || errno==EWOULDBLOCK) return 1;
+      if (errno==EINTR) continue;
+      return 0;
+    }
+    cli->off+=n;
+  }
+  cli->nout=cli->off=0;
+
+  return 1;
+
+}
+
+/* Answer a client's complete requests, stopping after any RELOAD until
+   it has been answered */
+static int UVES_srvlines(srvcli *cli, hsctx *ctx, srvrl *rl, int **arc,
+			 int **pth) {
+
+  char     *cptr=NULL,*line=NULL;
+
+  cli->in[cli->nin]='\0';
+  line=cli->in;
+  while (!cli->wait && (cptr=strchr(line,'\n'))!=NULL) {
+    *cptr='\0'; if (cptr>line && *(cptr-1)=='\r') *(cptr-1)='\0';
+    if (!UVES_srvreq(cli,ctx,line,rl,arc,pth)) return 0;
+    line=cptr+1;
+  }
+  cli->nin-=line-cli->in;
+  memmove(cli->in,line,(size_t)cli->nin);
+  if (!cli->wait && cli->nin==VVVLNGSTRLEN-1) {
+    cli->nin=0;
+    if (!UVES_srvprintf(cli,"ERR Request too long\n")) return 0;
+  }
+
+  return 1;
+
+}
+
+/* Read from a client and answer any complete requests */
+static int UVES_srvread(srvcli *cli, hsctx *ctx, srvrl *rl, int **arc,
+			int **pth) {
+
+  ssize_t  n=0;
+
+  if ((n=read(cli->fd,cli->in+cli->nin,
+	      (size_t)(VVVLNGSTRLEN-1-cli->nin)))<=0) {
+    if (n<0 && (errno==EAGAIN || errno==EINTR)) return 1;
+    return 0;
+  }
+  cli->nin+=n;
+  if (!UVES_srvlines(cli,ctx,rl,arc,pth)) return -1;
+
+  return 1;
+
+}
+
+int UVES_hsserve(hsctx *ctx, char *sockfile, char *infile) {
+
+  int      lfd=-1,fd=-1,np=0,n=0,ret=1;
+  int      i=0,j=0;
+  int      *arc=NULL,*pth=NULL;
+  int      map[NSRVCLI+2];
+  time_t   tlast=0,mtime=0;
+  struct   stat st;
+  struct   sockaddr_un addr;
+  struct   pollfd pfd[NSRVCLI+2];
+  struct   sigaction sa,saint,saterm,sahup;
+  srvcli   cli[NSRVCLI];
+  srvrl    rl;
+
+  if (ctx->scis==NULL) {
+    nferrormsg("UVES_hsserve(): Headers have not been read and matched");
+    return 0;
+  }
+  if (!UVES_srvindex(ctx,&arc,&pth)) {
+    nferrormsg("UVES_hsserve(): Unknown error returned from UVES_srvindex()");
+    return 0;
+  }
+  if (!stat(infile,&st)) mtime=st.st_mtime;
+
+  /* Create and bind socket, replacing any stale socket file but not one
+     on which another server is still accepting connections */
+  if (strlen(sockfile)>=sizeof(addr.sun_path)) {
+    free(arc); free(pth);
+    nferrormsg("UVES_hsserve(): Socket file name too long:\n\t%s",sockfile);
+    return 0;
+  }
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family=AF_UNIX; strcpy(addr.sun_path,sockfile);
+  if (!lstat(sockfile,&st) && S_ISSOCK(st.st_mode)) {
+    if ((fd=socket(AF_UNIX,SOCK_STREAM,0))>=0 &&
+	!connect(fd,(struct sockaddr *)&addr,sizeof(addr))) {
+      close(fd); free(arc); free(pth);
+      nferrormsg("UVES_hsserve(): Socket %s\n\tis in use by another server",
+		 sockfile); return 0;
+    }
+    if (fd>=0 && errno==ECONNREFUSED) unlink(sockfile);
+    if (fd>=0) close(fd);
+  }
+  if ((lfd=socket(AF_UNIX,SOCK_STREAM,0))<0 ||
+      bind(lfd,(struct sockaddr *)&addr,sizeof(addr)) || listen(lfd,NSRVCLI)) {
+    if (lfd>=0) close(lfd);
+    free(arc); free(pth);
+    nferrormsg("UVES_hsserve(): Cannot listen on socket %s",sockfile);
+    return 0;
+  }
+  fcntl(lfd,F_SETFL,O_NONBLOCK);
+  memset(&rl,0,sizeof(srvrl));
+  if (pipe(rl.fd)) {
+    close(lfd); unlink(sockfile); free(arc); free(pth);
+    nferrormsg("UVES_hsserve(): Cannot create pipe for reloads"); return 0;
+  }
+  for (i=0; i<NSRVCLI; i++) {
+    cli[i].fd=-1; cli[i].nin=cli[i].wait=0;
+    cli[i].nout=cli[i].noutmax=cli[i].off=0; cli[i].out=NULL;
+  }
+
+  UVES_srvstop=UVES_srvhup=0;
+  memset(&sa,0,sizeof(sa));
+  sa.sa_handler=UVES_srvsig; sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT,&sa,&saint); sigaction(SIGTERM,&sa,&saterm);
+  sigaction(SIGHUP,&sa,&sahup);
+  if (ctx->debug)
+    fprintf(stdout,"INFO: Serving %d science exposures on %s ...\n",
+	    ctx->nscis,sockfile);
+
+  while (!UVES_srvstop) {
+
+    /* Re-read input list if requested or if it has changed, unless a
+       reload is already running: it is then re-read once that is done */
+    if (time(NULL)!=tlast) {
+      tlast=time(NULL);
+      if (!stat(infile,&st) && st.st_mtime!=mtime) {
+	mtime=st.st_mtime; UVES_srvhup=1;
+      }
+    }
+    if (UVES_srvhup && !rl.busy) {
+      UVES_srvhup=0; UVES_srvrlbeg(&rl,ctx,infile);
+    }
+
+    /* Wait for connections, requests, room to send responses, or the end
+       of a reload. Clients awaiting the result of a reload send no more
+       requests until it is answered */
+    pfd[0].fd=lfd; pfd[0].events=POLLIN; pfd[0].revents=0;
+    pfd[1].fd=rl.fd[0]; pfd[1].events=POLLIN; pfd[1].revents=0; np=2;
+    for (i=0; i<NSRVCLI; i++) {
+      if (cli[i].fd<0) continue;
+      pfd[np].fd=cli[i].fd; pfd[np].revents=0;
+      pfd[np].events=((cli[i].wait) ? 0 : POLLIN)|
+	((cli[i].nout>cli[i].off) ? POLLOUT : 0);
+      map[np++]=i;
+    }
+    if ((n=poll(pfd,np,SRVPOLL))<0) {
+      if (errno==EINTR) continue;
+      nferrormsg("UVES_hsserve(): Error waiting for requests"); ret=0; break;
+    }
+    if (!n) continue;
+
+    /* Serve the results of a finished reload and answer the clients
+       awaiting it */
+    if (pfd[1].revents&POLLIN) {
+      n=UVES_srvrlend(&rl,ctx,&arc,&pth);
+      for (i=0; i<NSRVCLI; i++) {
+	if (cli[i].fd<0 || !cli[i].wait || cli[i].wait>rl.gen) continue;
+	cli[i].wait=0;
+	if (!((n) ? UVES_srvprintf(&(cli[i]),"OK %d\n",ctx->nhdrs) :
+	      UVES_srvprintf(&(cli[i]),"ERR %s\n",rl.reason)) ||
+	    !UVES_srvlines(&(cli[i]),ctx,&rl,&arc,&pth)) { ret=0; break; }
+      }
+      if (!ret) break;
+    }
+
+    /* Accept new clients */
+    if (pfd[0].revents&POLLIN) {
+      while ((fd=accept(lfd,NULL,NULL))>=0) {
+	for (i=0; i<NSRVCLI && cli[i].fd>=0; i++);
+	if (i==NSRVCLI) {
+	  send(fd,"ERR Too many clients\n",21,MSG_NOSIGNAL); close(fd);
+	  continue;
+	}
+	fcntl(fd,F_SETFL,O_NONBLOCK); cli[i].fd=fd;
+      }
+    }
+
+    /* Serve existing clients */
+    for (j=2; j<np; j++) {
+      i=map[j];
+      if (cli[i].wait && (pfd[j].revents&(POLLHUP|POLLERR))) {
+	SRVCLOSE(cli[i]); continue;
+      }
+      if (pfd[j].revents&(POLLIN|POLLHUP|POLLERR)) {
+	if ((n=UVES_srvread(&(cli[i]),ctx,&rl,&arc,&pth))<0) {
+	  ret=0; break;
+	}
+	if (!n) { SRVCLOSE(cli[i]); continue; }
+      }
+      if (cli[i].nout>cli[i].off && !UVES_srvflush(&(cli[i]))) {
+	SRVCLOSE(cli[i]);
+      }
+    }
+    if (!ret) break;
+
+  }
+
+  /* Clean up, waiting for any reload still running */
+  if (rl.busy) UVES_srvrlend(&rl,ctx,&arc,&pth);
+  close(rl.fd[0]); close(rl.fd[1]);
+  for (i=0; i<NSRVCLI; i++) {
+    if (cli[i].fd>=0) close(cli[i].fd);
+    if (cli[i].out!=NULL) free(cli[i].out);
+  }
+  close(lfd); unlink(sockfile);
+  sigaction(SIGINT,&saint,NULL); sigaction(SIGTERM,&saterm,NULL);
+  sigaction(SIGHUP,&sahup,NULL);
+  free(arc); free(pth);
+  if (!ret) {
+    nferrormsg("UVES_hsserve(): Cannot continue serving requests"); return 0;
+  }
+
+  return 1;
+
+}
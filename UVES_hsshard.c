@@ -0,0 +1,350 @@
+/****************************************************************************
+* Time-sharded runs of UVES_headsort over several processes or nodes.
+*
+* The archive is divided into N time ranges, each holding about the same
+* number of frames. Shard K (1..N) owns the frames whose MJD lies in its
+* range. UVES_hsshsel() picks the files shard K must read: those in its
+* range widened by the calibration period (-c option) on either side, so
+* that every calibration frame any of its science exposures could use is
+* read. Frame times are taken from the ESO archive file names
+* (e.g. UVES.2000-09-13T00:05:05.997.fits), so that each shard reads only
+* its own headers; files whose names do not contain a time are read by
+* every shard. All shards compute the same ranges from the same list.
+*
+* After matching, UVES_hsshwrite() writes the headers shard K owns, its
+* science exposures and the calibration headers they use to
+* SHARDFILE.<K>. UVES_hsshmerge() reads all N shard files, joins the
+* owned headers into one MJD-sorted list, re-indexes the calibrations of
+* each science exposure into it and renumbers science exposures of each
+* object and setting across the whole archive. The context is then as
+* it would have been after UVES_hsmatch() on the whole archive, and
+* UVES_hsemit() writes identical output.
+*
+* Each shard matches only the science exposures it owns, so the
+* calibration search diagnostics and statistics of the whole archive are
+* those of the shard runs taken together. A merge run reports only the
+* diagnostics from writing reduction scripts.
+*
+* Shard files are binary and must be merged by the same build of
+* UVES_headsort which wrote them.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+#define FREESH if (hdrs!=NULL) free(hdrs); if (hrefs!=NULL) free(hrefs); \
+  if (scis!=NULL) free(scis);
+
+/* MJD of the date and time in an ESO archive file name, or -1 if the
+   name does not contain one */
+static double UVES_hsshmjd(char *name) {
+
+  double   sec=0.0;
+  long     jdn=0;
+  int      yr=0,mon=0,day=0,hr=0,min=0,a=0,n=0;
+  char     *cptr=NULL;
+
+  for (cptr=name; *cptr; cptr++) {
+    if (*cptr<'0' || *cptr>'9') continue;
+    n=0;
+    if (sscanf(cptr,"%4d-%2d-%2dT%2d:%2d:%lf%n",&yr,&mon,&day,&hr,&min,&sec,
+	       &n)==6 && n>=19 && mon>=1 && mon<=12 && day>=1 && day<=31) {
+      a=(14-mon)/12; yr+=4800-a; mon+=12*a-3;
+      jdn=day+(153*mon+2)/5+365L*yr+yr/4-yr/100+yr/400-32045;
+      return (double)(jdn-2400001)+(hr+min/60.0+sec/3600.0)/24.0;
+    }
+  }
+
+  return -1.0;
+
+}
+
+/* Compare two doubles for qsort() */
+static int UVES_hsshcmp(const void *d1, const void *d2) {
+
+  if (*(double *)d1>*(double *)d2) return 1;
+  else if (*(double *)d1==*(double *)d2) return 0;
+  else return -1;
+
+}
+
+/* Pointers to the calibration index arrays of a science exposure and
+   their lengths */
+static void UVES_hsshind(scihdr *sci, int **ind, int **nind) {
+
+  ind[0]=sci->bind; nind[0]=&(sci->nb); ind[1]=sci->flind; nind[1]=&(sci->nfl);
+  ind[2]=sci->wind; nind[2]=&(sci->nw); ind[3]=sci->oind; nind[3]=&(sci->no);
+  ind[4]=sci->fmind; nind[4]=&(sci->nfm); ind[5]=sci->sind; nind[5]=&(sci->ns);
+
+}
+
+/* Open a shard file and check its description against the shard
+   expected and, after the first shard, the calibration parameters of
+   the first. Returns the file positioned at the first header. */
+static FILE *UVES_hsshopen(hsctx *ctx, char *file, int k, int nshard,
+			   int *nown, int *nref, int *nsci) {
+
+  int      vers=0,szh=0,szs=0,shard=0,nsh=0;
+  char     magic[NAMELEN]="\0",buffer[LNGSTRLEN]="\0";
+  FILE     *fp=NULL;
+  calprd   cprd;
+
+  if ((fp=faskropen("Shard file?",file,4))==NULL) {
+    nferrormsg("UVES_hsshopen(): Cannot open shard file %s",file); return NULL;
+  }
+  if (fgets(buffer,LNGSTRLEN,fp)==NULL ||
+      sscanf(buffer,"%s %d %d %d %d %d %d %d %d",magic,&vers,&szh,&szs,&shard,
+	     &nsh,nown,nref,nsci)!=9 || strcmp(magic,SHARDMAGIC)) {
+    fclose(fp);
+    nferrormsg("UVES_hsshopen(): %s is not a shard file",file); return NULL;
+  }
+  if (vers!=SHARDVERS || szh!=(int)sizeof(header) || szs!=(int)sizeof(scihdr)) {
+    fclose(fp);
+    nferrormsg("UVES_hsshopen(): Shard file %s was written by a\n\
+\tdifferent version of UVES_headsort",file); return NULL;
+  }
+  if (shard!=k || nsh!=nshard) {
+    fclose(fp);
+    nferrormsg("UVES_hsshopen(): Shard file %s is for shard %d of %d,\n\
+\tnot shard %d of %d",file,shard,nsh,k,nshard); return NULL;
+  }
+  if (fread(&cprd,sizeof(calprd),1,fp)!=1) {
+    fclose(fp);
+    nferrormsg("UVES_hsshopen(): Problem reading shard file %s",file);
+    return NULL;
+  }
+  if (k==1) ctx->cprd=cprd;
+  else if (memcmp(&cprd,&(ctx->cprd),sizeof(calprd))) {
+    fclose(fp);
+    nferrormsg("UVES_hsshopen(): Shard file %s was written with different\n\
+\tcalibration parameters to %s.1",file,SHARDFILE); return NULL;
+  }
+
+  return fp;
+
+}
+
+int UVES_hsshsel(hsctx *ctx, header *hdrs, int *nhdrs) {
+
+  double   lo=0.0,hi=0.0,mjd=0.0;
+  double   *mjds=NULL;
+  int      nmjd=0,n=0;
+  int      i=0;
+
+  if (!(mjds=(double *)malloc((size_t)((MAX(*nhdrs,1))*sizeof(double))))) {
+    nferrormsg("UVES_hsshsel(): Could not allocate memory for MJD array\n\
+\tof size %d",*nhdrs); return 0;
+  }
+  for (i=0; i<*nhdrs; i++)
+    if ((mjds[nmjd]=UVES_hsshmjd(hdrs[i].abfile))>=0.0) nmjd++;
+  if (nmjd<ctx->nshard) {
+    free(mjds);
+    nferrormsg("UVES_hsshsel(): Only %d of %d files have archive file names\n\
+\tgiving their time; cannot divide them into %d shards",nmjd,*nhdrs,
+	       ctx->nshard); return 0;
+  }
+
+  /* Time range owned by this shard: equal numbers of frames per shard */
+  qsort(mjds,nmjd,sizeof(double),UVES_hsshcmp);
+  ctx->shlo=(ctx->shard==1) ? -DBL_MAX :
+    mjds[(int)((long)(ctx->shard-1)*nmjd/ctx->nshard)];
+  ctx->shhi=(ctx->shard==ctx->nshard) ? DBL_MAX :
+    mjds[(int)((long)ctx->shard*nmjd/ctx->nshard)];
+  free(mjds);
+
+  /* Keep files within the calibration period of the owned range */
+  if (!UVES_params_set(&(ctx->cprd))) {
+    nferrormsg("UVES_hsshsel(): Error returned from UVES_params_set()");
+    return 0;
+  }
+  lo=ctx->shlo-ctx->cprd.nhrscal_b/24.0-SHARDSLACK;
+  hi=ctx->shhi+ctx->cprd.nhrscal_f/24.0+SHARDSLACK;
+  for (i=0; i<*nhdrs; i++) {
+    if ((mjd=UVES_hsshmjd(hdrs[i].abfile))>=0.0 && (mjd<lo || mjd>hi)) continue;
+    if (n<i) hdrs[n]=hdrs[i];
+    n++;
+  }
+  if (ctx->debug) fprintf(stdout,"INFO: Shard %d of %d reads %d of %d FITS \
+files ...\n",ctx->shard,ctx->nshard,n,*nhdrs);
+  *nhdrs=n;
+
+  return 1;
+
+}
+
+int UVES_hsshwrite(hsctx *ctx) {
+
+  int      nown=0,nref=0,nsci=0,nhdrs=ctx->nhdrs;
+  int      i=0,j=0,k=0;
+  int      *map=NULL,*inv=NULL,*ind[6]={NULL},*nind[6]={NULL};
+  char     file[NAMELEN]="\0";
+  FILE     *fp=NULL;
+  header   *hdrs=ctx->hdrs;
+  scihdr   sci;
+
+  /* Map from context headers to shard file headers: owned headers first,
+     in order, then other calibration headers used by owned science
+     exposures. inv is the reverse map */
+  if (!(map=(int *)malloc((size_t)((MAX(2*nhdrs,1))*sizeof(int))))) {
+    nferrormsg("UVES_hsshwrite(): Could not allocate memory for map array\n\
+\tof size %d",2*nhdrs); return 0;
+  }
+  inv=map+nhdrs;
+  for (i=0; i<nhdrs; i++)
+    map[i]=(hdrs[i].mjd>=ctx->shlo && hdrs[i].mjd<ctx->shhi) ? nown++ : -1;
+  for (i=0; i<ctx->nscis; i++) {
+    if (ctx->scis[i].hdr.mjd<ctx->shlo || ctx->scis[i].hdr.mjd>=ctx->shhi)
+      continue;
+    nsci++; UVES_hsshind(&(ctx->scis[i]),ind,nind);
+    for (j=0; j<6; j++)
+      for (k=0; k<*(nind[j]); k++)
+	if (map[ind[j][k]]<0) map[ind[j][k]]=nown+nref++;
+  }
+  for (i=0; i<nhdrs; i++) if (map[i]>=0) inv[map[i]]=i;
+
+  /* Open shard file and write its description */
+  sprintf(file,"%s.%d",SHARDFILE,ctx->shard);
+  if ((fp=faskwopen("Shard file?",file,4))==NULL) {
+    free(map);
+    nferrormsg("UVES_hsshwrite(): Cannot open shard file %s for writing",file);
+    return 0;
+  }
+  fprintf(fp,"%s %d %d %d %d %d %d %d %d\n",SHARDMAGIC,SHARDVERS,
+	  (int)sizeof(header),(int)sizeof(scihdr),ctx->shard,ctx->nshard,nown,
+	  nref,nsci);
+  fwrite(&(ctx->cprd),sizeof(calprd),1,fp);
+
+  /* Write headers in shard file order */
+  for (i=0; i<nown+nref; i++) fwrite(&(hdrs[inv[i]]),sizeof(header),1,fp);
+
+  /* Write owned science exposures with calibrations re-indexed */
+  for (i=0; i<ctx->nscis; i++) {
+    if (ctx->scis[i].hdr.mjd<ctx->shlo || ctx->scis[i].hdr.mjd>=ctx->shhi)
+      continue;
+    sci=ctx->scis[i]; UVES_hsshind(&sci,ind,nind);
+    for (j=0; j<6; j++)
+      for (k=0; k<*(nind[j]); k++) ind[j][k]=map[ind[j][k]];
+    fwrite(&sci,sizeof(scihdr),1,fp);
+  }
+  free(map);
+  if (ferror(fp) | fclose(fp)) {
+    nferrormsg("UVES_hsshwrite(): Error writing shard file %s",file);
+    return 0;
+  }
+  if (ctx->debug) fprintf(stdout,"INFO: Wrote %d headers, %d other calibration \
+headers and %d science exposures to %s ...\n",nown,nref,nsci,file);
+
+  return 1;
+
+}
+
+int UVES_hsshmerge(hsctx *ctx, int nshard) {
+
+  int      nown=0,nref=0,nsci=0,nhdrs=0,nhref=0,nscis=0;
+  int      i=0,j=0,k=0,l=0,pass=0;
+  int      *ind[6]={NULL},*nind[6]={NULL};
+  char     file[NAMELEN]="\0";
+  FILE     *fp=NULL;
+  header   *hdrs=NULL,*hrefs=NULL,*hptr=NULL;
+  scihdr   *scis=NULL;
+
+  /* Read shard file descriptions to find sizes of merged arrays (first
+     pass), then read headers and science exposures (second pass) */
+  for (pass=0; pass<2; pass++) {
+    if (pass) {
+      if (!(hdrs=(header *)malloc((size_t)((MAX(nhdrs,1))*sizeof(header)))) ||
+	  !(hrefs=(header *)malloc((size_t)((MAX(nhref,1))*sizeof(header)))) ||
+	  !(scis=(scihdr *)malloc((size_t)((MAX(nscis,1))*sizeof(scihdr))))) {
+	FREESH;
+	nferrormsg("UVES_hsshmerge(): Could not allocate memory for %d headers\n\
+\tand %d science exposures",nhdrs+nhref,nscis); return 0;
+      }
+      nhdrs=nhref=nscis=0;
+    }
+    for (k=1; k<=nshard; k++) {
+      sprintf(file,"%s.%d",SHARDFILE,k);
+      if ((fp=UVES_hsshopen(ctx,file,k,nshard,&nown,&nref,&nsci))==NULL) {
+	FREESH;
+	nferrormsg("UVES_hsshmerge(): Unknown error returned from\n\
+\tUVES_hsshopen()"); return 0;
+      }
+      if (pass) {
+	if (fread(&(hdrs[nhdrs]),sizeof(header),nown,fp)!=(size_t)nown ||
+	    fread(&(hrefs[nhref]),sizeof(header),nref,fp)!=(size_t)nref ||
+	    fread(&(scis[nscis]),sizeof(scihdr),nsci,fp)!=(size_t)nsci) {
+	  fclose(fp); FREESH;
+	  nferrormsg("UVES_hsshmerge(): Problem reading shard file %s",file);
+	  return 0;
+	}
+	/* Re-index calibrations: owned headers by position in merged list,
+	   others (negative) by position in list of other headers */
+	for (i=nscis; i<nscis+nsci; i++) {
+	  UVES_hsshind(&(scis[i]),ind,nind);
+	  for (j=0; j<6; j++)
+	    for (l=0; l<*(nind[j]); l++)
+	      ind[j][l]=(ind[j][l]<nown) ? nhdrs+ind[j][l] :
+		-(nhref+ind[j][l]-nown+1);
+	}
+      }
+      fclose(fp);
+      nhdrs+=nown; nhref+=nref; nscis+=nsci;
+    }
+  }
+
+  /* Owned time ranges follow each other, so the merged headers must
+     already be in order, with no frame owned twice */
+  for (i=1; i<nhdrs; i++) {
+    if (qsort_mjd(&(hdrs[i-1]),&(hdrs[i]))>=0) {
+      FREESH;
+      nferrormsg("UVES_hsshmerge(): Headers from shard files are out of order\n\
+\tor repeated at file\n\t%s",hdrs[i].file); return 0;
+    }
+  }
+
+  /* Find other calibration headers in merged list */
+  for (i=0; i<nscis; i++) {
+    UVES_hsshind(&(scis[i]),ind,nind);
+    for (j=0; j<6; j++) {
+      for (k=0; k<*(nind[j]); k++) {
+	if (ind[j][k]>=0) continue;
+	if ((hptr=(header *)bsearch(&(hrefs[-ind[j][k]-1]),hdrs,nhdrs,
+				    sizeof(header),qsort_mjd))==NULL) {
+	  nferrormsg("UVES_hsshmerge(): Calibration frame\n\t%s\n\
+\tused in one shard is not owned by any shard",hrefs[-ind[j][k]-1].file);
+	  FREESH; return 0;
+	}
+	ind[j][k]=(int)(hptr-hdrs);
+      }
+    }
+    scis[i].hdr.emit=EMIT_PEND;
+  }
+  free(hrefs); hrefs=NULL;
+  for (i=0; i<nhdrs; i++) hdrs[i].emit=EMIT_PEND;
+
+  /* Number science exposures of each object and setting across the whole
+     archive, as UVES_calsrch() does for a single run */
+  for (j=0; j<nscis; j++) {
+    scis[j].sciind=scis[j].sciind_31=1;
+    for (k=0; k<j; k++) {
+      if (!strcmp(scis[k].hdr.obj,scis[j].hdr.obj) &&
+	  !strcmp(scis[k].hdr.cwl,scis[j].hdr.cwl)) scis[j].sciind++;
+      if (!strcmp(scis[k].hdr.obj_31,scis[j].hdr.obj_31) &&
+	  !strcmp(scis[k].hdr.cwl,scis[j].hdr.cwl)) scis[j].sciind_31++;
+    }
+  }
+
+  /* Replace any previous headers and matches */
+  if (ctx->hdrs!=NULL) free(ctx->hdrs);
+  if (ctx->scis!=NULL) free(ctx->scis);
+  ctx->hdrs=hdrs; ctx->nhdrs=ctx->nhdrsmax=nhdrs;
+  ctx->scis=scis; ctx->nscis=nscis;
+  if (ctx->debug) fprintf(stdout,"INFO: Merged %d headers and %d science \
+exposures from %d shard files ...\n",nhdrs,nscis,nshard);
+
+  return 1;
+
+}
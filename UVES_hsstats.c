@@ -0,0 +1,116 @@
+/****************************************************************************
+* Run statistics for UVES_headsort (-stats option).
+*
+* UVES_hsstbeg() and UVES_hsstend() bracket one stage of a run and add
+* its wall-clock and CPU time to the totals for that stage. They do
+* nothing unless statistics were requested. Counts of FITS files and
+* header bytes read, calibration frames examined and selected, and
+* directories, links and files written are kept by the routines doing
+* the work. UVES_hsstrep() writes all of these, with the peak resident
+* memory of the process, as text or as a single JSON object.
+*
+* Comparing CPU and wall-clock times shows where a slow run spends its
+* time: a stage whose CPU time is much less than its wall-clock time is
+* waiting on file I/O or file system metadata operations.
+****************************************************************************/
+
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "UVES_headsort.h"
+#include "error.h"
+
+static char *UVES_hsstname[HSST_NSTAGE]={"ingest","sort","match","info","link",
+					  "redscr","mfst"};
+
+/* Wall-clock time, CPU time [s] and peak resident memory [kB] so far */
+static void UVES_hsstclock(double *wall, double *cpu, long *rss) {
+
+  struct   timespec ts;
+  struct   rusage ru;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  *wall=(double)ts.tv_sec+1.e-9*(double)ts.tv_nsec;
+  getrusage(RUSAGE_SELF,&ru);
+  *cpu=(double)ru.ru_utime.tv_sec+1.e-6*(double)ru.ru_utime.tv_usec+
+    (double)ru.ru_stime.tv_sec+1.e-6*(double)ru.ru_stime.tv_usec;
+  /* ru_maxrss is in bytes on Mac OS X, kB elsewhere */
+#ifdef __APPLE__
+  *rss=ru.ru_maxrss/1024;
+#else
+  *rss=ru.ru_maxrss;
+#endif
+
+}
+
+void UVES_hsstbeg(hsstats *st, int stage) {
+
+  long     rss=0;
+
+  if (st==NULL || st->mode==HSST_OFF) return;
+  st->stage=stage; UVES_hsstclock(&(st->wall0),&(st->cpu0),&rss);
+
+}
+
+void UVES_hsstend(hsstats *st) {
+
+  double   wall=0.0,cpu=0.0;
+  long     rss=0;
+
+  if (st==NULL || st->mode==HSST_OFF || st->stage<0) return;
+  UVES_hsstclock(&wall,&cpu,&rss);
+  st->wall[st->stage]+=wall-st->wall0; st->cpu[st->stage]+=cpu-st->cpu0;
+  st->ncall[st->stage]++; st->stage=-1;
+
+}
+
+int UVES_hsstrep(hsctx *ctx, FILE *fp) {
+
+  double   wall=0.0,cpu=0.0,rate=0.0,dwall=0.0,dcpu=0.0;
+  long     rss=0;
+  int      i=0;
+  hsstats  *st=&(ctx->st);
+
+  if (st->mode==HSST_OFF) return 1;
+  for (i=0; i<HSST_NSTAGE; i++) { wall+=st->wall[i]; cpu+=st->cpu[i]; }
+  rate=(st->wall[HSST_INGEST]>0.0) ?
+    (double)st->nread/st->wall[HSST_INGEST] : 0.0;
+  UVES_hsstclock(&dwall,&dcpu,&rss);
+
+  if (st->mode==HSST_JSON) {
+    fprintf(fp,"{\"stages\":{");
+    for (i=0; i<HSST_NSTAGE; i++)
+      fprintf(fp,"%s\"%s\":{\"calls\":%d,\"wall\":%.6lf,\"cpu\":%.6lf}",
+	      (i) ? "," : "",UVES_hsstname[i],st->ncall[i],st->wall[i],
+	      st->cpu[i]);
+    fprintf(fp,"},\"total\":{\"wall\":%.6lf,\"cpu\":%.6lf},",wall,cpu);
+    fprintf(fp,"\"ingest\":{\"files\":%ld,\"bytes\":%ld,\"files_per_s\":%.1lf},",
+	    st->nread,st->nbread,rate);
+    fprintf(fp,"\"calsrch\":{\"examined\":%ld,\"candidates\":%ld,\
+\"selected\":%ld},",st->ncsexam,st->ncscand,st->ncssel);
+    fprintf(fp,"\"output\":{\"dirs\":%ld,\"symlinks\":%ld,\"files\":%ld,\
+\"bytes\":%ld},",st->ndir,st->nlink,ctx->mfst.nfile,ctx->mfst.nbyte);
+    fprintf(fp,"\"maxrss_kb\":%ld}\n",rss);
+  } else {
+    fprintf(fp,"STATS: stage     calls      wall[s]       cpu[s]  cpu/wall\n");
+    for (i=0; i<HSST_NSTAGE; i++) {
+      if (!st->ncall[i]) continue;
+      fprintf(fp,"STATS: %-8s %6d %12.6lf %12.6lf %9.3lf\n",UVES_hsstname[i],
+	      st->ncall[i],st->wall[i],st->cpu[i],
+	      (st->wall[i]>0.0) ? st->cpu[i]/st->wall[i] : 0.0);
+    }
+    fprintf(fp,"STATS: %-8s %6s %12.6lf %12.6lf %9.3lf\n","total","",wall,cpu,
+	    (wall>0.0) ? cpu/wall : 0.0);
+    fprintf(fp,"STATS: ingest: %ld FITS files, %ld header bytes read, \
+%.1lf files/s\n",st->nread,st->nbread,rate);
+    fprintf(fp,"STATS: calsrch: %ld cal. frames examined, %ld in cal. period \
+with matching setting, %ld selected\n",st->ncsexam,st->ncscand,st->ncssel);
+    fprintf(fp,"STATS: output: %ld directories, %ld symlinks, %ld files \
+(%ld bytes) written\n",st->ndir,st->nlink,ctx->mfst.nfile,ctx->mfst.nbyte);
+    fprintf(fp,"STATS: peak resident memory: %ld kB\n",rss);
+  }
+  fflush(fp);
+
+  return 1;
+
+}
@@ -0,0 +1,104 @@
+/****************************************************************************
+* Trace-event output for UVES_headsort (-trace option).
+*
+* UVES_hstropen() starts a file of trace events in the JSON array format
+* read by chrome://tracing and Perfetto. Each call to UVES_hstrspan()
+* writes one complete event ("ph":"X") for a span that started at time
+* t0, as returned by UVES_hstrnow(), and ends now, with the name of the
+* file concerned and any further arguments. Spans are written for each
+* FITS header read, each science frame's calibration search and each
+* science frame's links and info. file, so that the slowest files and
+* frames stand out in a viewer. UVES_hstrclose() ends the array.
+*
+* When not tracing, UVES_hstrnow() and UVES_hstrspan() return at once
+* without reading the clock.
+****************************************************************************/
+
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+/* Wall-clock time [us] */
+static double UVES_hstrclock(void) {
+
+  struct   timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return 1.e6*(double)ts.tv_sec+1.e-3*(double)ts.tv_nsec;
+
+}
+
+/* Write string as a quoted JSON string. Also used by UVES_hsdiag() */
+void UVES_hstresc(FILE *fp, char *str) {
+
+  char     *cptr=NULL;
+
+  fputc('"',fp);
+  for (cptr=str; *cptr; cptr++) {
+    if (*cptr=='"' || *cptr=='\\') fprintf(fp,"\\%c",*cptr);
+    else if ((unsigned char)*cptr<0x20) fprintf(fp,"\\u%4.4x",(int)*cptr);
+    else fputc(*cptr,fp);
+  }
+  fputc('"',fp);
+
+}
+
+int UVES_hstropen(hsstats *st, char *file) {
+
+  if ((st->trfp=faskwopen("Trace-event file?",file,4))==NULL) {
+    nferrormsg("UVES_hstropen(): Cannot open trace-event file\n\t%s\n\
+\tfor writing",file); return 0;
+  }
+  fprintf(st->trfp,"[\n"); st->ntrev=0; st->trt0=UVES_hstrclock();
+
+  return 1;
+
+}
+
+double UVES_hstrnow(hsstats *st) {
+
+  if (st==NULL || st->trfp==NULL) return 0.0;
+  return UVES_hstrclock()-st->trt0;
+
+}
+
+void UVES_hstrspan(hsstats *st, char *cat, char *name, char *file, double t0,
+		   char *fmt, ...) {
+
+  double   t=0.0;
+  va_list  ap;
+
+  if (st==NULL || st->trfp==NULL) return;
+  t=UVES_hstrclock()-st->trt0;
+  fprintf(st->trfp,"%s{\"name\":",(st->ntrev++) ? ",\n" : "");
+  UVES_hstresc(st->trfp,name);
+  fprintf(st->trfp,",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3lf,\"dur\":%.3lf,\
+\"pid\":%d,\"tid\":1,\"args\":{",cat,t0,t-t0,(int)getpid());
+  if (file!=NULL) {
+    fprintf(st->trfp,"\"file\":"); UVES_hstresc(st->trfp,file);
+  }
+  if (fmt!=NULL) {
+    if (file!=NULL) fputc(',',st->trfp);
+    va_start(ap,fmt); vfprintf(st->trfp,fmt,ap); va_end(ap);
+  }
+  fprintf(st->trfp,"}}");
+
+}
+
+int UVES_hstrclose(hsstats *st) {
+
+  int      err=0;
+
+  if (st->trfp==NULL) return 1;
+  fprintf(st->trfp,"\n]\n");
+  err=fclose(st->trfp); st->trfp=NULL;
+  if (err) {
+    nferrormsg("UVES_hstrclose(): Error closing trace-event file"); return 0;
+  }
+
+  return 1;
+
+}
@@ -0,0 +1,211 @@
+/****************************************************************************
+* Watch a directory for new FITS files, adding each header to a
+* UVES_headsort context as soon as the file has been completely written
+* (or moved into the directory), re-matching calibrations and writing
+* the output for each science exposure once its forward calibration
+* period has closed. FITS files already in the directory are read
+* first. On SIGINT or SIGTERM, all remaining science exposures are
+* written before returning.
+*
+* Frames are assumed to arrive roughly in time order: a science
+* exposure arriving after a later one of the same object and setting
+* has been written would change the latter's index.
+*
+* Uses inotify, so only available on Linux.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "UVES_headsort.h"
+#include "error.h"
+
+#ifdef __linux__
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define WATCHCLOSE close(fd); sigaction(SIGINT,&saint,NULL); \
+  sigaction(SIGTERM,&saterm,NULL);
+
+static volatile sig_atomic_t UVES_hsstop=0;
+
+/* Signal handler: finish writing output and stop watching */
+static void UVES_hssig(int sig) {
+
+  UVES_hsstop=1;
+
+}
+
+/* Is this the name of a FITS file (and not a hidden, temporary one)? */
+static int UVES_hsisfits(char *name) {
+
+  int      n=0;
+
+  n=strlen(name);
+  return (name[0]!='.' && n>5 && !strcmp(name+n-5,".fits")) ? 1 : 0;
+
+}
+
+/* Add a FITS file in the watched directory to the context, skipping
+   (with a warning) files whose headers cannot be read */
+static int UVES_hswadd(hsctx *ctx, char *dir, char *name, int known) {
+
+  int      i=0;
+  char     file[LNGSTRLEN]="\0";
+
+  if (snprintf(file,LNGSTRLEN,"%s/%s",dir,name)>=LNGSTRLEN) {
+    warnmsg("UVES_hswatch(): File name too long. Skipping file\n\t%s/%s",
+	    dir,name); return 0;
+  }
+  if (known) {
+    for (i=0; i<ctx->nhdrs; i++) if (!strcmp(ctx->hdrs[i].file,file)) return 0;
+  }
+  if (!UVES_hsadd(ctx,file)) {
+    warnmsg("UVES_hswatch(): Skipping file\n\t%s",file); return 0;
+  }
+  if (ctx->debug) fprintf(stdout,"INFO: Read header of %s ...\n",file);
+
+  return 1;
+
+}
+
+/* Add all FITS files in the watched directory not already held */
+static int UVES_hswscan(hsctx *ctx, char *dir) {
+
+  int      nadd=0;
+  DIR      *dp=NULL;
+  struct   dirent *ent=NULL;
+
+  if ((dp=opendir(dir))==NULL) {
+    nferrormsg("UVES_hswatch(): Cannot open directory %s",dir); return -1;
+  }
+  while ((ent=readdir(dp))!=NULL)
+    if (UVES_hsisfits(ent->d_name)) nadd+=UVES_hswadd(ctx,dir,ent->d_name,1);
+  closedir(dp);
+
+  return nadd;
+
+}
+
+int UVES_hswatch(hsctx *ctx, char *dir) {
+
+  int      fd=-1,nadd=0,rescan=0,n=0;
+  ssize_t  len=0;
+  char     wdir[PATH_MAX]="\0";
+  char     evbuf[WATCHBUF]
+    __attribute__((aligned(__alignof__(struct inotify_event))));
+  char     *cptr=NULL;
+  struct   inotify_event *ev=NULL;
+  struct   pollfd pfd;
+  struct   sigaction sa,saint,saterm;
+
+  /* Manifests are finished after each write so cannot be added to */
+  if (ctx->mfst.mode!=MFST_NONE) {
+    nferrormsg("UVES_hswatch(): Manifest files cannot be written in watch mode");
+    return 0;
+  }
+
+  /* Use absolute path names for headers and links */
+  if (realpath(dir,wdir)==NULL || strlen(wdir)>=LNGSTRLEN-NAMELEN) {
+    nferrormsg("UVES_hswatch(): Cannot resolve directory name %s",dir);
+    return 0;
+  }
+
+  /* Start watching before reading existing files so none are missed */
+  if ((fd=inotify_init1(IN_CLOEXEC))<0) {
+    nferrormsg("UVES_hswatch(): Cannot initialise inotify"); return 0;
+  }
+  if (inotify_add_watch(fd,wdir,IN_CLOSE_WRITE|IN_MOVED_TO)<0) {
+    close(fd);
+    nferrormsg("UVES_hswatch(): Cannot watch directory %s",wdir); return 0;
+  }
+  UVES_hsstop=0;
+  memset(&sa,0,sizeof(sa));
+  sa.sa_handler=UVES_hssig; sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT,&sa,&saint); sigaction(SIGTERM,&sa,&saterm);
+  if ((nadd=UVES_hswscan(ctx,wdir))<0) {
+    WATCHCLOSE;
+    nferrormsg("UVES_hswatch(): Cannot read existing files in %s",wdir);
+    return 0;
+  }
+  if (ctx->debug)
+    fprintf(stdout,"INFO: Watching directory %s ...\n",wdir);
+
+  while (1) {
+
+    /* Re-match calibrations if frames have been added and write any
+       science exposures whose calibration periods have closed, or all
+       remaining ones if stopping */
+    if (nadd) {
+      if (!UVES_hsmatch(ctx)) {
+	WATCHCLOSE;
+	nferrormsg("UVES_hswatch(): Unknown error returned from UVES_hsmatch()");
+	return 0;
+      }
+      nadd=0;
+    }
+    if (ctx->scis!=NULL) {
+      ctx->tnow=(UVES_hsstop) ? 0.0 : 40587.0+(double)time(NULL)/86400.0;
+      if (!UVES_hsemit(ctx)) {
+	WATCHCLOSE;
+	nferrormsg("UVES_hswatch(): Unknown error returned from UVES_hsemit()");
+	return 0;
+      }
+    }
+    if (UVES_hsstop) break;
+
+    /* Wait for new files, checking the time periodically */
+    pfd.fd=fd; pfd.events=POLLIN; pfd.revents=0;
+    if ((n=poll(&pfd,1,WATCHPOLL*1000))<0 && errno!=EINTR) {
+      WATCHCLOSE;
+      nferrormsg("UVES_hswatch(): Error waiting for inotify events"); return 0;
+    }
+    if (n<=0) continue;
+    if ((len=read(fd,evbuf,WATCHBUF))<=0) continue;
+    for (cptr=evbuf; cptr<evbuf+len;
+	 cptr+=sizeof(struct inotify_event)+ev->len) {
+      ev=(struct inotify_event *)cptr;
+      if (ev->mask&IN_Q_OVERFLOW) rescan=1;
+      else if (ev->mask&IN_IGNORED) {
+	warnmsg("UVES_hswatch(): Directory %s\n\tis no longer being watched",
+		wdir); UVES_hsstop=1;
+      }
+      else if (ev->len && UVES_hsisfits(ev->name))
+	nadd+=UVES_hswadd(ctx,wdir,ev->name,0);
+    }
+
+    /* Events were lost: look for files not already held */
+    if (rescan) {
+      warnmsg("UVES_hswatch(): inotify event queue overflowed. Rescanning %s",
+	      wdir);
+      if ((n=UVES_hswscan(ctx,wdir))>0) nadd+=n;
+      rescan=0;
+    }
+
+  }
+
+  /* Clean up */
+  WATCHCLOSE;
+  ctx->tnow=0.0;
+
+  return 1;
+
+}
+
+#else
+
+int UVES_hswatch(hsctx *ctx, char *dir) {
+
+  nferrormsg("UVES_hswatch(): Watch mode requires inotify, only available\n\
+\ton Linux");
+  return 0;
+
+}
+
+#endif
@@ -0,0 +1,135 @@
+/****************************************************************************
+* Iteratively constrain the physical model of UVES by running the CPL
+* uves_cal_predict command (or a stand-in command, cmd, accepting the
+* same arguments) with decreasing box sizes, re-centring the offsets on
+* the median model offsets after each run. The box size 40 run is
+* skipped if re-centring after the box size 80 run does not move the
+* rounded offsets. Only the offsets are tested: with box sizes 80 and
+* 40 before the last, the test can only be made after the first run,
+* when there is no earlier line count to compare with. After the box
+* size 25 run, the number of lines which would remain in a box of size
+* 20 around the new offsets is estimated from the offsets already
+* measured, rather than by running the command again. Box size 20 is
+* chosen if this loses no more than ITPHNLOSS of the lines. All offsets
+* are handled in tenths of a pixel and the x-offset is never set
+* exactly to zero.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "UVES_itphmod.h"
+#include "stats.h"
+#include "error.h"
+
+/* Box size schedule: the last entry is compared with ITPHBOXFIN */
+static int UVES_itphbox[NITPHBOX]={80,40,25};
+
+/* Apply a median offset to the current offset (both in tenths of a
+   pixel), as done by uves_itphmod.csh. The x-offset (isx=1) is never
+   exactly zero: 0.1 is used instead */
+static int UVES_itphtrans(int trans, double med, int first, int isx) {
+
+  int      m=0,x=0;
+
+  m=5*(NINT(2.0*med));
+  if (!isx) return (first) ? m : trans+m;
+  if (first) return (m) ? m : 1;
+  x=trans+m;
+  if (x==0 || x==1) return 1;
+  return (trans==1) ? x-1 : x;
+
+}
+
+/* Find the median x and y offsets of the lines in pd */
+static int UVES_itphmed(itphdat *pd, double *xmed, double *ymed) {
+
+  statset  stat;
+
+  if (!medianbuf(pd->xdif,NULL,pd->n,pd->buf,&stat,0)) return 0;
+  *xmed=stat.med;
+  if (!medianbuf(pd->ydif,NULL,pd->n,pd->buf,&stat,0)) return 0;
+  *ymed=stat.med;
+
+  return 1;
+
+}
+
+int UVES_itphiter(char *soffile, char *chip, char *cmd, char *tmpfile,
+		  itphdat *pd, itphres *res) {
+
+  double   xmed=0.0,ymed=0.0,dx=0.0,dy=0.0,hbox=0.0;
+  int      tx=1,ty=0,n20=0;
+  int      i=0,j=0;
+  char     command[HUGESTRLEN]="\0",chiparg[LNGSTRLEN]="\0";
+
+  if (chip!=NULL && strlen(chip)+17>LNGSTRLEN) {
+    nferrormsg("UVES_itphiter(): Chip name too long: %s",chip); return 0;
+  }
+  if (chip!=NULL) sprintf(chiparg,"--process_chip=%s ",chip);
+
+  res->nrun=0;
+  fprintf(stderr,"Box_size  TRANSX  TRANSY  NLINES\n");
+  for (i=0; i<NITPHBOX; i++) {
+    /* Run the predict command */
+    if (snprintf(command,HUGESTRLEN,"%s %s--plotter='cat >> %s' --mbox_x=%d \
+--mbox_y=%d --trans_x=%.1lf --trans_y=%.1lf %s > /dev/null",cmd,chiparg,
+		 tmpfile,UVES_itphbox[i],UVES_itphbox[i],0.1*(double)tx,
+		 0.1*(double)ty,soffile)>=HUGESTRLEN) {
+      nferrormsg("UVES_itphiter(): Predict command too long"); return 0;
+    }
+    unlink(tmpfile);
+    /* As in uves_itphmod.csh, a failed command is not fatal in itself:
+       the plotter output it left, if any, is still read */
+    if (system(command))
+      warnmsg("UVES_itphiter(): Error returned from command\n\t%s",command);
+    /* Read the offsets and find their medians */
+    if (!UVES_itphread(tmpfile,pd)) {
+      nferrormsg("UVES_itphiter(): Unknown error returned from\n\
+\tUVES_itphread() for box size %d",UVES_itphbox[i]); return 0;
+    }
+    if (!UVES_itphmed(pd,&xmed,&ymed)) {
+      nferrormsg("UVES_itphiter(): Error determining median offsets\n\
+\tfor box size %d",UVES_itphbox[i]); return 0;
+    }
+    unlink(tmpfile);
+    /* Record the results of this box size, as needed if this turns
+       out to be the final one */
+    res->bsize=UVES_itphbox[i]; res->n=pd->n; res->nrun++;
+    res->ptx=tx; res->pty=ty;
+    tx=UVES_itphtrans(tx,xmed,!i,1); ty=UVES_itphtrans(ty,ymed,!i,0);
+    res->tx=tx; res->ty=ty;
+    fprintf(stderr,"%-8d  %6.1lf  %6.1lf  %6d\n",res->bsize,0.1*(double)tx,
+	    0.1*(double)ty,res->n);
+    /* Skip to the last box size once re-centring no longer moves the
+       offsets */
+    if (i<NITPHBOX-2 && (NINT(2.0*xmed))==0 && (NINT(2.0*ymed))==0)
+      i=NITPHBOX-2;
+  }
+
+  /* Estimate how many lines remain within the final box size around
+     the new offsets and re-centre on those lines */
+  hbox=0.5*(double)ITPHBOXFIN; dx=0.1*(double)(tx-res->ptx);
+  dy=0.1*(double)(ty-res->pty);
+  for (j=0,n20=0; j<pd->n; j++) {
+    if (fabs(pd->xdif[j]-dx)<=hbox && fabs(pd->ydif[j]-dy)<=hbox) {
+      pd->xdif[n20]=pd->xdif[j]; pd->ydif[n20++]=pd->ydif[j];
+    }
+  }
+  if (n20 && (double)(res->n-n20)/(double)res->n<=ITPHNLOSS) {
+    pd->n=n20;
+    if (!UVES_itphmed(pd,&xmed,&ymed)) {
+      nferrormsg("UVES_itphiter(): Error determining median offsets\n\
+\tfor box size %d",ITPHBOXFIN); return 0;
+    }
+    res->bsize=ITPHBOXFIN; res->n=n20;
+    res->tx=UVES_itphtrans(res->ptx,xmed,0,1);
+    res->ty=UVES_itphtrans(res->pty,ymed,0,0);
+    fprintf(stderr,"%-8d  %6.1lf  %6.1lf  %6d (estimated)\n",res->bsize,
+	    0.1*(double)res->tx,0.1*(double)res->ty,res->n);
+  }
+
+  return 1;
+
+}
@@ -9,15 +9,10 @@ determine the offsets of the physical model.
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include "UVES_itphmod.h"
 #include "stats.h"
-#include "charstr.h"
-#include "file.h"
-#include "memory.h"
 #include "error.h"
 
-/* Definitions */
-#define NINT(a) (a-(int)(a)<0.5) ? (int)(a) : (int)(a+1.0)
-
 /* Global declarations */
 char      *progname;
 
@@ -32,10 +27,23 @@ void usage(void) {
 
   fprintf(stderr,"\nBy Michael Murphy");
 
-  fprintf(stderr,"\nUsage: %s [OPTIONS] [INPUT DATA FILE]\n",progname);
+  fprintf(stderr,"\nUsage: %s [OPTIONS] [INPUT DATA FILE(S)]\n",progname);
 
   fprintf(stderr, "\nOptions:\n\
-  -h, -help        : Print this message.\n\n");
+  -h, -help        : Print this message.\n\
+  -iter SOFFILE    : Run the predict command iteratively on SOFFILE to\n\
+                         constrain the physical model (no input files).\n\
+  -chip CHIP       : Process chip CHIP (redl or redu) in -iter mode.\n\
+  -cmd CMD         : Predict command used in -iter mode\n\
+                         (default: '%s').\n\
+  -tmp FILE        : Temporary plotter file used in -iter mode\n\
+                         (default: %s).\n\
+\nFor each input file, the number of ThAr lines and the median X and Y\n\
+offsets are written on one line. With more than one input file, each line\n\
+is preceded by the file name. In -iter mode, the progress of each iteration\n\
+is written to stderr and one line is written to stdout containing the final\n\
+box size, X and Y offsets, the number of ThAr lines and the number of\n\
+predict runs made.\n\n",ITPHCMD,ITPHTMP);
   exit(3);
 }
 
@@ -49,140 +57,74 @@ void usage(void) {
 int main(int argc, char *argv[]) {
 
   double   xdif_med=0.0,ydif_med=0.0;
-  double   ddum=0.0;
-  double   *xmod=NULL,*ymod=NULL,*xdif=NULL,*ydif=NULL;
-  int      n=0;
-  int      i=0,j=0,k=0;
-  char     infile[NAMELEN]="\0";
-  char     buffer[VVLNGSTRLEN]="\0";
-  FILE     *data_file=NULL;
+  int      nfile=0;
+  int      i=0,j=0;
+  char     **infile=NULL,*soffile=NULL,*chip=NULL;
+  char     *cmd=ITPHCMD,*tmpfile=ITPHTMP;
+  itphdat  pd;
+  itphres  res;
   statset  stat;
 
   /* Define the program name from the command line input */
   progname=((progname=strrchr(argv[0],'/'))==NULL) ? argv[0] : progname+1;
   /* Must be at least 1 argument */
   if (argc<1) usage();
+  /* Allocate memory for list of input files */
+  if ((infile=(char **)malloc((size_t)(argc*sizeof(char *))))==NULL)
+    errormsg("Cannot allocate memory for list of %d input files",argc);
   /* Scan command line for options */
   while (++i<argc) {
     if (!strcmp(argv[i],"-help") || !strcmp(argv[i],"-h")) usage();
-    else if (!strncmp(infile,"\0",1)) {
-      if (!access(argv[i],R_OK)) {
-	if (strlen(argv[i])<=NAMELEN) strcpy(infile,argv[i]);
-	else errormsg("Input file name too long: %s",argv[i]);
-      }
+    else if (!strcmp(argv[i],"-iter")) {
+      if (++i>=argc) usage();
+      soffile=argv[i];
+    }
+    else if (!strcmp(argv[i],"-chip")) { if (++i>=argc) usage(); chip=argv[i]; }
+    else if (!strcmp(argv[i],"-cmd")) { if (++i>=argc) usage(); cmd=argv[i]; }
+    else if (!strcmp(argv[i],"-tmp")) { if (++i>=argc) usage(); tmpfile=argv[i]; }
+    else {
+      if (!access(argv[i],R_OK)) infile[nfile++]=argv[i];
       else errormsg("Input file %s does not exist",argv[i]);
     }
   }
-  /* Make sure input file was specified */
-  if (!strncmp(infile,"\0",1)) usage();
-
-  /* Open the input file */
-  if ((data_file=faskropen("Valid input data file?",infile,5))==NULL)
-    errormsg("Can not open input data file %s",infile);
-
-  /** Read the input data file **/
-  /* First find the XMOD/XDIF data and determine the number of entries */
-  i=0; while (fgets(buffer,VVLNGSTRLEN,data_file)!=NULL) {
-    if (strstr(buffer,"XMOD")!=NULL && strstr(buffer,"XDIF")!=NULL) break;
-    i++;
-  }
-  if (feof(data_file)) {
-    fclose(data_file); errormsg("Reached end of file at line %d in file %s.\n\
-\tWas expecting to find a line containing both the strings\n\
-\t'XMOD' and 'XDIF'",i+1,infile);
+  /* Make sure input file or SOF file was specified, but not both */
+  if ((!nfile && soffile==NULL) || (nfile && soffile!=NULL)) usage();
+  pd.xdif=pd.ydif=pd.buf=NULL; pd.nmax=0;
+
+  /* Iterate the physical model */
+  if (soffile!=NULL) {
+    if (access(soffile,R_OK)) errormsg("Cannot read SOF file %s",soffile);
+    if (!UVES_itphiter(soffile,chip,cmd,tmpfile,&pd,&res))
+      errormsg("Unknown error returned from UVES_itphiter()");
+    fprintf(stdout,"%d %.1lf %.1lf %d %d\n",res.bsize,0.1*(double)res.tx,
+	    0.1*(double)res.ty,res.n,res.nrun);
+    free(pd.xdif); free(pd.ydif); free(pd.buf); free(infile);
+    return 1;
   }
-  k=++i; j=0; while (fgets(buffer,VVLNGSTRLEN,data_file)!=NULL) {
-    if (sscanf(buffer,"%lf %lf",&ddum,&ddum)!=2) {
-      if (!strncmp(buffer,"e",1)) { rewind(data_file); break; }
-      else {
-	fclose(data_file);
-	errormsg("Incorrect format in line %d of file %s",i+1,infile);
-      }
-    }
-    i++; j++;
-  }
-  n=j;
 
-  /* Allocate memory for data arrays */
-  if ((xmod=darray(n))==NULL) {
-    fclose(data_file); errormsg("Cannot allocate memory for xmod array\n\
-\tof length %d",n);
-  }
-  if ((xdif=darray(n))==NULL) {
-    fclose(data_file); errormsg("Cannot allocate memory for xdif array\n\
-\tof length %d",n);
-  }
-  if ((ymod=darray(n))==NULL) {
-    fclose(data_file); errormsg("Cannot allocate memory for ymod array\n\
-\tof length %d",n);
-  }
-  if ((ydif=darray(n))==NULL) {
-    fclose(data_file); errormsg("Cannot allocate memory for ydif array\n\
-\tof length %d",n);
-  }
-
-  /* Find the XMOD/XDIF data again and read it in */
-  for (i=0; i<k; i++) if (fgets(buffer,VVLNGSTRLEN,data_file)==NULL)
-    errormsg("Problem reading line %d in file %s",i+1,infile);
-  for (i=0; i<n; i++) {
-    if (fgets(buffer,VVLNGSTRLEN,data_file)==NULL)
-      errormsg("Problem reading line %d in file %s",i+k,infile);
-    if (sscanf(buffer,"%lf %lf",&(xmod[i]),&(xdif[i]))!=2) {
-      fclose(data_file);
-      errormsg("Incorrect format in line %d of file %s",i+k,infile);
-    }
+  /* Process each input file in turn, reusing the data arrays */
+  for (j=0; j<nfile; j++) {
+    /* Read the XDIF and YDIF data in a single pass */
+    if (!UVES_itphread(infile[j],&pd))
+      errormsg("Unknown error returned from UVES_itphread()");
+
+    /* Determine the median values of XDIF and YDIF */
+    if (!medianbuf(pd.xdif,NULL,pd.n,pd.buf,&stat,0))
+      errormsg("Error determining median value of xdif");
+    xdif_med=stat.med;
+    if (!medianbuf(pd.ydif,NULL,pd.n,pd.buf,&stat,0))
+      errormsg("Error determining median value of ydif");
+    ydif_med=stat.med;
+
+    /* Output the number of points and the median offsets rounded to
+       the nearest half integer */
+    if (nfile>1) fprintf(stdout,"%s ",infile[j]);
+    fprintf(stdout,"%d %4.1lf %4.1lf\n",pd.n,0.5*(NINT(2.0*xdif_med)),
+	    0.5*(NINT(2.0*ydif_med)));
   }
-  rewind(data_file);
-
-  /* Now find the YMOD/YDIF data and read it in */
-  i=0; while (fgets(buffer,VVLNGSTRLEN,data_file)!=NULL) {
-    if (strstr(buffer,"YMOD")!=NULL && strstr(buffer,"YDIF")!=NULL) break;
-    i++;
-  }
-  if (feof(data_file)) {
-    fclose(data_file); errormsg("Reached end of file at line %d in file %s.\n\
-\tWas expecting to find a line containing both the strings\n\
-\t'YMOD' and 'YDIF'",i+1,infile);
-  }
-  i++; j=0; while (fgets(buffer,VVLNGSTRLEN,data_file)!=NULL) {
-    if (j>n) {
-      fclose(data_file);
-      errormsg("There appears to be more YMOD/YDIF data entries\n\
-\tthan XMOD/XDIF entires (=%d)",n);
-    }
-    if (sscanf(buffer,"%lf %lf",&(ymod[j]),&(ydif[j]))!=2) {
-      if (!strncmp(buffer,"e",1)) break;
-      else {
-	fclose(data_file);
-	errormsg("Incorrect format in line %d of file %s",i+1,infile);
-      }
-    }
-    i++; j++;
-  }
-  if (j<n) {
-    fclose(data_file);
-    errormsg("There appears to be fewer YMOD/YDIF data entries\n\
-\t(=%d) than XMOD/XDIF entires (=%d)",j,n);
-  }
-
-  /* Close the data file */
-  fclose(data_file);
-
-  /* Determine the median values of XDIF and YDIF */
-  if (!median(xdif,NULL,n,&stat,0))
-    errormsg("Error determining median value of xdif");
-  xdif_med=stat.med;
-  if (!median(ydif,NULL,n,&stat,0))
-    errormsg("Error determining median value of ydif");
-  ydif_med=stat.med;
-
-  /* Output the number of points and the median offsets rounded to the
-     nearest half integer */
-  fprintf(stdout,"%d %4.1lf %4.1lf\n",n,0.5*(NINT(2.0*xdif_med)),
-	  0.5*(NINT(2.0*ydif_med)));
 
   /* Clean up */
-  free(xmod); free(xdif); free(ymod); free(ydif);
+  free(pd.xdif); free(pd.ydif); free(pd.buf); free(infile);
 
   return 1;
 
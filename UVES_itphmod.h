@@ -0,0 +1,42 @@
+/***************************************************************************
+* Definitions, structures and function prototypes for UVES_ITPHMOD
+***************************************************************************/
+
+/* INCLUDE FILES */
+#include <stdio.h>
+#include "charstr.h"
+
+/* DEFINITIONS */
+#define NINT(a) (a-(int)(a)<0.5) ? (int)(a) : (int)(a+1.0)
+#define NITPHDAT 256    /* Initial size of growable XDIF/YDIF arrays        */
+#define NITPHBOX 3      /* Number of box sizes actually run in -iter mode   */
+#define ITPHBOXFIN 20   /* Smallest box size, estimated in -iter mode       */
+#define ITPHNLOSS 0.10  /* Max. fraction of lines lost in using ITPHBOXFIN  */
+#define ITPHCMD "esorex uves_cal_predict" /* Default predict command        */
+#define ITPHTMP "gnuplot_temp_1.dat"      /* Default temporary plotter file */
+
+/* STRUCTURES */
+typedef struct ItPhData {
+  double *xdif;         /* X offsets of ThAr lines from model [pix] */
+  double *ydif;         /* Y offsets of ThAr lines from model [pix] */
+  double *buf;          /* Scratch buffer for medians */
+  int    n;             /* Number of ThAr lines */
+  int    nx;            /* Number of entries in XMOD/XDIF section */
+  int    ny;            /* Number of entries in YMOD/YDIF section */
+  int    nmax;          /* Allocated length of xdif and ydif arrays */
+} itphdat;
+
+typedef struct ItPhResult {
+  int    bsize;         /* Final box size */
+  int    tx;            /* Final x-offset [0.1 pix] */
+  int    ty;            /* Final y-offset [0.1 pix] */
+  int    ptx;           /* x-offset used in last predict run [0.1 pix] */
+  int    pty;           /* y-offset used in last predict run [0.1 pix] */
+  int    n;             /* Number of ThAr lines for final parameters */
+  int    nrun;          /* Number of predict runs made */
+} itphres;
+
+/* FUNCTION PROTOTYPES */
+int UVES_itphiter(char *soffile, char *chip, char *cmd, char *tmpfile,
+		  itphdat *pd, itphres *res);
+int UVES_itphread(char *infile, itphdat *pd);
@@ -0,0 +1,148 @@
+/****************************************************************************
+* Read the XMOD/XDIF and YMOD/YDIF sections of the plotter output from the
+* CPL uves_cal_predict command in a single pass over the memory-mapped
+* input file. The XDIF and YDIF values are stored in growable arrays
+* which are reused between calls, along with a scratch buffer of the
+* same length.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "UVES_itphmod.h"
+#include "error.h"
+
+/* Does the line [line,eol) contain the string str? */
+static int UVES_itphhas(char *line, char *eol, char *str) {
+
+  size_t   len=strlen(str);
+
+  while (eol-line>=(long)len) {
+    if ((line=memchr(line,*str,eol-line-len+1))==NULL) return 0;
+    if (!memcmp(line,str,len)) return 1;
+    line++;
+  }
+
+  return 0;
+
+}
+
+/* Read two numbers from the line [line,eol) of a map ending at end */
+static int UVES_itphnum(char *line, char *eol, char *end, double *a,
+			double *b) {
+
+  char     buffer[VVLNGSTRLEN]="\0";
+  char     *e1=NULL,*e2=NULL;
+
+  /* The last line may not be terminated, so copy it. Test for the end
+     of the map first, since eol is not then dereferenceable */
+  if (eol==end || *eol!='\n') {
+    if (eol-line>=VVLNGSTRLEN) return 0;
+    memcpy(buffer,line,eol-line); buffer[eol-line]='\0';
+    eol=buffer+(eol-line); line=buffer;
+  }
+  *a=strtod(line,&e1); if (e1==line || e1>eol) return 0;
+  *b=strtod(e1,&e2); if (e2==e1 || e2>eol) return 0;
+
+  return 1;
+
+}
+
+int UVES_itphread(char *infile, itphdat *pd) {
+
+  double   mod=0.0,val=0.0;
+  long     size=0;
+  int      fd=-1,sect=0,xdone=0,ydone=0,nline=0;
+  char     *map=NULL,*end=NULL,*line=NULL,*eol=NULL;
+  double   *tmp=NULL;
+  struct   stat st;
+
+  pd->n=pd->nx=pd->ny=0;
+
+  /* Map the input file into memory */
+  if ((fd=open(infile,O_RDONLY))<0 || fstat(fd,&st)) {
+    if (fd>=0) close(fd);
+    nferrormsg("UVES_itphread(): Cannot open input data file %s",infile);
+    return 0;
+  }
+  if ((size=(long)st.st_size)>0 &&
+      (map=mmap(NULL,(size_t)size,PROT_READ,MAP_PRIVATE,fd,0))==MAP_FAILED) {
+    close(fd);
+    nferrormsg("UVES_itphread(): Cannot map input data file %s",infile);
+    return 0;
+  }
+  close(fd);
+  if (!size) map=NULL;
+  end=map+size;
+
+  /* Sweep through the file once, line by line */
+  for (line=map; line<end && (!xdone || !ydone); line=eol+1) {
+    if ((eol=memchr(line,'\n',end-line))==NULL) eol=end;
+    nline++;
+    if (!sect) {
+      /* Look for the start of either section */
+      if (!xdone && UVES_itphhas(line,eol,"XMOD") && UVES_itphhas(line,eol,"XDIF"))
+	sect=1;
+      else if (!ydone && UVES_itphhas(line,eol,"YMOD") &&
+	       UVES_itphhas(line,eol,"YDIF")) sect=2;
+      continue;
+    }
+    /* Read an entry, or detect the end of the section */
+    if (!UVES_itphnum(line,eol,end,&mod,&val)) {
+      if (eol>line && *line=='e') {
+	if (sect==1) xdone=1; else ydone=1;
+	sect=0; continue;
+      }
+      if (map!=NULL) munmap(map,(size_t)size);
+      nferrormsg("UVES_itphread(): Incorrect format in line %d of file %s",
+		 nline,infile); return 0;
+    }
+    /* Grow the arrays if necessary */
+    if (((sect==1) ? pd->nx : pd->ny)==pd->nmax) {
+      pd->nmax=(pd->nmax) ? 2*pd->nmax : NITPHDAT;
+      if ((tmp=(double *)realloc(pd->xdif,(size_t)pd->nmax*sizeof(double)))!=NULL)
+	pd->xdif=tmp;
+      if (tmp!=NULL &&
+	  (tmp=(double *)realloc(pd->ydif,(size_t)pd->nmax*sizeof(double)))!=NULL)
+	pd->ydif=tmp;
+      if (tmp!=NULL &&
+	  (tmp=(double *)realloc(pd->buf,(size_t)pd->nmax*sizeof(double)))!=NULL)
+	pd->buf=tmp;
+      if (tmp==NULL) {
+	if (map!=NULL) munmap(map,(size_t)size);
+	nferrormsg("UVES_itphread(): Cannot allocate memory for XDIF/YDIF\n\
+\tarrays of length %d",pd->nmax); return 0;
+      }
+    }
+    if (sect==1) pd->xdif[pd->nx++]=val;
+    else pd->ydif[pd->ny++]=val;
+  }
+  /* A section may also be terminated by the end of the file */
+  if (sect==1) xdone=1;
+  else if (sect==2) ydone=1;
+  if (map!=NULL) munmap(map,(size_t)size);
+
+  /* Check that both sections were found and are consistent */
+  if (!xdone || !ydone) {
+    nferrormsg("UVES_itphread(): Reached end of file at line %d in file %s.\n\
+\tWas expecting to find a line containing both the strings\n\
+\t'%s' and '%s'",nline+1,infile,(xdone) ? "YMOD" : "XMOD",
+	       (xdone) ? "YDIF" : "XDIF"); return 0;
+  }
+  if (pd->ny>pd->nx) {
+    nferrormsg("UVES_itphread(): There appears to be more YMOD/YDIF data\n\
+\tentries (=%d) than XMOD/XDIF entries (=%d) in file %s",pd->ny,pd->nx,
+	       infile); return 0;
+  } else if (pd->ny<pd->nx) {
+    nferrormsg("UVES_itphread(): There appears to be fewer YMOD/YDIF data\n\
+\tentries (=%d) than XMOD/XDIF entries (=%d) in file %s",pd->ny,pd->nx,
+	       infile); return 0;
+  }
+  pd->n=pd->nx;
+
+  return 1;
+
+}
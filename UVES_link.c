@@ -5,9 +5,11 @@
 * made and the relevant calibration files to be used. Also create a
 * master Set Of Frames file for each science exposure with enough
 * information included to allow a user to easily construct SOF files
-* for invidivual reduction steps.
+* for invidivual reduction steps. Optionally, write those SOF files
+* directly as well.
 ****************************************************************************/
 
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -15,47 +17,104 @@
 #include "file.h"
 #include "error.h"
 
-int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
+#define FREELK free(recs); if (info_file!=NULL) UVES_mfclose(mfst,info_file); \
+  if (sof_file!=NULL) UVES_mfclose(mfst,sof_file);
 
-  double temp=0.0;
-  int    first=0;
+/* Add a record to the list of master SOF file records */
+static void UVES_linksof(sofrec *recs, int *nrec, char *file, char *tag,
+			 char *red) {
+
+  strcpy(recs[*nrec].file,file); strcpy(recs[*nrec].tag,tag);
+  strcpy(recs[(*nrec)++].red,red);
+
+}
+
+int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis, int sof,
+	      manifest *mfst, hsstats *st) {
+
+  double temp=0.0,t0=0.0;
+  int    first=0,ok=0;
+  int    nrec=0;
   int    i=0,j=0;
   char   sciname[LNGSTRLEN]="\0",calname[LNGSTRLEN]="\0";
   char   filedesc[NAMELEN]="\0",reddesc[LNGSTRLEN]="\0";
-  char   infofile[NAMELEN]="\0",soffile[NAMELEN]="\0";
+  char   infofile[NAMELEN]="\0",soffile[NAMELEN]="\0",sofbase[NAMELEN]="\0";
   char   callnkpth[LNGSTRLEN]="\0",callnktrg[LNGSTRLEN]="\0";
-  FILE   *info_file,*sof_file;
+  FILE   *info_file=NULL,*sof_file=NULL;
+  sofrec *recs=NULL;
+  /* Frames expected to be produced in different reduction steps */
+  static char *sofblue[7][3]={
+    {"masterbias_blue.fits","MASTER_BIAS_BLUE","flat,wav1,wav2,std,sci"},
+    {"masterflat_blue.fits","MASTER_FLAT_BLUE","wav1,wav2,std,sci"},
+    {"orderguesstable_blue.fits","ORDER_GUESS_TAB_BLUE","ord"},
+    {"ordertable_blue.fits","ORDER_TABLE_BLUE","flat,wav1,wav2,std,sci"},
+    {"lineguesstable_blue.fits","LINE_GUESS_TAB_BLUE","wav1,wav2"},
+    {"weights_blue.fits","WEIGHTS_BLUE","wav2"},
+    {"linetable_blue.fits","LINE_TABLE_BLUE","std,sci"}};
+  static char *sofred[14][3]={
+    {"masterbias_redl.fits","MASTER_BIAS_REDL","flat,wav1,wav2,std,sci"},
+    {"masterbias_redu.fits","MASTER_BIAS_REDU","flat,wav1,wav2,std,sci"},
+    {"masterflat_redl.fits","MASTER_FLAT_REDL","wav1,wav2,std,sci"},
+    {"masterflat_redu.fits","MASTER_FLAT_REDU","wav1,wav2,std,sci"},
+    {"orderguesstable_redl.fits","ORDER_GUESS_TAB_REDL","ord"},
+    {"orderguesstable_redu.fits","ORDER_GUESS_TAB_REDU","ord"},
+    {"ordertable_redl.fits","ORDER_TABLE_REDL","flat,wav1,wav2,std,sci"},
+    {"ordertable_redu.fits","ORDER_TABLE_REDU","flat,wav1,wav2,std,sci"},
+    {"lineguesstable_redl.fits","LINE_GUESS_TAB_REDL","wav1,wav2"},
+    {"lineguesstable_redu.fits","LINE_GUESS_TAB_REDU","wav1,wav2"},
+    {"weights_redl.fits","WEIGHTS_REDL","wav2"},
+    {"weights_redu.fits","WEIGHTS_REDU","wav2"},
+    {"linetable_redl.fits","LINE_TABLE_REDL","std,sci"},
+    {"linetable_redu.fits","LINE_TABLE_REDU","std,sci"}};
+  static char *sofref[3][3]={
+    {"thargood.fits","LINE_REFER_TABLE","pred,wav1,wav2"},
+    {"atmoexan.fits","EXTCOEFF_TABLE","std"},
+    {"flxstd.fits","FLUX_STD_TABLE","std"}};
+
+  /* Allocate memory for master SOF file records */
+  if (!(recs=(sofrec *)malloc((size_t)(NSOFREC*sizeof(sofrec))))) {
+    nferrormsg("UVES_link(): Cannot allocate memory for SOF records\n\
+\tarray of size %d",NSOFREC); return 0;
+  }
 
   for (i=0; i<nscis; i++) {
 
-    /* See if this is the first time this object has been encountered */
+    /* Only science exposures ready for output are written */
+    if (scis[i].hdr.emit!=EMIT_READY) continue;
+    t0=UVES_hstrnow(st);
+
+    /* See if this is the first time this object has been encountered,
+       here or in earlier output */
     first=1;
-    j=0; while (first && j<i)
-      if (!strcmp(scis[j++].hdr.obj,scis[i].hdr.obj)) first=0;
+    for (j=0; first && j<nscis; j++)
+      if (!strcmp(scis[j].hdr.obj,scis[i].hdr.obj) &&
+	  (scis[j].hdr.emit==EMIT_DONE ||
+	   (j<i && scis[j].hdr.emit==EMIT_READY))) first=0;
 
     /* Create (or check for) object directory */
     if (!isdir(scis[i].hdr.obj) && first) {
-      if (mkdir(scis[i].hdr.obj,DIR_PERM))
-	errormsg("UVES_link(): Cannot create directory %s.\n\
-\tCheck permission settings?",scis[i].hdr.obj);
+      if (mkdir(scis[i].hdr.obj,DIR_PERM)) {
+	FREELK;
+	nferrormsg("UVES_link(): Cannot create directory %s.\n\
+\tCheck permission settings?",scis[i].hdr.obj); return 0;
+      }
+      if (st!=NULL) st->ndir++;
+    }
+    else if (first) {
+      FREELK;
+      nferrormsg("UVES_link(): Object directory %s\n\
+\talready exists!",scis[i].hdr.obj); return 0;
     }
-    else if (first)
-      errormsg("UVES_link(): Object directory %s\n\
-\talready exists!",scis[i].hdr.obj);
 
     /* Define info file name and open it for writing */
     sprintf(infofile,"%s/info_%s_%2.2d.dat",scis[i].hdr.obj,scis[i].hdr.cwl,
 	    scis[i].sciind);
-    if ((info_file=faskwopen("Science exposure information file?",infofile,4))
-	==NULL) errormsg("UVES_link(): Cannot open science exposure\n\
-\tinformation file\n\t%s for writing",infofile);
-
-    /* Define SOF file name and open it for writing */
-    sprintf(soffile,"%s/reduce_%s_%2.2d.sof",scis[i].hdr.obj,scis[i].hdr.cwl,
-	    scis[i].sciind);
-    if ((sof_file=faskwopen("Science exposure SOF file?",soffile,4))==NULL)
-      errormsg("UVES_link(): Cannot open science exposure\n\
-\tSOF file\n\t%s for writing",soffile);
+    if ((info_file=UVES_mfopen(mfst,"Science exposure information file?",
+			       infofile))==NULL) {
+      FREELK;
+      nferrormsg("UVES_link(): Cannot open science exposure\n\
+\tinformation file\n\t%s for writing",infofile); return 0;
+    }
 
     /* Enter details of science exposure into info file */
     sprintf(sciname,"%s_%s_%s_%2.2d.fits",scis[i].hdr.obj,scis[i].hdr.typ,
@@ -65,23 +124,30 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
 	    sciname,scis[i].hdr.abfile,scis[i].hdr.sw,scis[i].hdr.et,scis[i].hdr.mjd,
 	    temp,scis[i].hdr.p,scis[i].hdr.enc);
 
-    /* Enter details of science exposure into SOF file */
+    /* Enter details of science exposure into SOF records */
     if (!strcmp(scis[i].arm,"blue")) sprintf(filedesc,"SCIENCE_BLUE");
     else  sprintf(filedesc,"SCIENCE_RED");
     sprintf(reddesc,"sci");
-    fprintf(sof_file,"%s %s %s\n",sciname,filedesc,reddesc);
+    nrec=0; UVES_linksof(recs,&nrec,sciname,filedesc,reddesc);
 
     /* Determine science frame index string and make appropriate symlink */
     sprintf(scis[i].hdr.lnkpth,"%s/%s",scis[i].hdr.obj,sciname);
     if (access(scis[i].hdr.lnkpth,F_OK)) {
 	sprintf(scis[i].hdr.lnktrg,"%s",scis[i].hdr.file);
-	if (symlink(scis[i].hdr.lnktrg,scis[i].hdr.lnkpth))
-	  errormsg("UVES_link(): Cannot create symlink %s\n\
+	if (symlink(scis[i].hdr.lnktrg,scis[i].hdr.lnkpth)) {
+	  FREELK;
+	  nferrormsg("UVES_link(): Cannot create symlink %s\n\
 \tto file %s\n\
-\tCheck permission settings?",scis[i].hdr.lnkpth,scis[i].hdr.lnktrg);
+\tCheck permission settings?",scis[i].hdr.lnkpth,scis[i].hdr.lnktrg); return 0;
+	}
+	if (st!=NULL) st->nlink++;
     }
-    else errormsg("UVES_link(): Symlink %s\n\
+    else {
+      FREELK;
+      nferrormsg("UVES_link(): Symlink %s\n\
 \tin directory %s already exists. Solution unknown!",sciname,scis[i].hdr.obj);
+      return 0;
+    }
 
     /* Generate links to stds */
     for (j=0; j<scis[i].ns; j++) {
@@ -89,9 +155,12 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
 	      hdrs[scis[i].sind[j]].typ,scis[i].hdr.cwl,scis[i].sciind,j+1);
       sprintf(callnkpth,"%s/%s",scis[i].hdr.obj,calname);
       sprintf(callnktrg,"%s",hdrs[scis[i].sind[j]].file);
-      if (symlink(callnktrg,callnkpth))
-	errormsg("Cannot create symlink %s\n\tto file %s.\n\
-\tCheck permission settings?",callnkpth,callnktrg);
+      if (symlink(callnktrg,callnkpth)) {
+	FREELK;
+	nferrormsg("Cannot create symlink %s\n\tto file %s.\n\
+\tCheck permission settings?",callnkpth,callnktrg); return 0;
+      }
+      if (st!=NULL) st->nlink++;
       temp=(!strcmp(scis[i].arm,"blue")) ? hdrs[scis[i].sind[j]].tb :
 	hdrs[scis[i].sind[j]].tr;
       fprintf(info_file,
@@ -102,7 +171,7 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
       if (!strcmp(scis[i].arm,"blue")) sprintf(filedesc,"STANDARD_BLUE");
       else  sprintf(filedesc,"STANDARD_RED");
       sprintf(reddesc,"std");
-      fprintf(sof_file,"%s %s %s\n",calname,filedesc,reddesc);
+      UVES_linksof(recs,&nrec,calname,filedesc,reddesc);
     }
 
     /* Generate links to wavs */
@@ -111,9 +180,12 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
 	      hdrs[scis[i].wind[j]].typ,scis[i].hdr.cwl,scis[i].sciind,j+1);
       sprintf(callnkpth,"%s/%s",scis[i].hdr.obj,calname);
       sprintf(callnktrg,"%s",hdrs[scis[i].wind[j]].file);
-      if (symlink(callnktrg,callnkpth))
-	errormsg("Cannot create symlink %s\n\tto file %s.\n\
-\tCheck permission settings?",callnkpth,callnktrg);
+      if (symlink(callnktrg,callnkpth)) {
+	FREELK;
+	nferrormsg("Cannot create symlink %s\n\tto file %s.\n\
+\tCheck permission settings?",callnkpth,callnktrg); return 0;
+      }
+      if (st!=NULL) st->nlink++;
       temp=(!strcmp(scis[i].arm,"blue")) ? hdrs[scis[i].wind[j]].tb :
 	hdrs[scis[i].wind[j]].tr;
       fprintf(info_file,
@@ -124,7 +196,7 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
       if (!strcmp(scis[i].arm,"blue")) sprintf(filedesc,"ARC_LAMP_BLUE");
       else  sprintf(filedesc,"ARC_LAMP_RED");
       sprintf(reddesc,"wav1,wav2");
-      fprintf(sof_file,"%s %s %s\n",calname,filedesc,reddesc);
+      UVES_linksof(recs,&nrec,calname,filedesc,reddesc);
     }
 
     /* Generate links to ords */
@@ -133,9 +205,12 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
 	      hdrs[scis[i].oind[j]].typ,scis[i].hdr.cwl,scis[i].sciind,j+1);
       sprintf(callnkpth,"%s/%s",scis[i].hdr.obj,calname);
       sprintf(callnktrg,"%s",hdrs[scis[i].oind[j]].file);
-      if (symlink(callnktrg,callnkpth))
-	errormsg("Cannot create symlink %s\n\tto file %s.\n\
-\tCheck permission settings?",callnkpth,callnktrg);
+      if (symlink(callnktrg,callnkpth)) {
+	FREELK;
+	nferrormsg("Cannot create symlink %s\n\tto file %s.\n\
+\tCheck permission settings?",callnkpth,callnktrg); return 0;
+      }
+      if (st!=NULL) st->nlink++;
       temp=(!strcmp(scis[i].arm,"blue")) ? hdrs[scis[i].oind[j]].tb :
 	hdrs[scis[i].oind[j]].tr;
       fprintf(info_file,
@@ -146,7 +221,7 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
       if (!strcmp(scis[i].arm,"blue")) sprintf(filedesc,"ORDER_FLAT_BLUE");
       else  sprintf(filedesc,"ORDER_FLAT_RED");
       sprintf(reddesc,"ord");
-      fprintf(sof_file,"%s %s %s\n",calname,filedesc,reddesc);
+      UVES_linksof(recs,&nrec,calname,filedesc,reddesc);
     }
 
     /* Generate links to fmts */
@@ -155,9 +230,12 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
 	      hdrs[scis[i].fmind[j]].typ,scis[i].hdr.cwl,scis[i].sciind,j+1);
       sprintf(callnkpth,"%s/%s",scis[i].hdr.obj,calname);
       sprintf(callnktrg,"%s",hdrs[scis[i].fmind[j]].file);
-      if (symlink(callnktrg,callnkpth))
-	errormsg("Cannot create symlink %s\n\tto file %s.\n\
-\tCheck permission settings?",callnkpth,callnktrg);
+      if (symlink(callnktrg,callnkpth)) {
+	FREELK;
+	nferrormsg("Cannot create symlink %s\n\tto file %s.\n\
+\tCheck permission settings?",callnkpth,callnktrg); return 0;
+      }
+      if (st!=NULL) st->nlink++;
       temp=(!strcmp(scis[i].arm,"blue")) ? hdrs[scis[i].fmind[j]].tb :
 	hdrs[scis[i].fmind[j]].tr;
       fprintf(info_file,
@@ -168,7 +246,7 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
       if (!strcmp(scis[i].arm,"blue")) sprintf(filedesc,"ARC_LAMP_FORM_BLUE");
       else  sprintf(filedesc,"ARC_LAMP_FORM_RED");
       sprintf(reddesc,"pred");
-      fprintf(sof_file,"%s %s %s\n",calname,filedesc,reddesc);
+      UVES_linksof(recs,&nrec,calname,filedesc,reddesc);
     }
 
     /* Generate links to flats */
@@ -177,10 +255,13 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
 	      hdrs[scis[i].flind[j]].typ,scis[i].hdr.cwl,scis[i].sciind,j+1);
       sprintf(callnkpth,"%s/%s",scis[i].hdr.obj,calname);
       sprintf(callnktrg,"%s",hdrs[scis[i].flind[j]].file);
-      if (symlink(callnktrg,callnkpth))
-	errormsg("Cannot create symlink %s\n\
+      if (symlink(callnktrg,callnkpth)) {
+	FREELK;
+	nferrormsg("Cannot create symlink %s\n\
 \tto file %s.\n\
-\tCheck permission settings?",callnkpth,callnktrg);
+\tCheck permission settings?",callnkpth,callnktrg); return 0;
+      }
+      if (st!=NULL) st->nlink++;
       temp=(!strcmp(scis[i].arm,"blue")) ? hdrs[scis[i].flind[j]].tb :
 	hdrs[scis[i].flind[j]].tr;
       fprintf(info_file,
@@ -191,7 +272,7 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
       if (!strcmp(scis[i].arm,"blue")) sprintf(filedesc,"FLAT_BLUE");
       else  sprintf(filedesc,"FLAT_RED");
       sprintf(reddesc,"flat");
-      fprintf(sof_file,"%s %s %s\n",calname,filedesc,reddesc);
+      UVES_linksof(recs,&nrec,calname,filedesc,reddesc);
     }
 
     /* Generate links to biases */
@@ -200,9 +281,12 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
 	      hdrs[scis[i].bind[j]].typ,scis[i].hdr.cwl,scis[i].sciind,j+1);
       sprintf(callnkpth,"%s/%s",scis[i].hdr.obj,calname);
       sprintf(callnktrg,"%s",hdrs[scis[i].bind[j]].file);
-      if (symlink(callnktrg,callnkpth))
-	errormsg("Cannot create symlink %s\n\tto file %s.\n\
-\tCheck permission settings?",callnkpth,callnktrg);
+      if (symlink(callnktrg,callnkpth)) {
+	FREELK;
+	nferrormsg("Cannot create symlink %s\n\tto file %s.\n\
+\tCheck permission settings?",callnkpth,callnktrg); return 0;
+      }
+      if (st!=NULL) st->nlink++;
       temp=(!strcmp(scis[i].arm,"blue")) ? hdrs[scis[i].bind[j]].tb :
 	hdrs[scis[i].bind[j]].tr;
       fprintf(info_file,
@@ -213,44 +297,58 @@ int UVES_link(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
       if (!strcmp(scis[i].arm,"blue")) sprintf(filedesc,"BIAS_BLUE");
       else  sprintf(filedesc,"BIAS_RED");
       sprintf(reddesc,"bias");
-      fprintf(sof_file,"%s %s %s\n",calname,filedesc,reddesc);
+      UVES_linksof(recs,&nrec,calname,filedesc,reddesc);
     }
 
-    /* Complete SOF file with files expected to be produced in
+    /* Complete SOF records with files expected to be produced in
        different reduction steps */
-    if (!strcmp(scis[i].arm,"blue")) fprintf(sof_file,"\
-masterbias_blue.fits MASTER_BIAS_BLUE flat,wav1,wav2,std,sci\n\
-masterflat_blue.fits MASTER_FLAT_BLUE wav1,wav2,std,sci\n\
-orderguesstable_blue.fits ORDER_GUESS_TAB_BLUE ord\n\
-ordertable_blue.fits ORDER_TABLE_BLUE flat,wav1,wav2,std,sci\n\
-lineguesstable_blue.fits LINE_GUESS_TAB_BLUE wav1,wav2\n\
-weights_blue.fits WEIGHTS_BLUE wav2\n\
-linetable_blue.fits LINE_TABLE_BLUE std,sci\n");
-    else fprintf(sof_file,"\
-masterbias_redl.fits MASTER_BIAS_REDL flat,wav1,wav2,std,sci\n\
-masterbias_redu.fits MASTER_BIAS_REDU flat,wav1,wav2,std,sci\n\
-masterflat_redl.fits MASTER_FLAT_REDL wav1,wav2,std,sci\n\
-masterflat_redu.fits MASTER_FLAT_REDU wav1,wav2,std,sci\n\
-orderguesstable_redl.fits ORDER_GUESS_TAB_REDL ord\n\
-orderguesstable_redu.fits ORDER_GUESS_TAB_REDU ord\n\
-ordertable_redl.fits ORDER_TABLE_REDL flat,wav1,wav2,std,sci\n\
-ordertable_redu.fits ORDER_TABLE_REDU flat,wav1,wav2,std,sci\n\
-lineguesstable_redl.fits LINE_GUESS_TAB_REDL wav1,wav2\n\
-lineguesstable_redu.fits LINE_GUESS_TAB_REDU wav1,wav2\n\
-weights_redl.fits WEIGHTS_REDL wav2\n\
-weights_redu.fits WEIGHTS_REDU wav2\n\
-linetable_redl.fits LINE_TABLE_REDL std,sci\n\
-linetable_redu.fits LINE_TABLE_REDU std,sci\n");
-    fprintf(sof_file,"\
-thargood.fits LINE_REFER_TABLE pred,wav1,wav2\n\
-atmoexan.fits EXTCOEFF_TABLE std\n\
-flxstd.fits FLUX_STD_TABLE std\n");
+    if (!strcmp(scis[i].arm,"blue")) {
+      for (j=0; j<7; j++)
+	UVES_linksof(recs,&nrec,sofblue[j][0],sofblue[j][1],sofblue[j][2]);
+    }
+    else {
+      for (j=0; j<14; j++)
+	UVES_linksof(recs,&nrec,sofred[j][0],sofred[j][1],sofred[j][2]);
+    }
+    for (j=0; j<3; j++)
+      UVES_linksof(recs,&nrec,sofref[j][0],sofref[j][1],sofref[j][2]);
+
+    /* Define SOF file name, open it for writing and write records */
+    sprintf(sofbase,"%s/reduce_%s_%2.2d",scis[i].hdr.obj,scis[i].hdr.cwl,
+	    scis[i].sciind);
+    sprintf(soffile,"%s.sof",sofbase);
+    if ((sof_file=UVES_mfopen(mfst,"Science exposure SOF file?",soffile))==NULL) {
+      FREELK;
+      nferrormsg("UVES_link(): Cannot open science exposure\n\
+\tSOF file\n\t%s for writing",soffile); return 0;
+    }
+    for (j=0; j<nrec; j++)
+      fprintf(sof_file,"%s %s %s\n",recs[j].file,recs[j].tag,recs[j].red);
+
+    /* Write SOF files for individual reduction steps if requested */
+    if (sof && !UVES_sofsplit(recs,nrec,sofbase,mfst)) {
+      FREELK;
+      nferrormsg("UVES_link(): Unknown error returned from UVES_sofsplit()");
+      return 0;
+    }
 
     /* Close files */
-    fclose(info_file); fclose(sof_file);
+    ok=UVES_mfclose(mfst,info_file); ok=UVES_mfclose(mfst,sof_file) && ok;
+    info_file=sof_file=NULL;
+    if (!ok) {
+      free(recs);
+      nferrormsg("UVES_link(): Cannot complete writing of files\n\t%s and %s",
+		 infofile,soffile); return 0;
+    }
+    UVES_hstrspan(st,"link",scis[i].hdr.obj,scis[i].hdr.file,t0,
+		  "\"newdir\":%d,\"links\":%d",first,1+scis[i].ns+scis[i].nw+
+		  scis[i].no+scis[i].nfm+scis[i].nfl+scis[i].nb);
 
   }
 
+  /* Clean up */
+  free(recs);
+
   return 1;
 
 }
@@ -2,6 +2,7 @@
 * Create list of relevant files for each science object in input list
 ****************************************************************************/
 
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -19,30 +20,38 @@ int UVES_list(header *hdrs, int nhdrs, scihdr *scis, int nscis) {
   FILE   *list_file;
 
   /* Allocate memory for index recording array */
-  if ((idx=iarray(nhdrs))==NULL)
-    errormsg("UVES_list(): Cannot allocate memory for idx\n\tarray of size %d",
-	     nhdrs);
+  if ((idx=iarray(nhdrs))==NULL) {
+    nferrormsg("UVES_list(): Cannot allocate memory for idx\n\tarray of size %d",
+	       nhdrs); return 0;
+  }
 
   /* Loop over science exposures */
   for (i=0; i<nscis; i++) {
+    /* Only objects with science exposures ready for output are written */
+    if (scis[i].hdr.emit!=EMIT_READY) continue;
+
     /* See if this is the first time this object has been encountered */
     first=1;
-    j=0; while (first && j<i)
-      if (!strcmp(scis[j++].hdr.obj,scis[i].hdr.obj)) first=0;
+    for (j=0; first && j<i; j++)
+      if (scis[j].hdr.emit==EMIT_READY &&
+	  !strcmp(scis[j].hdr.obj,scis[i].hdr.obj)) first=0;
 
     /* Is this the first time this object has been encountered */
     if (first) {
       /* Define list file name and open it for writing */
       sprintf(listfile,"%s.list",scis[i].hdr.obj);
-      if ((list_file=faskwopen("File list for new object?",listfile,4))==NULL)
-	errormsg("UVES_list(): Cannot open file list for\n\
-\tobject %s for writing",scis[i].hdr.obj);
+      if ((list_file=faskwopen("File list for new object?",listfile,4))==NULL) {
+	free(idx);
+	nferrormsg("UVES_list(): Cannot open file list for\n\
+\tobject %s for writing",scis[i].hdr.obj); return 0;
+      }
 
       /* Initialise index counter for this object */
       nidx=0;
 
-      /* Loop over all science exposures of this object */
-      for (j=i; j<nscis; j++) { if (!strcmp(scis[i].hdr.obj,scis[j].hdr.obj)) {
+      /* Loop over all science exposures of this object written so far */
+      for (j=0; j<nscis; j++) { if (scis[j].hdr.emit!=EMIT_PEND &&
+				    !strcmp(scis[i].hdr.obj,scis[j].hdr.obj)) {
 	fprintf(list_file,"%s\n",scis[j].hdr.file);
 	for (k=0; k<scis[j].ns; k++) {
 	  for (l=0; l<nidx; l++) if (idx[l]==scis[j].sind[k]) break;
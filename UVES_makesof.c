@@ -0,0 +1,194 @@
+/****************************************************************************
+
+UVES_makesof: Write SOF files for the individual reduction steps of
+science exposures from their master SOF files, as written by
+UVES_headsort. This is a native, batch replacement for uves_makesof.csh.
+
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+/* Global declarations */
+char      *progname;
+
+/****************************************************************************
+* Print the usage message
+****************************************************************************/
+
+void usage(void) {
+
+  fprintf(stderr,"\n%s: Write SOF files for individual reduction steps\n\
+\tfrom master SOF files written by UVES_headsort\n",progname);
+
+  fprintf(stderr,"\nBy Michael Murphy (http://astronomy.swin.edu.au/~mmurphy)\n\
+\nVersion: %4.2lf (19 Feb 2018)\n",VERSION);
+
+  fprintf(stderr,"\nUsage: %s [OPTIONS] [Exposures, SOF files or directories]\n",
+	  progname);
+
+  fprintf(stderr, "\nOptions:\n\
+  -h, -help         : Print this message.\n\
+\nEach argument may be an exposure (e.g. 390_02 for reduce_390_02.sof in\n\
+the current directory), a master SOF file, or a directory in which all\n\
+master SOF files (reduce_<cwl>_<index>.sof) are processed.\n\n");
+  exit(3);
+}
+
+/****************************************************************************
+* Determine whether a file name is that of a master SOF file,
+* i.e. reduce_<digits>_<digits>.sof
+****************************************************************************/
+
+int UVES_ismastsof(char *name) {
+
+  char     *cptr=NULL;
+
+  if (strncmp(name,"reduce_",7)) return 0;
+  cptr=name+7; if (!isdigit((int)*cptr)) return 0;
+  while (isdigit((int)*cptr)) cptr++;
+  if (*cptr++!='_' || !isdigit((int)*cptr)) return 0;
+  while (isdigit((int)*cptr)) cptr++;
+
+  return (strcmp(cptr,".sof")) ? 0 : 1;
+
+}
+
+/****************************************************************************
+* Split a single master SOF file into the SOF files for each reduction
+* step
+****************************************************************************/
+
+int UVES_makesof(char *soffile, sofrec **recs, int *nrecmax) {
+
+  int      nrec=0;
+  int      i=0;
+  char     base[LNGSTRLEN]="\0",stepfile[LNGSTRLEN]="\0";
+  char     buffer[VLNGSTRLEN]="\0";
+  FILE     *data_file=NULL;
+  sofrec   *tmprec=NULL;
+  static char *step[NSOFSTEP]={"pred","ord","bias","flat","wav1","wav2",
+			       "std","sci"};
+
+  /* Determine base name for step SOF files */
+  if (strlen(soffile)>=LNGSTRLEN-10) {
+    nferrormsg("UVES_makesof(): SOF file name too long:\n\t%s",soffile);
+    return 0;
+  }
+  strcpy(base,soffile); base[strlen(base)-4]='\0';
+
+  /* Check for step SOF files which would be overwritten */
+  for (i=0; i<NSOFSTEP; i++) {
+    sprintf(stepfile,"%s_%s.sof",base,step[i]);
+    if (!access(stepfile,F_OK)) {
+      if (access(stepfile,W_OK)) {
+	nferrormsg("UVES_makesof(): Cannot overwrite existing file\n\t%s",
+		   stepfile); return 0;
+      }
+      warnmsg("Will overwrite existing file %s",stepfile);
+    }
+  }
+
+  /* Read records from master SOF file */
+  if ((data_file=faskropen("Master SOF file?",soffile,5))==NULL) {
+    nferrormsg("UVES_makesof(): Cannot open file\n\t%s",soffile); return 0;
+  }
+  while (fgets(buffer,VLNGSTRLEN,data_file)!=NULL) {
+    if (nrec==*nrecmax) {
+      *nrecmax=(*nrecmax) ? 2*(*nrecmax) : NSOFREC;
+      if (!(tmprec=(sofrec *)realloc(*recs,(size_t)(*nrecmax*sizeof(sofrec))))) {
+	fclose(data_file);
+	nferrormsg("UVES_makesof(): Cannot allocate memory for SOF\n\
+\trecords array of size %d",*nrecmax); return 0;
+      }
+      *recs=tmprec;
+    }
+    /* Skip blank lines; records without a step field are never used */
+    if (sscanf(buffer,"%s %s %s",(*recs)[nrec].file,(*recs)[nrec].tag,
+	       (*recs)[nrec].red)==3) nrec++;
+  }
+  fclose(data_file);
+
+  /* Write SOF files for each step */
+  if (!UVES_sofsplit(*recs,nrec,base,NULL)) {
+    nferrormsg("UVES_makesof(): Unknown error returned from UVES_sofsplit()");
+    return 0;
+  }
+
+  return 1;
+
+}
+
+/****************************************************************************
+* The main program
+
+  Things to do:
+
+****************************************************************************/
+
+int main(int argc, char *argv[]) {
+
+  int      nrecmax=0,nsof=0,nerr=0;
+  int      i=0;
+  char     soffile[LNGSTRLEN]="\0";
+  DIR      *dir=NULL;
+  struct   dirent *ent=NULL;
+  sofrec   *recs=NULL;
+
+  /* Define the program name from the command line input */
+  progname=((progname=strrchr(argv[0],'/'))==NULL) ? argv[0] : progname+1;
+  /* Must be at least one argument */
+  if (argc==1) usage();
+
+  /* Process each argument in turn */
+  while (++i<argc) {
+    if (!strcmp(argv[i],"-help") || !strcmp(argv[i],"-h")) usage();
+    /* Directory: process all master SOF files in it */
+    if (isdir(argv[i])) {
+      if ((dir=opendir(argv[i]))==NULL) {
+	nferrormsg("Cannot open directory %s",argv[i]); nerr++; continue;
+      }
+      while ((ent=readdir(dir))!=NULL) {
+	if (!UVES_ismastsof(ent->d_name)) continue;
+	if (snprintf(soffile,LNGSTRLEN,"%s/%s",argv[i],ent->d_name)>=LNGSTRLEN) {
+	  nferrormsg("File name too long in directory %s",argv[i]);
+	  nerr++; continue;
+	}
+	if (!UVES_makesof(soffile,&recs,&nrecmax)) nerr++;
+	else nsof++;
+      }
+      closedir(dir);
+      continue;
+    }
+    /* Exposure or master SOF file */
+    if (strlen(argv[i])+12>LNGSTRLEN) {
+      nferrormsg("Argument too long: %s",argv[i]); nerr++; continue;
+    }
+    if (!access(argv[i],R_OK)) strcpy(soffile,argv[i]);
+    else sprintf(soffile,"reduce_%s.sof",argv[i]);
+    if (access(soffile,R_OK)) {
+      nferrormsg("Cannot find/read file %s",soffile); nerr++; continue;
+    }
+    if (strlen(soffile)<5 || strcmp(soffile+strlen(soffile)-4,".sof")) {
+      nferrormsg("File %s is not a SOF file",soffile); nerr++; continue;
+    }
+    if (!UVES_makesof(soffile,&recs,&nrecmax)) nerr++;
+    else nsof++;
+  }
+
+  /* Clean up */
+  if (recs!=NULL) free(recs);
+
+  if (nerr) errormsg("Failed to process %d of %d master SOF files",nerr,
+		     nerr+nsof);
+  if (!nsof) warnmsg("No master SOF files found");
+
+  return 1;
+
+}
@@ -0,0 +1,257 @@
+/****************************************************************************
+
+UVES_manifest: List or extract files stored in a UVES_headsort manifest
+
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+/* Global declarations */
+char      *progname;
+
+/****************************************************************************
+* Print the usage message
+****************************************************************************/
+
+void usage(void) {
+
+  fprintf(stderr,"\n%s: List or extract files stored in a manifest\n\
+\twritten by UVES_headsort -manifest\n",progname);
+
+  fprintf(stderr,"\nBy Michael Murphy (http://astronomy.swin.edu.au/~mmurphy)\n\
+\nVersion: %4.2lf (19 Feb 2018)\n",VERSION);
+
+  fprintf(stderr,"\nUsage: %s [OPTIONS] [Manifest file] [opt. file names]\n",
+	  progname);
+
+  fprintf(stderr, "\nOptions:\n\
+  -l                : List files stored in manifest instead of extracting.\n\
+  -o DIR            : Extract files into directory DIR instead of directory\n\
+                       containing the manifest.\n\
+  -h, -help         : Print this message.\n\
+\nFile names may contain shell wildcards (quote them). If no file names\n\
+are given, all files in the manifest are extracted.\n\n");
+  exit(3);
+}
+
+/****************************************************************************
+* Read the index of a manifest file. If the trailer is missing (e.g. the
+* run was interrupted) the records are scanned sequentially instead.
+****************************************************************************/
+
+int UVES_mfrdindex(FILE *fp, char *mfstfile, mfstrec **rec, int *nrec) {
+
+  long     off=0,size=0;
+  int      n=0,nmax=0,vers=0;
+  char     buffer[VLNGSTRLEN]="\0",magic[NAMELEN]="\0";
+  mfstrec  *tmprec=NULL;
+
+  /* Check magic string and version number */
+  if (fgets(buffer,VLNGSTRLEN,fp)==NULL ||
+      sscanf(buffer,"%s %d",magic,&vers)!=2 || strcmp(magic,MFSTMAGIC)) {
+    nferrormsg("UVES_mfrdindex(): File %s\n\tis not a manifest file",mfstfile);
+    return 0;
+  }
+  if (vers>MFSTVERS) {
+    nferrormsg("UVES_mfrdindex(): Manifest %s\n\thas version %d but only\n\
+\tversions <= %d are understood",mfstfile,vers,MFSTVERS); return 0;
+  }
+
+  /* Try to use the trailer to locate the index */
+  if (!fseek(fp,-MFSTTRLEN,SEEK_END) && fgets(buffer,VLNGSTRLEN,fp)!=NULL &&
+      sscanf(buffer,"#TRAILER %ld",&off)==1 && !fseek(fp,off,SEEK_SET) &&
+      fgets(buffer,VLNGSTRLEN,fp)!=NULL && sscanf(buffer,"#INDEX %d",&n)==1) {
+    if (!n) { *rec=NULL; *nrec=0; return 1; }
+    if (!(*rec=(mfstrec *)malloc((size_t)(n*sizeof(mfstrec))))) {
+      nferrormsg("UVES_mfrdindex(): Cannot allocate memory for index\n\
+\tof size %d",n); return 0;
+    }
+    for (*nrec=0; *nrec<n; (*nrec)++) {
+      if (fgets(buffer,VLNGSTRLEN,fp)==NULL ||
+	  sscanf(buffer,"%ld %ld %s",&((*rec)[*nrec].off),&((*rec)[*nrec].len),
+		 (*rec)[*nrec].name)!=3) {
+	nferrormsg("UVES_mfrdindex(): Corrupt index entry %d in\n\
+\tmanifest %s",*nrec+1,mfstfile); free(*rec); return 0;
+      }
+    }
+    return 1;
+  }
+
+  /* No valid trailer: scan records sequentially */
+  warnmsg("No valid index found in manifest %s.\n\
+\tScanning records sequentially",mfstfile);
+  *rec=NULL; *nrec=0;
+  fseek(fp,0,SEEK_END); size=ftell(fp);
+  rewind(fp); fgets(buffer,VLNGSTRLEN,fp);
+  while (fgets(buffer,VLNGSTRLEN,fp)!=NULL && strncmp(buffer,"#INDEX",6)) {
+    if (*nrec==nmax) {
+      nmax=(nmax) ? 2*nmax : 64;
+      if (!(tmprec=(mfstrec *)realloc(*rec,(size_t)(nmax*sizeof(mfstrec))))) {
+	nferrormsg("UVES_mfrdindex(): Cannot allocate memory for index\n\
+\tof size %d",nmax); free(*rec); return 0;
+      }
+      *rec=tmprec;
+    }
+    if (sscanf(buffer,"#FILE %ld %s",&((*rec)[*nrec].len),(*rec)[*nrec].name)
+	!=2) {
+      nferrormsg("UVES_mfrdindex(): Corrupt record header in\n\
+\tmanifest %s",mfstfile); free(*rec); return 0;
+    }
+    (*rec)[*nrec].off=ftell(fp);
+    /* Only accept record if all of its contents are present */
+    if ((*rec)[*nrec].off+(*rec)[*nrec].len>size ||
+	fseek(fp,(*rec)[*nrec].len,SEEK_CUR)) break;
+    (*nrec)++;
+  }
+
+  return 1;
+
+}
+
+/****************************************************************************
+* Extract a single record into a file, creating any missing
+* subdirectories along the way
+****************************************************************************/
+
+int UVES_mfextract(FILE *fp, mfstrec *rec, char *outdir) {
+
+  long     n=0,nread=0;
+  char     outfile[VLNGSTRLEN]="\0",buffer[VVVLNGSTRLEN]="\0";
+  char     *cptr=NULL;
+  FILE     *out_file=NULL;
+
+  if (snprintf(outfile,VLNGSTRLEN,"%s%s%s",outdir,(strlen(outdir)) ? "/" : "",
+	       rec->name)>=VLNGSTRLEN) {
+    nferrormsg("UVES_mfextract(): Output file name too long for\n\tfile %s",
+	       rec->name); return 0;
+  }
+
+  /* Create subdirectories if required */
+  cptr=outfile+strlen(outdir)+1;
+  while ((cptr=strchr(cptr,'/'))!=NULL) {
+    *cptr='\0';
+    if (!isdir(outfile) && mkdir(outfile,DIR_PERM)) {
+      nferrormsg("UVES_mfextract(): Cannot create directory %s.\n\
+\tCheck permission settings?",outfile); return 0;
+    }
+    *cptr++='/';
+  }
+
+  /* Copy record contents to file */
+  if ((out_file=faskwopen("Output file?",outfile,4))==NULL) {
+    nferrormsg("UVES_mfextract(): Cannot open file %s for writing",outfile);
+    return 0;
+  }
+  if (fseek(fp,rec->off,SEEK_SET)) {
+    fclose(out_file);
+    nferrormsg("UVES_mfextract(): Cannot find record for file %s",rec->name);
+    return 0;
+  }
+  while (nread<rec->len) {
+    n=(rec->len-nread>VVVLNGSTRLEN) ? VVVLNGSTRLEN : rec->len-nread;
+    if (fread(buffer,1,n,fp)!=n || fwrite(buffer,1,n,out_file)!=n) {
+      fclose(out_file);
+      nferrormsg("UVES_mfextract(): Cannot copy record to file %s",outfile);
+      return 0;
+    }
+    nread+=n;
+  }
+  fclose(out_file);
+
+  return 1;
+
+}
+
+/****************************************************************************
+* The main program
+
+  Things to do:
+
+****************************************************************************/
+
+int main(int argc, char *argv[]) {
+
+  int      list=0,nrec=0,nname=0,nfound=0;
+  int      i=0,j=0;
+  int      *found=NULL;
+  char     mfstfile[VLNGSTRLEN]="\0",outdir[VLNGSTRLEN]="\0";
+  char     **name=NULL;
+  char     *cptr=NULL;
+  FILE     *mfst_file=NULL;
+  mfstrec  *rec=NULL;
+
+  /* Define the program name from the command line input */
+  progname=((progname=strrchr(argv[0],'/'))==NULL) ? argv[0] : progname+1;
+  /* Must be at least one argument */
+  if (argc==1) usage();
+  /* Allocate memory for file name list (at most argc names) */
+  if (!(name=(char **)malloc((size_t)(argc*sizeof(char *)))))
+    errormsg("Cannot allocate memory for file name list");
+  /* Scan command line for options */
+  while (++i<argc) {
+    if (!strcmp(argv[i],"-l")) list=1;
+    else if (!strcmp(argv[i],"-o")) {
+      if (++i>=argc || strlen(argv[i])>=VLNGSTRLEN) usage();
+      strcpy(outdir,argv[i]);
+    }
+    else if (!strcmp(argv[i],"-help") || !strcmp(argv[i],"-h")) usage();
+    else if (!strncmp(mfstfile,"\0",1)) {
+      if (access(argv[i],R_OK)) errormsg("File %s does not exist",argv[i]);
+      if (strlen(argv[i])>=VLNGSTRLEN)
+	errormsg("Manifest file name too long: %s",argv[i]);
+      strcpy(mfstfile,argv[i]);
+    }
+    else name[nname++]=argv[i];
+  }
+  /* Make sure a manifest file was specified */
+  if (!strncmp(mfstfile,"\0",1)) usage();
+  /* By default, extract into directory containing manifest */
+  if (!strncmp(outdir,"\0",1) && (cptr=strrchr(mfstfile,'/'))!=NULL) {
+    strncpy(outdir,mfstfile,cptr-mfstfile); outdir[cptr-mfstfile]='\0';
+  }
+  if (strlen(outdir) && !isdir(outdir))
+    errormsg("Output directory %s does not exist",outdir);
+
+  /* Open manifest and read its index */
+  if ((mfst_file=faskropen("Manifest file?",mfstfile,5))==NULL)
+    errormsg("Cannot open manifest file %s",mfstfile);
+  if (!UVES_mfrdindex(mfst_file,mfstfile,&rec,&nrec))
+    errormsg("Unknown error returned from UVES_mfrdindex()");
+  if (nname && (found=(int *)calloc((size_t)nname,sizeof(int)))==NULL)
+    errormsg("Cannot allocate memory for found array of size %d",nname);
+
+  /* List or extract the requested records */
+  for (i=0; i<nrec; i++) {
+    if (nname) {
+      for (j=0; j<nname; j++) if (!fnmatch(name[j],rec[i].name,0)) break;
+      if (j==nname) continue;
+      found[j]=1;
+    }
+    nfound++;
+    if (list) fprintf(stdout,"%10ld %s\n",rec[i].len,rec[i].name);
+    else if (!UVES_mfextract(mfst_file,&(rec[i]),outdir))
+      errormsg("Unknown error returned from UVES_mfextract()");
+  }
+  fclose(mfst_file);
+
+  /* Warn about requested files not found in manifest */
+  for (j=0; j<nname; j++)
+    if (!found[j]) warnmsg("No file matching %s found in manifest %s",name[j],
+			   mfstfile);
+  if (!nname && !nfound) warnmsg("Manifest %s contains no files",mfstfile);
+
+  /* Clean up */
+  if (rec!=NULL) free(rec);
+  if (found!=NULL) free(found);
+  free(name);
+
+  return 1;
+
+}
@@ -0,0 +1,223 @@
+/****************************************************************************
+* Routines for writing output files either individually or as records
+* in indexed manifest files, one per object directory or one for the
+* whole run.
+*
+* UVES_mfopen() returns a stream into which a single output file is
+* written. When no manifest is in use this is simply the opened file.
+* Otherwise the stream is an in-memory buffer which UVES_mfclose()
+* appends to the relevant manifest as a record. UVES_mffinish() writes
+* the index of records and a fixed-width trailer to each manifest.
+*
+* Manifest format:
+*   #UVESMF <version>
+*   #FILE <length> <name>        <- Repeated for each record
+*   <length bytes of contents>
+*   #INDEX <number of records>
+*   <offset> <length> <name>     <- Repeated for each record
+*   #TRAILER <offset of #INDEX line, zero-padded to 20 digits>
+****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+/* Find (or create) the manifest file which a named output file belongs to */
+static mfsttrg *UVES_mftarget(manifest *mfst, char *filename, char **name) {
+
+  int      i=0;
+  char     dir[NAMELEN]="\0",file[NAMELEN]="\0";
+  char     *cptr=NULL;
+  mfsttrg  *trg=NULL;
+
+  /* Determine manifest file name and name of record within it */
+  if (mfst->mode==MFST_OBJ && (cptr=strrchr(filename,'/'))!=NULL) {
+    if (cptr-filename>=NAMELEN-strlen(MFSTFILE)-1) {
+      nferrormsg("UVES_mftarget(): Directory name too long in file\n\t%s",
+		 filename); return NULL;
+    }
+    strncpy(dir,filename,cptr-filename); dir[cptr-filename]='\0';
+    sprintf(file,"%s/%s",dir,MFSTFILE); *name=cptr+1;
+  }
+  else { strcpy(file,MFSTFILE); *name=filename; }
+
+  /* Search for existing manifest */
+  for (i=0; i<mfst->ntrg; i++) if (!strcmp(mfst->trg[i].file,file))
+    return &(mfst->trg[i]);
+
+  /* Create new manifest */
+  if (mfst->ntrg==mfst->ntrgmax) {
+    mfst->ntrgmax=(mfst->ntrgmax) ? 2*mfst->ntrgmax : 16;
+    if (!(trg=(mfsttrg *)realloc(mfst->trg,
+				 (size_t)(mfst->ntrgmax*sizeof(mfsttrg))))) {
+      nferrormsg("UVES_mftarget(): Cannot allocate memory for\n\
+\tmanifest array of size %d",mfst->ntrgmax); return NULL;
+    }
+    mfst->trg=trg;
+  }
+  trg=&(mfst->trg[mfst->ntrg++]);
+  trg->nrec=trg->nrecmax=trg->last=0; trg->size=0; trg->fp=NULL;
+  trg->rec=NULL; strcpy(trg->file,file);
+
+  return trg;
+
+}
+
+/* Make sure manifest file is open for appending, closing the least
+   recently used manifest file if too many are open */
+static int UVES_mftrgopen(manifest *mfst, mfsttrg *trg) {
+
+  int      i=0,lru=-1;
+
+  if (trg->fp!=NULL) return 1;
+  if (mfst->nfd>=MFSTNFD) {
+    for (i=0; i<mfst->ntrg; i++)
+      if (mfst->trg[i].fp!=NULL &&
+	  (lru<0 || mfst->trg[i].last<mfst->trg[lru].last)) lru=i;
+    fclose(mfst->trg[lru].fp); mfst->trg[lru].fp=NULL; mfst->nfd--;
+  }
+  if (!trg->size) {
+    if ((trg->fp=faskwopen("Manifest file?",trg->file,4))==NULL) {
+      nferrormsg("UVES_mftrgopen(): Cannot open manifest file\n\t%s for writing",
+		 trg->file); return 0;
+    }
+    trg->size=fprintf(trg->fp,"%s %d\n",MFSTMAGIC,MFSTVERS);
+  }
+  else if ((trg->fp=faskwopen("Manifest file?",trg->file,6))==NULL) {
+    nferrormsg("UVES_mftrgopen(): Cannot open manifest file\n\
+\t%s for appending",trg->file); return 0;
+  }
+  mfst->nfd++;
+
+  return 1;
+
+}
+
+FILE *UVES_mfopen(manifest *mfst, char *query, char *filename) {
+
+  int      i=0;
+
+  /* No manifest: open file as normal */
+  if (mfst==NULL || mfst->mode==MFST_NONE)
+    return faskwopen(query,filename,4);
+
+  /* Find an unused record slot and open a memory stream on it */
+  while (i<MFSTNREC && mfst->rfp[i]!=NULL) i++;
+  if (i==MFSTNREC) {
+    nferrormsg("UVES_mfopen(): Too many records open at once.\n\
+\tIncrease MFSTNREC in UVES_headsort.h"); return NULL;
+  }
+  if (strlen(filename)>=NAMELEN) {
+    nferrormsg("UVES_mfopen(): File name too long:\n\t%s",filename);
+    return NULL;
+  }
+  mfst->rbuf[i]=NULL; mfst->rsize[i]=0;
+  if ((mfst->rfp[i]=open_memstream(&(mfst->rbuf[i]),&(mfst->rsize[i])))==NULL) {
+    nferrormsg("UVES_mfopen(): Cannot open memory stream for\n\tfile %s",
+	       filename); return NULL;
+  }
+  strcpy(mfst->rname[i],filename);
+
+  return mfst->rfp[i];
+
+}
+
+int UVES_mfclose(manifest *mfst, FILE *fp) {
+
+  long     size=0;
+  int      i=0,nhead=0;
+  char     *name=NULL;
+  mfsttrg  *trg=NULL;
+  mfstrec  *rec=NULL;
+
+  /* No manifest: close file as normal */
+  if (mfst==NULL || mfst->mode==MFST_NONE) {
+    if (mfst!=NULL && (size=ftell(fp))>=0) { mfst->nfile++; mfst->nbyte+=size; }
+    return (fclose(fp)) ? 0 : 1;
+  }
+
+  /* Find record slot corresponding to this stream */
+  while (i<MFSTNREC && mfst->rfp[i]!=fp) i++;
+  if (i==MFSTNREC) {
+    nferrormsg("UVES_mfclose(): Stream does not belong to manifest");
+    return 0;
+  }
+  fclose(fp); mfst->rfp[i]=NULL;
+
+  /* Find and open relevant manifest file */
+  if ((trg=UVES_mftarget(mfst,mfst->rname[i],&name))==NULL) {
+    free(mfst->rbuf[i]); mfst->rbuf[i]=NULL;
+    nferrormsg("UVES_mfclose(): Unknown error returned from UVES_mftarget()");
+    return 0;
+  }
+  if (!UVES_mftrgopen(mfst,trg)) {
+    free(mfst->rbuf[i]); mfst->rbuf[i]=NULL;
+    nferrormsg("UVES_mfclose(): Unknown error returned from UVES_mftrgopen()");
+    return 0;
+  }
+  trg->last=++(mfst->count);
+
+  /* Expand index if necessary */
+  if (trg->nrec==trg->nrecmax) {
+    trg->nrecmax=(trg->nrecmax) ? 2*trg->nrecmax : 16;
+    if (!(rec=(mfstrec *)realloc(trg->rec,
+				 (size_t)(trg->nrecmax*sizeof(mfstrec))))) {
+      free(mfst->rbuf[i]); mfst->rbuf[i]=NULL;
+      nferrormsg("UVES_mfclose(): Cannot allocate memory for index\n\
+\tof manifest %s",trg->file); return 0;
+    }
+    trg->rec=rec;
+  }
+
+  /* Append record to manifest and add it to the index */
+  rec=&(trg->rec[trg->nrec++]);
+  if ((nhead=fprintf(trg->fp,"#FILE %ld %s\n",(long)mfst->rsize[i],name))<0 ||
+      fwrite(mfst->rbuf[i],1,mfst->rsize[i],trg->fp)!=mfst->rsize[i]) {
+    free(mfst->rbuf[i]); mfst->rbuf[i]=NULL;
+    nferrormsg("UVES_mfclose(): Cannot write record %s\n\
+\tto manifest %s",name,trg->file); return 0;
+  }
+  rec->off=trg->size+nhead; rec->len=(long)mfst->rsize[i];
+  strcpy(rec->name,name);
+  trg->size=rec->off+rec->len;
+  mfst->nfile++; mfst->nbyte+=rec->len;
+  free(mfst->rbuf[i]); mfst->rbuf[i]=NULL;
+
+  return 1;
+
+}
+
+int UVES_mffinish(manifest *mfst) {
+
+  int      i=0,j=0;
+  mfsttrg  *trg=NULL;
+
+  if (mfst==NULL || mfst->mode==MFST_NONE) return 1;
+
+  /* Write index and trailer to each manifest */
+  for (i=0; i<mfst->ntrg; i++) {
+    trg=&(mfst->trg[i]);
+    if (!UVES_mftrgopen(mfst,trg)) {
+      nferrormsg("UVES_mffinish(): Unknown error returned from\n\
+\tUVES_mftrgopen()"); return 0;
+    }
+    fprintf(trg->fp,"#INDEX %d\n",trg->nrec);
+    for (j=0; j<trg->nrec; j++)
+      fprintf(trg->fp,"%ld %ld %s\n",trg->rec[j].off,trg->rec[j].len,
+	      trg->rec[j].name);
+    fprintf(trg->fp,"#TRAILER %020ld\n",trg->size);
+    if (fclose(trg->fp)) {
+      nferrormsg("UVES_mffinish(): Cannot write to manifest file\n\t%s",
+		 trg->file); return 0;
+    }
+    trg->fp=NULL; mfst->nfd--;
+    free(trg->rec); trg->rec=NULL;
+  }
+  free(mfst->trg); mfst->trg=NULL; mfst->ntrg=mfst->ntrgmax=0;
+
+  return 1;
+
+}
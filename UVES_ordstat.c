@@ -0,0 +1,71 @@
+/****************************************************************************
+* Calculate the number of lines, number of lines used in the polynomial
+* solution, and the RMS residual in each order of a ThAr line set in a
+* single pass over the lines. Lines are grouped by relative order number
+* or, if absord is set, by absolute order number, so they need not be
+* sorted or contiguous in order. The RMS is accumulated with Welford's
+* streaming update, using a running mean for each order.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+#include "UVES_wavres.h"
+#include "memory.h"
+#include "error.h"
+
+int UVES_ordstat(tharset *ts, int absord, char *infile) {
+
+  double   delta=0.0;
+  double   *mean=NULL;
+  int      nout=0,omax=0;
+  int      i=0,k=0;
+
+  /* Initialize accumulators */
+  if ((mean=darray(ts->no))==NULL) {
+    nferrormsg("UVES_ordstat(): Cannot allocate memory for mean array\n\
+\tof length %d",ts->no); return 0;
+  }
+  for (k=0; k<ts->no; k++) {
+    ts->o_n[k]=ts->o_np[k]=0; mean[k]=ts->o_rms[k]=0.0;
+  }
+
+  /* Accumulate lines into their orders */
+  for (i=0; i<ts->n; i++) {
+    if (absord) k=(ts->ora[i]-ts->o_ids)*ts->o_slp;
+    else { k=ts->orr[i]-1; if (ts->orr[i]>omax) omax=ts->orr[i]; }
+    if (k<0 || k>=ts->no) { nout++; continue; }
+    ts->o_n[k]++;
+    if (ts->stp[i]) {
+      /* o_rms holds the sum of squared deviations until the end */
+      ts->o_np[k]++; delta=ts->res[i]-mean[k];
+      mean[k]+=delta/(double)ts->o_np[k];
+      ts->o_rms[k]+=delta*(ts->res[i]-mean[k]);
+    }
+  }
+  free(mean);
+
+  /* Make sure number of orders represented in line set is less than
+     the number considered in the wavelength calibration process */
+  if (!absord && omax>ts->no)
+    warnmsg("Number of orders represented in file\n\t%s\n\
+\t(=%d) is larger than the number considered in the wavelength calibration\n\
+\tprocess (=%d). This indicates some inconsistency in this file.",infile,omax,
+	    ts->no);
+  else if (absord && nout)
+    warnmsg("%d lines in file\n\t%s\n\tlie outside the range of absolute\n\
+\torders considered in the wavelength calibration process (%d to %d).\n\
+\tThis indicates some inconsistency in this file.",nout,infile,ts->o_ids,
+	    ts->o_ide);
+
+  /* Finalize RMS for each order and the mean RMS per order */
+  for (k=0,ts->nop=0,ts->mrmso=0.0; k<ts->no; k++) {
+    ts->o_rms[k]=(ts->o_np[k]>1) ?
+      sqrt(ts->o_rms[k]/(double)(ts->o_np[k]-1)) : 0.0;
+    if (ts->o_n[k]) ts->nop++;
+    ts->mrmso+=ts->o_rms[k];
+  }
+  if (ts->nop) ts->mrmso/=(double)ts->nop;
+
+  return 1;
+
+}
@@ -0,0 +1,176 @@
+/****************************************************************************
+
+UVES_relink: Retarget the symbolic links made by UVES_headsort in object
+directories, e.g. after moving the raw data archive to a new root. This
+is a native, parallel replacement for uves_changelinks.csh.
+
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "UVES_headsort.h"
+#include "UVES_relink.h"
+#include "file.h"
+#include "thpool.h"
+#include "error.h"
+
+/* Global declarations */
+char      *progname;
+
+/****************************************************************************
+* Print the usage message
+****************************************************************************/
+
+void usage(void) {
+
+  fprintf(stderr,"\n%s: Retarget symbolic links to FITS files in object\n\
+\tdirectories written by UVES_headsort\n",progname);
+
+  fprintf(stderr,"\nBy Michael Murphy (http://astronomy.swin.edu.au/~mmurphy)\n\
+\nVersion: %4.2lf (19 Feb 2018)\n",VERSION);
+
+  fprintf(stderr,"\nUsage: %s [OPTIONS] [Directories]\n",progname);
+
+  fprintf(stderr, "\nOptions:\n\
+  -h, -help        : Print this message.\n\
+  -root DIR        : Point links into the absolute directory DIR, keeping\n\
+                         only the file name and the last -keep directory\n\
+                         segments of each old target.\n\
+  -keep = %1d        : Number of directory segments of old targets to keep.\n\
+  -from OLD -to NEW: Instead, replace the path prefix OLD of each old target\n\
+                         with NEW. Links not under OLD are left alone.\n\
+  -nthreads N      : Number of directories to process concurrently (default:\n\
+                         number of processors).\n\
+  -dry             : Only list the links which would be changed, with their\n\
+                         old and new targets.\n\
+  -norec           : Do not process the directories below each directory.\n\
+\nEach directory (default: the current one) and, unless -norec is given, all\n\
+directories below it are processed. Links named thargood.fits, atmoexan.fits and flxstd.fits are\n\
+pointed at the files given by the UVES_HEADSORT_THARFILE,\n\
+UVES_HEADSORT_ATMOFILE and UVES_HEADSORT_FLSTFILE environment variables.\n\n",
+	  RLKEEP);
+  exit(3);
+}
+
+/****************************************************************************
+* Job for the worker thread pool: process directory k
+****************************************************************************/
+
+void UVES_rlwork(void *arg, int k) {
+
+  rlpool   *pool=(rlpool *)arg;
+
+  UVES_rldir(&(pool->job[k]),pool->rule,pool->dry);
+
+}
+
+/****************************************************************************
+* The main program
+
+  Things to do:
+
+****************************************************************************/
+
+int main(int argc, char *argv[]) {
+
+  int      nthread=0,njobmax=0,ndir=0,nlink=0,nchg=0,nfail=0,recurse=1;
+  int      i=0,k=0;
+  char     *cptr=NULL;
+  char     **dir=NULL;
+  rlrule   rule;
+  rlpool   pool;
+
+  /* Define the program name from the command line input */
+  progname=((progname=strrchr(argv[0],'/'))==NULL) ? argv[0] : progname+1;
+  /* Must be at least one argument */
+  if (argc==1) usage();
+  /* Allocate memory for list of directories */
+  if ((dir=(char **)malloc((size_t)argc*sizeof(char *)))==NULL)
+    errormsg("Cannot allocate memory for list of directories");
+  /* Initialize rule and pool */
+  rule.root[0]=rule.from[0]=rule.to[0]='\0'; rule.keep=-1; rule.prefix=0;
+  pool.job=NULL; pool.njob=pool.dry=0; pool.rule=&rule;
+  /* Scan command line for options */
+  while (++i<argc) {
+    if (!strcmp(argv[i],"-root") || !strcmp(argv[i],"-from") ||
+	!strcmp(argv[i],"-to")) {
+      if (i+1>=argc || strlen(argv[i+1])>=VLNGSTRLEN) usage();
+      cptr=(argv[i][1]=='r') ? rule.root : ((argv[i][1]=='f') ? rule.from :
+					     rule.to);
+      strcpy(cptr,argv[++i]);
+    }
+    else if (!strcmp(argv[i],"-keep")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&(rule.keep))!=1 || rule.keep<0)
+	usage();
+    }
+    else if (!strcmp(argv[i],"-nthreads")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&nthread)!=1 || nthread<1) usage();
+    }
+    else if (!strcmp(argv[i],"-dry")) pool.dry=1;
+    else if (!strcmp(argv[i],"-norec")) recurse=0;
+    else if (!strcmp(argv[i],"-help") || !strcmp(argv[i],"-h")) usage();
+    else if (!isdir(argv[i])) errormsg("Argument %s is not a directory",argv[i]);
+    else if (strlen(argv[i])>=VLNGSTRLEN)
+      errormsg("Directory name too long: %s",argv[i]);
+    else {
+      dir[ndir++]=argv[i];
+    }
+  }
+  /* Make sure exactly one rule was specified */
+  rule.prefix=(strncmp(rule.from,"\0",1) || strncmp(rule.to,"\0",1));
+  if (rule.prefix) {
+    if (!strncmp(rule.from,"\0",1) || !strncmp(rule.to,"\0",1) ||
+	strncmp(rule.root,"\0",1) || rule.keep>=0) usage();
+  } else {
+    if (!strncmp(rule.root,"\0",1)) usage();
+    if (rule.root[0]!='/')
+      errormsg("You must use an absolute path for the new root directory");
+    if (!isdir(rule.root)) errormsg("New root %s is not a directory",rule.root);
+    /* Remove trailing slashes */
+    for (k=strlen(rule.root)-1; k>0 && rule.root[k]=='/'; k--) rule.root[k]='\0';
+    if (rule.keep<0) rule.keep=RLKEEP;
+  }
+  /* List the directories to process, the current one by default */
+  if (!ndir) dir[ndir++]=".";
+  for (k=0; k<ndir; k++)
+    if (!UVES_rlwalk(dir[k],recurse,&(pool.job),&(pool.njob),&njobmax))
+      errormsg("Unknown error returned from UVES_rlwalk()");
+  free(dir);
+  /* Set reference file path names */
+  rule.spec[0]="thargood.fits"; rule.spec[1]="atmoexan.fits";
+  rule.spec[2]="flxstd.fits";
+  rule.stgt[0]=((cptr=getenv("UVES_HEADSORT_THARFILE"))==NULL) ? THARFILE : cptr;
+  rule.stgt[1]=((cptr=getenv("UVES_HEADSORT_ATMOFILE"))==NULL) ? ATMOFILE : cptr;
+  rule.stgt[2]=((cptr=getenv("UVES_HEADSORT_FLSTFILE"))==NULL) ? FLSTFILE : cptr;
+  for (k=0; k<NRLSPEC; k++) rule.sok[k]=!access(rule.stgt[k],R_OK);
+
+  /* Decide how many worker threads to use */
+  nthread=thnum(nthread,pool.njob);
+
+  /* Process all directories */
+  if (!thpool_run(nthread,pool.njob,UVES_rlwork,&pool))
+    errormsg("Unknown error returned from thpool_run()");
+
+  /* Write dry-run output in directory order */
+  for (k=0; k<pool.njob; k++) {
+    if (pool.job[k].ok) {
+      if (pool.dry) fwrite(pool.job[k].buf,1,pool.job[k].size,stdout);
+      nlink+=pool.job[k].nlink; nchg+=pool.job[k].nchg;
+    }
+    else nfail++;
+    if (pool.job[k].buf!=NULL) free(pool.job[k].buf);
+  }
+  fflush(stdout);
+
+  /* Clean up */
+  free(pool.job);
+
+  if (nfail) errormsg("Failed to relink files in %d of %d directories",nfail,
+		      pool.njob);
+  if (!nlink) warnmsg("No symbolic links to FITS files found");
+  else if (!nchg) warnmsg("No links needed to be changed");
+
+  return 1;
+
+}
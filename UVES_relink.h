@@ -0,0 +1,47 @@
+/***************************************************************************
+* Definitions, structures and function prototypes for UVES_RELINK
+***************************************************************************/
+
+/* INCLUDE FILES */
+#include <stdio.h>
+#include "charstr.h"
+
+/* DEFINITIONS */
+#define RLKEEP 0        /* Default number of directory segments kept        */
+#define NRLDIR 64       /* Initial size of growable list of directories     */
+#define NRLLINK 64      /* Initial size of growable list of links in a dir  */
+#define NRLSPEC 3       /* Number of specially-treated calibration links    */
+
+/* STRUCTURES */
+typedef struct ReLinkRule {
+  char   root[VLNGSTRLEN]; /* New archive root (keep-last-N rule) */
+  char   from[VLNGSTRLEN]; /* Old target prefix (prefix-rewrite rule) */
+  char   to[VLNGSTRLEN];   /* New target prefix (prefix-rewrite rule) */
+  int    keep;          /* Number of directory segments kept (keep rule) */
+  int    prefix;        /* Use prefix-rewrite rule instead of keep rule? */
+  char   *spec[NRLSPEC];   /* Link names which are treated specially */
+  char   *stgt[NRLSPEC];   /* New targets of specially-treated links */
+  int    sok[NRLSPEC];  /* Are new targets of special links readable? */
+} rlrule;
+
+typedef struct ReLinkJob {
+  char   dir[VLNGSTRLEN]; /* Directory to process */
+  char   *buf;          /* Text output (dry run) for this directory */
+  size_t size;          /* Length of text output */
+  int    nlink;         /* Number of links to FITS files found */
+  int    nchg;          /* Number of links (to be) retargeted */
+  int    ok;            /* Was directory processed successfully? */
+} rljob;
+
+typedef struct ReLinkPool {
+  rljob  *job;          /* Array of jobs, one per directory */
+  int    njob;          /* Number of jobs */
+  int    dry;           /* Dry run: only report what would be done */
+  rlrule *rule;         /* Retargeting rule */
+} rlpool;
+
+/* FUNCTION PROTOTYPES */
+int UVES_rldir(rljob *job, rlrule *rule, int dry);
+int UVES_rlwalk(char *dir, int recurse, rljob **job, int *njob,
+		int *njobmax);
+void UVES_rlwork(void *arg, int k);
@@ -12,25 +12,30 @@ int UVES_rfitshead(char *infile, header *hdr) {
 
   double   cwl=0.0;
   int      hdutype=0,hdunum=0,status=0;
+  LONGLONG headstart=0,datastart=0,dataend=0;
   char     comment[FLEN_COMMENT]="\0";
   char     *cptr=NULL;
   fitsfile *infits;
 
   /* Open input file as FITS file */
-  if (fits_open_file(&infits,infile,READONLY,&status))
-      errormsg("UVES_rfitshead(): Cannot open FITS file %s",infile);
+  hdr->nbyte=0; hdr->nhdu=1;
+  if (fits_open_file(&infits,infile,READONLY,&status)) {
+    nferrormsg("UVES_rfitshead(): Cannot open FITS file %s",infile); return 0;
+  }
 
   /* Check HDU type */
   fits_get_hdu_type(infits,&hdutype,&status);
   if (hdutype!=IMAGE_HDU) {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): File not a FITS image: %s",infile);
+    nferrormsg("UVES_rfitshead(): File not a FITS image: %s",infile); return 0;
   }
 
   /* Check number of HDUs */
-  if (fits_get_num_hdus(infits,&hdunum,&status))
-    errormsg("UVES_rfitshead(): Cannot find number of HDUs in file\n\
-\t%s",infile);
+  if (fits_get_num_hdus(infits,&hdunum,&status)) {
+    status=0; fits_close_file(infits,&status);
+    nferrormsg("UVES_rfitshead(): Cannot find number of HDUs in file\n\
+\t%s",infile); return 0;
+  }
 
   /* Check type of exposure */
   if (fits_read_key(infits,TSTRING,"HIERARCH ESO DPR TYPE",hdr->obj,
@@ -51,40 +56,40 @@ int UVES_rfitshead(char *infile, header *hdr) {
   if (fits_read_key(infits,TSTRING,"HIERARCH ESO DPR CATG",hdr->typ,
 		    comment,&status)) {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO DPR CATG",infile);
+    nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO DPR CATG",infile); return 0;
   }
 
   if (fits_read_key(infits,TSTRING,"ARCFILE",hdr->dat,comment,&status)) {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","ARCFILE",infile);
+    nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","ARCFILE",infile); return 0;
   }
 
   if (fits_read_key(infits,TDOUBLE,"EXPTIME",&(hdr->et),comment,&status)) {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","EXPTIME",infile);
+    nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","EXPTIME",infile); return 0;
   }
 
   if (fits_read_key(infits,TDOUBLE,"MJD-OBS",&(hdr->mjd),comment,&status)) {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","MJD-OBS",infile);
+    nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","MJD-OBS",infile); return 0;
   }
 
   if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO DET EXP RDTTIME",&(hdr->rt),comment,
 		    &status)) {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO DET EXP RDTTIME",infile);
+    nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO DET EXP RDTTIME",infile); return 0;
   }
 
   if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO DET EXP XFERTIM",&(hdr->tt),comment,
 		    &status)) {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO DET EXP XFERTIM",infile);
+    nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO DET EXP XFERTIM",infile); return 0;
   }
 
   /* Define time of end of exposure+read-out/transfer */
@@ -93,15 +98,15 @@ int UVES_rfitshead(char *infile, header *hdr) {
   if (fits_read_key(infits,TINT,"HIERARCH ESO DET WIN1 BINX",&(hdr->biny),
 		    comment,&status)) {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO DET WIN1 BINX",infile);
+    nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO DET WIN1 BINX",infile); return 0;
   }
 
   if (fits_read_key(infits,TINT,"HIERARCH ESO DET WIN1 BINY",&(hdr->binx),
 		    comment,&status)) {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO DET WIN1 BINY",infile);
+    nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO DET WIN1 BINY",infile); return 0;
   }
 
   if (strstr(hdr->obj,"OBJECT")!=NULL || strstr(hdr->obj,"SLIT")!=NULL ||
@@ -109,8 +114,8 @@ int UVES_rfitshead(char *infile, header *hdr) {
     if (fits_read_key(infits,TSTRING,"HIERARCH ESO OBS TARG NAME",hdr->obj,
 		      comment,&status)) {
       status=0; fits_close_file(infits,&status);
-      errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO OBS TARG NAME",infile);
+      nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO OBS TARG NAME",infile); return 0;
     }
     if (!strcmp(hdr->typ,"SCIENCE")) strcpy(hdr->typ,"sci\0");
     else if (!strcmp(hdr->typ,"CALIB") || !strcmp(hdr->typ,"STD"))
@@ -119,8 +124,8 @@ int UVES_rfitshead(char *infile, header *hdr) {
     else if (!strcmp(hdr->typ,"ACQUISITION")) strcpy(hdr->typ,"aqu\0");
     else {
       status=0; fits_close_file(infits,&status);
-      errormsg("UVES_rfitshead(): Do not understand header card %s in file\n\t%s",
-	       "HIERARCH ESO DPR CATG",infile);
+      nferrormsg("UVES_rfitshead(): Do not understand header card %s in file\n\t%s",
+		 "HIERARCH ESO DPR CATG",infile); return 0;
     }
     /* Alter object name to remove some special characters */
     while ((cptr=strchr(hdr->obj,'+'))!=NULL) *cptr='p';
@@ -146,15 +151,15 @@ int UVES_rfitshead(char *infile, header *hdr) {
     else if (strstr(hdr->obj,"FMT")!=NULL) strcpy(hdr->typ,"fmt\0");
     else {
       status=0; fits_close_file(infits,&status);
-      errormsg("UVES_rfitshead(): Do not understand LAMP-type\n\
-\theader card %s in file\n\t%s","HIERARCH ESO DPR TYPE",infile);
+      nferrormsg("UVES_rfitshead(): Do not understand LAMP-type\n\
+\theader card %s in file\n\t%s","HIERARCH ESO DPR TYPE",infile); return 0;
     }
     strcpy(hdr->obj,"thar\0");
   }
   else {
     status=0; fits_close_file(infits,&status);
-    errormsg("UVES_rfitshead(): Do not understand header card %s in file\n\t%s",
-	     "HIERARCH ESO DPR TYPE",infile);
+    nferrormsg("UVES_rfitshead(): Do not understand header card %s in file\n\t%s",
+	       "HIERARCH ESO DPR TYPE",infile); return 0;
   }
 
   if (!strcmp(hdr->obj,"bias")) {
@@ -170,8 +175,9 @@ int UVES_rfitshead(char *infile, header *hdr) {
       status=0;
       if (fits_read_key(infits,TSTRING,"ORIGFILE",hdr->cwl,comment,&status)) {
 	status=0; fits_close_file(infits,&status);
-	errormsg("UVES_rfitshead(): Cannot read value of header cards\n\
+	nferrormsg("UVES_rfitshead(): Cannot read value of header cards\n\
 \t%s or %s from FITS file\n\t%s.","HIERARCH ESO DET CHIP1 NAME","ORIGFILE",infile);
+	return 0;
       }
       if (strstr(hdr->cwl,"RED")!=NULL || strstr(hdr->cwl,"red")!=NULL ||
 	  strstr(hdr->cwl,"Red")!=NULL) {
@@ -182,25 +188,37 @@ int UVES_rfitshead(char *infile, header *hdr) {
       } else {
 	/* If nothing is in the first HDU, move to the next HDU if it exists */
 	if (hdunum>1) {
-	  /* Move to next HDU */
-	  if (fits_movrel_hdu(infits,1,&hdutype,&status))
-	    errormsg("UVES_rfitshead(): Could not move to second HDU\n\
-\tin file\n\t%s",infile);
+	  /* Move to next HDU, counting the size of the primary header */
+	  if (!fits_get_hduaddrll(infits,&headstart,&datastart,&dataend,&status))
+	    hdr->nbyte+=(long)(datastart-headstart);
+	  status=0;
+	  if (fits_movrel_hdu(infits,1,&hdutype,&status)) {
+	    status=0; fits_close_file(infits,&status);
+	    nferrormsg("UVES_rfitshead(): Could not move to second HDU\n\
+\tin file\n\t%s",infile); return 0;
+	  }
+	  hdr->nhdu++;
 	  /* Check HDU type */
-	  if (hdutype!=IMAGE_HDU)
-	    errormsg("UVES_rfitshead(): Second extension %d not a FITS image\n\
-\tin file\n\t%s",infile);
+	  if (hdutype!=IMAGE_HDU) {
+	    status=0; fits_close_file(infits,&status);
+	    nferrormsg("UVES_rfitshead(): Second extension not a FITS image\n\
+\tin file\n\t%s",infile); return 0;
+	  }
 	  if (fits_read_key(infits,TSTRING,"HIERARCH ESO DET CHIP1 NAME",hdr->cwl,
-			    comment,&status))
-	    errormsg("UVES_rfitshead(): Cannot read value of header cards\n\
-\t%s from FITS file\n\t%s.","HIERARCH ESO DET CHIP1 NAME",infile);
+			    comment,&status)) {
+	    status=0; fits_close_file(infits,&status);
+	    nferrormsg("UVES_rfitshead(): Cannot read value of header cards\n\
+\t%s from FITS file\n\t%s.","HIERARCH ESO DET CHIP1 NAME",infile); return 0;
+	  }
 	  if (strstr(hdr->cwl,"MIT")!=NULL) strcpy(hdr->cwl,"red\0");
 	  else strcpy(hdr->cwl,"blue\0");
-	} else
-	  errormsg("UVES_rfitshead(): Cannot read value of header cards\n\
+	} else {
+	  status=0; fits_close_file(infits,&status);
+	  nferrormsg("UVES_rfitshead(): Cannot read value of header cards\n\
 \t%s or %s from FITS file\n\t%s\n\tand there is only one HDU present.\n\
 \tI therefore cannot determine whether exposure is in blue or red arm",
-		   "HIERARCH ESO DET CHIP1 NAME","ORIGFILE",infile);
+		   "HIERARCH ESO DET CHIP1 NAME","ORIGFILE",infile); return 0;
+	}
       }
     } else {
       if (strstr(hdr->cwl,"MIT")!=NULL) { strcpy(hdr->cwl,"red\0"); hdr->arm=1; }
@@ -213,36 +231,36 @@ int UVES_rfitshead(char *infile, header *hdr) {
     if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO INS TEMP1 MEAN",&(hdr->tb),
 		      comment,&status)) {
       status=0; fits_close_file(infits,&status);
-      errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS TEMP1 MEAN",infile);
+      nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS TEMP1 MEAN",infile); return 0;
     }
     if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO INS TEMP2 MEAN",&(hdr->tr),
 		      comment,&status)) {
       status=0; fits_close_file(infits,&status);
-      errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS TEMP2 MEAN",infile);
+      nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS TEMP2 MEAN",infile); return 0;
     }
     if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO INS SENS26 MEAN",&(hdr->p),
 		      comment,&status)) {
       status=0; fits_close_file(infits,&status);
-      errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS SENS26 MEAN",infile);
+      nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS SENS26 MEAN",infile); return 0;
     }
 
     /* Decide which arm we're using */
     if (fits_read_key(infits,TSTRING,"HIERARCH ESO INS PATH",hdr->cwl,
 		      comment,&status)) {
       status=0; fits_close_file(infits,&status);
-      errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS PATH",infile);
+      nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS PATH",infile); return 0;
     }
     if (strstr(hdr->cwl,"RED")!=NULL || strstr(hdr->cwl,"red")!=NULL) {
       hdr->arm=1;
       if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO INS GRAT2 WLEN",&cwl,
 			comment,&status)) {
 	status=0; fits_close_file(infits,&status);
-	errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS GRAT2 WLEN",infile);      
+	nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS GRAT2 WLEN",infile); return 0;      
       }
     }
     else {
@@ -250,8 +268,8 @@ int UVES_rfitshead(char *infile, header *hdr) {
       if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO INS GRAT1 WLEN",&cwl,
 			comment,&status)) {
 	status=0; fits_close_file(infits,&status);
-	errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS GRAT1 WLEN",infile);      
+	nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS GRAT1 WLEN",infile); return 0;      
       }
     }
     /* To cope with pathalogical cases where very very red settings in
@@ -268,28 +286,28 @@ int UVES_rfitshead(char *infile, header *hdr) {
       if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO INS SLIT2 WID",&(hdr->sw),
 			comment,&status)) {
 	status=0; fits_close_file(infits,&status);
-	errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS SLIT2 WID",infile);
+	nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS SLIT2 WID",infile); return 0;
       }
       if (fits_read_key(infits,TINT,"HIERARCH ESO INS GRAT1 ENC",&(hdr->enc),
 			comment,&status)) {
 	status=0; fits_close_file(infits,&status);
-	errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS GRAT1 ENC",infile);
+	nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS GRAT1 ENC",infile); return 0;
       }
     }
     else {
       if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO INS SLIT3 WID",&(hdr->sw),
 			comment,&status)) {
 	status=0; fits_close_file(infits,&status);
-	errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS SLIT3 WID",infile);
+	nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS SLIT3 WID",infile); return 0;
       }
       if (fits_read_key(infits,TINT,"HIERARCH ESO INS GRAT2 ENC",&(hdr->enc),
 			comment,&status)) {
 	status=0; fits_close_file(infits,&status);
-	errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS GRAT2 ENC",infile);
+	nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS GRAT2 ENC",infile); return 0;
       }
     }
   }
@@ -300,21 +318,23 @@ int UVES_rfitshead(char *infile, header *hdr) {
     if (fits_read_key(infits,TSTRING,"HIERARCH ESO INS MODE",hdr->mod,
 		      comment,&status)) {
       status=0; fits_close_file(infits,&status);
-      errormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
-\tfrom FITS file %s.","HIERARCH ESO INS MODE",infile);
+      nferrormsg("UVES_rfitshead(): Cannot read value of header card %s\n\
+\tfrom FITS file %s.","HIERARCH ESO INS MODE",infile); return 0;
     }
     if (strstr(hdr->mod,"DIC")!=NULL) strcpy(hdr->mod,"dic\0");
     else if (strstr(hdr->mod,"BLUE")!=NULL) strcpy(hdr->mod,"blue\0");
     else if (strstr(hdr->mod,"RED")!=NULL) strcpy(hdr->mod,"red\0");
     else {
       status=0; fits_close_file(infits,&status);
-      errormsg("UVES_rfitshead(): Do not understand header card %s in file\n\t%s",
-	       "HIERARCH ESO INS MODE",infile);
+      nferrormsg("UVES_rfitshead(): Do not understand header card %s in file\n\t%s",
+		 "HIERARCH ESO INS MODE",infile); return 0;
     }
   }
 
-  /* Close input FITS file */
-  fits_close_file(infits,&status);
+  /* Count the size of the (last) header read and close input FITS file */
+  if (!fits_get_hduaddrll(infits,&headstart,&datastart,&dataend,&status))
+    hdr->nbyte+=(long)(datastart-headstart);
+  status=0; fits_close_file(infits,&status);
   
   return 1;
 }
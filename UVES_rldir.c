@@ -0,0 +1,141 @@
+/****************************************************************************
+* Retarget the symbolic links to FITS files in a single directory. The
+* names of the links are gathered first, so that replacing them does not
+* disturb the directory scan. Each link target is read with readlinkat()
+* and rewritten either by replacing an old path prefix with a new one or
+* by keeping its last few segments below a new archive root. Links to
+* the ThAr line list, atmospheric extinction table and flux standard
+* table are instead pointed at the files given by the UVES_HEADSORT_*
+* environment variables. Each link is replaced atomically by creating
+* the new link under a temporary name and renaming it over the old one.
+* In a dry run, the links which would change are only listed.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "UVES_relink.h"
+#include "error.h"
+
+#define RLCLOSE closedir(dp); fclose(out); free(name);
+
+/* Work out the new target of a link. Returns 1 if the link should be
+   retargeted, 0 if it should be left alone and -1 on error */
+static int UVES_rltarg(char *lname, char *old, rlrule *rule, char *new) {
+
+  size_t   len=0;
+  int      nseg=0;
+  int      i=0;
+  char     *cptr=NULL;
+
+  /* Specially treated calibration links */
+  for (i=0; i<NRLSPEC; i++) if (!strcmp(lname,rule->spec[i])) {
+      if (!rule->sok[i]) {
+	nferrormsg("UVES_rldir(): Cannot read file %s",rule->stgt[i]);
+	return -1;
+      }
+      if (strlen(rule->stgt[i])>=VVLNGSTRLEN) return -1;
+      strcpy(new,rule->stgt[i]); return 1;
+    }
+
+  if (rule->prefix) {
+    /* Replace old prefix, matching whole path segments only */
+    len=strlen(rule->from);
+    if (strncmp(old,rule->from,len) || (old[len]!='/' && old[len]!='\0' &&
+					 rule->from[len-1]!='/')) return 0;
+    if (strlen(rule->to)+strlen(old+len)>=VVLNGSTRLEN) return -1;
+    strcpy(new,rule->to); strcat(new,old+len);
+  } else {
+    /* Keep file name and last rule->keep directory segments */
+    for (cptr=old+strlen(old); cptr>old; cptr--)
+      if (*(cptr-1)=='/' && ++nseg>rule->keep) break;
+    while (*cptr=='/') cptr++;
+    if (strlen(rule->root)+strlen(cptr)+1>=VVLNGSTRLEN) return -1;
+    strcpy(new,rule->root); strcat(new,"/"); strcat(new,cptr);
+  }
+
+  return 1;
+
+}
+
+int UVES_rldir(rljob *job, rlrule *rule, int dry) {
+
+  ssize_t  len=0;
+  int      nname=0,nnamemax=0,dfd=-1,islnk=0,res=0;
+  int      i=0;
+  char     old[VVLNGSTRLEN]="\0",new[VVLNGSTRLEN]="\0";
+  char     tmp[VLNGSTRLEN]="\0";
+  char     (*name)[NAMELEN]=NULL,(*tmpname)[NAMELEN]=NULL;
+  DIR      *dp=NULL;
+  FILE     *out=NULL;
+  struct   dirent *ent=NULL;
+  struct   stat st;
+
+  job->ok=0; job->buf=NULL; job->size=job->nlink=job->nchg=0;
+  if ((out=open_memstream(&(job->buf),&(job->size)))==NULL) {
+    nferrormsg("UVES_rldir(): Cannot open output stream for directory\n\
+\t%s",job->dir); return 0;
+  }
+  if ((dp=opendir(job->dir))==NULL) {
+    fclose(out); nferrormsg("UVES_rldir(): Cannot open directory %s",job->dir);
+    return 0;
+  }
+  dfd=dirfd(dp);
+
+  /* Gather names of symbolic links to FITS files */
+  while ((ent=readdir(dp))!=NULL) {
+    len=(ssize_t)strlen(ent->d_name);
+    if (len<6 || strcmp(ent->d_name+len-5,".fits")) continue;
+    if (ent->d_type==DT_UNKNOWN)
+      islnk=(!fstatat(dfd,ent->d_name,&st,AT_SYMLINK_NOFOLLOW) &&
+	     S_ISLNK(st.st_mode));
+    else islnk=(ent->d_type==DT_LNK);
+    if (!islnk) continue;
+    if (len>=NAMELEN) {
+      RLCLOSE; nferrormsg("UVES_rldir(): Link name too long:\n\t%s/%s",
+			  job->dir,ent->d_name); return 0;
+    }
+    if (nname==nnamemax) {
+      nnamemax=(nnamemax) ? 2*nnamemax : NRLLINK;
+      if ((tmpname=(char (*)[NAMELEN])realloc(name,(size_t)nnamemax*NAMELEN))
+	  ==NULL) {
+	RLCLOSE; nferrormsg("UVES_rldir(): Cannot allocate memory for list\n\
+\tof %d links in directory %s",nnamemax,job->dir); return 0;
+      }
+      name=tmpname;
+    }
+    strcpy(name[nname++],ent->d_name);
+  }
+  job->nlink=nname;
+
+  /* Retarget each link */
+  for (i=0; i<nname; i++) {
+    if ((len=readlinkat(dfd,name[i],old,VVLNGSTRLEN))<0 || len>=VVLNGSTRLEN) {
+      RLCLOSE; nferrormsg("UVES_rldir(): Cannot read link %s/%s",job->dir,
+			  name[i]); return 0;
+    }
+    old[len]='\0';
+    if ((res=UVES_rltarg(name[i],old,rule,new))<0) {
+      RLCLOSE; nferrormsg("UVES_rldir(): Cannot find new target for link\n\
+\t%s/%s\n\tto %s",job->dir,name[i],old); return 0;
+    }
+    if (!res || !strcmp(old,new)) continue;
+    job->nchg++;
+    if (dry) { fprintf(out,"%s/%s %s %s\n",job->dir,name[i],old,new); continue; }
+    sprintf(tmp,".%s.relink",name[i]);
+    unlinkat(dfd,tmp,0);
+    if (symlinkat(new,dfd,tmp) || renameat(dfd,tmp,dfd,name[i])) {
+      unlinkat(dfd,tmp,0); RLCLOSE;
+      nferrormsg("UVES_rldir(): Cannot replace symlink %s/%s\n\tto file %s",
+		 job->dir,name[i],new); return 0;
+    }
+  }
+  RLCLOSE;
+  job->ok=1;
+
+  return 1;
+
+}
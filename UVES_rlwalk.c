@@ -0,0 +1,63 @@
+/****************************************************************************
+* Add a directory, and recursively all the directories below it unless
+* recurse is zero, to a growable list of UVES_relink jobs. Symbolic
+* links to directories are not followed.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "UVES_relink.h"
+#include "error.h"
+
+int UVES_rlwalk(char *dir, int recurse, rljob **job, int *njob,
+		int *njobmax) {
+
+  int      isd=0;
+  char     sub[VLNGSTRLEN]="\0";
+  DIR      *dp=NULL;
+  struct   dirent *ent=NULL;
+  struct   stat st;
+  rljob    *tmpjob=NULL;
+
+  /* Add this directory to the list */
+  if (*njob==*njobmax) {
+    *njobmax=(*njobmax) ? 2*(*njobmax) : NRLDIR;
+    if ((tmpjob=(rljob *)realloc(*job,(size_t)(*njobmax)*sizeof(rljob)))==NULL) {
+      nferrormsg("UVES_rlwalk(): Cannot allocate memory for directory\n\
+\tlist of size %d",*njobmax); return 0;
+    }
+    *job=tmpjob;
+  }
+  strcpy((*job)[*njob].dir,dir); (*job)[(*njob)++].buf=NULL;
+  if (!recurse) return 1;
+
+  /* Descend into its subdirectories */
+  if ((dp=opendir(dir))==NULL) {
+    nferrormsg("UVES_rlwalk(): Cannot open directory %s",dir); return 0;
+  }
+  while ((ent=readdir(dp))!=NULL) {
+    if (!strcmp(ent->d_name,".") || !strcmp(ent->d_name,"..")) continue;
+    if (ent->d_type==DT_UNKNOWN)
+      isd=(!fstatat(dirfd(dp),ent->d_name,&st,AT_SYMLINK_NOFOLLOW) &&
+	   S_ISDIR(st.st_mode));
+    else isd=(ent->d_type==DT_DIR);
+    if (!isd) continue;
+    if (strlen(dir)+strlen(ent->d_name)+2>VLNGSTRLEN) {
+      closedir(dp); nferrormsg("UVES_rlwalk(): Directory name too long:\n\
+\t%s/%s",dir,ent->d_name); return 0;
+    }
+    strcpy(sub,dir); strcat(sub,"/"); strcat(sub,ent->d_name);
+    if (!UVES_rlwalk(sub,1,job,njob,njobmax)) {
+      closedir(dp);
+      nferrormsg("UVES_rlwalk(): Unknown error returned from UVES_rlwalk()");
+      return 0;
+    }
+  }
+  closedir(dp);
+
+  return 1;
+
+}
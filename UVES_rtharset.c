@@ -0,0 +1,281 @@
+/****************************************************************************
+* Read in the ThAr line set and relevant header information from a
+* FITS file containing the results of the CPL uves_cal_wavecal command
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "UVES_wavres.h"
+#include "error.h"
+
+/* Columns read from the binary table, in the order of tharset arrays */
+static char *UVES_thcolname[NTHCOL]={"X","Peak","Background","Slope","Xwidth",
+				     "Pixel","Ident","WaveC","AbsOrder","Y",
+				     "Select","NLinSol"};
+static int  UVES_thcoltype[NTHCOL]={TDOUBLE,TDOUBLE,TDOUBLE,TDOUBLE,TDOUBLE,
+				    TDOUBLE,TDOUBLE,TDOUBLE,TINT,TINT,TINT,TINT};
+
+/* Extract the value of a header card as a string, removing quotes and
+   surrounding blanks */
+static int UVES_rthval(char *card, char *value) {
+
+  int      status=0;
+  char     comment[FLEN_COMMENT]="\0";
+  char     *cptr=NULL;
+
+  if (fits_parse_value(card,value,comment,&status)) return 0;
+  cptr=value; if (*cptr=='\'') cptr++;
+  while (*cptr==' ') cptr++;
+  memmove(value,cptr,strlen(cptr)+1);
+  cptr=value+strlen(value);
+  while (cptr>value && (*(cptr-1)=='\'' || *(cptr-1)==' ')) cptr--;
+  *cptr='\0';
+
+  return 1;
+
+}
+
+int UVES_rtharset(char *infile, tharset *ts) {
+
+  double   nulval=0.0;
+  long     nrows=0,nchunk=0,first=0,nread=0;
+  int      hdunum=0,hdutype=0,status=0,naxis=0,nkeys=0,nmore=0,anynul=0;
+  int      ptol=0,pdeg=0,gotfo=0,gotlo=0;
+  int      col[NTHCOL];
+  int      i=0,j=0;
+  char     key[FLEN_KEYWORD]="\0",word[FLEN_KEYWORD]="\0";
+  char     card[FLEN_CARD]="\0",comment[FLEN_COMMENT]="\0";
+  char     value[FLEN_VALUE]="\0";
+  void     *data[NTHCOL];
+  fitsfile *infits;
+
+  /* Initialize arrays so that they can always be freed */
+  ts->blk=NULL;
+  ts->x=ts->h=ts->c=ts->s=ts->w=ts->dis=ts->wlf=ts->wlc=ts->res=NULL;
+  ts->o_rms=NULL;
+  ts->ora=ts->orr=ts->sts=ts->stp=ts->o_id=ts->o_n=ts->o_np=NULL;
+
+  /* Open input file as FITS file */
+  if (fits_open_file(&infits,infile,READONLY,&status)) {
+    nferrormsg("UVES_rtharset(): Cannot open input FITS file %s",infile);
+    return 0;
+  }
+  /* Check number of HDUs */
+  if (fits_get_num_hdus(infits,&hdunum,&status)) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot find number of HDUs in file\n\
+\t%s",infile); return 0;
+  }
+  if (hdunum!=10) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Number of HDUs is %d instead of %d\n\
+\tin file\n\t%s",hdunum,10,infile); return 0;
+  }
+  /* Determine nominal central wavelength */
+  if (fits_read_key(infits,TSTRING,"HIERARCH ESO INS PATH",card,comment,&status)) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot read value of header card %s\n\
+\tfrom file\n\t%s","HIERARCH ESO INS PATH",infile); return 0;
+  }
+  if (strstr(card,"RED")!=NULL || strstr(card,"red")!=NULL) {
+    if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO INS GRAT2 WLEN",&(ts->cwl),
+		      comment,&status)) {
+      INCLOSE; nferrormsg("UVES_rtharset(): Cannot read value of header card\n\
+\t%s from file\n\t%s.","HIERARCH ESO INS GRAT2 WLEN",infile); return 0;
+    }
+  } else {
+    if (fits_read_key(infits,TDOUBLE,"HIERARCH ESO INS GRAT1 WLEN",&(ts->cwl),
+		      comment,&status)) {
+      INCLOSE; nferrormsg("UVES_rtharset(): Cannot read value of header card\n\
+\t%s from file\n\t%s.","HIERARCH ESO INS GRAT1 WLEN",infile); return 0;
+    }
+  }
+  /* Read which chip we're using directly from the OBJECT descriptor */
+  if (fits_read_key(infits,TSTRING,"OBJECT",card,comment,&status)) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot read value of header card %s\n\
+\tfrom file\n\t%s","OBJECT",infile); return 0;
+  }
+  if (strstr(card,"BLUE") || strstr(card,"blue")) ts->chip=0;
+  else if (strstr(card,"REDL") || strstr(card,"redl")) ts->chip=1;
+  else if (strstr(card,"REDU") || strstr(card,"redu")) ts->chip=2;
+  else {
+    /* v0.55: ESO changed the (silly) use of the OBJECT card and now
+       use the following card to identify which chip is being analysed */
+    if (fits_read_key(infits,TSTRING,"HIERARCH ESO PRO CATG",card,comment,
+		      &status)) {
+      INCLOSE; nferrormsg("UVES_rtharset(): Cannot read value of header card\n\
+\t%s from file\n\t%s","HIERARCH ESO PRO CATG",infile); return 0;
+    }
+    if (strstr(card,"BLUE") || strstr(card,"blue")) ts->chip=0;
+    else if (strstr(card,"REDL") || strstr(card,"redl")) ts->chip=1;
+    else if (strstr(card,"REDU") || strstr(card,"redu")) ts->chip=2;
+    else {
+      INCLOSE; nferrormsg("UVES_rtharset(): Do not understand values of header\n\
+\tcards %s or %s\n\tfrom file\n\t%s","OBJECT","HIERARCH ESO PRO CATG",infile);
+      return 0;
+    }
+  }
+  /* Read binning values */
+  if (fits_read_key(infits,TINT,"HIERARCH ESO DET WIN1 BINX",&(ts->biny),comment,
+		    &status)) {
+    status=0; INCLOSE;
+    nferrormsg("UVES_rtharset(): Cannot read value of header card %s\n\
+\tfrom FITS file\n\t%s.","HIERARCH ESO DET WIN1 BINX",infile); return 0;
+  }
+  if (fits_read_key(infits,TINT,"HIERARCH ESO DET WIN1 BINY",&(ts->binx),comment,
+		    &status)) {
+    status=0; INCLOSE;
+    nferrormsg("UVES_rtharset(): Cannot read value of header card %s\n\
+\tfrom FITS file\n\t%s.","HIERARCH ESO DET WIN1 BINY",infile); return 0;
+  }
+  /* Find the tolerance and polynomial degree used in CPL reduction
+     in a single scan of the recipe parameter cards */
+  if (fits_get_hdrspace(infits,&nkeys,&nmore,&status)) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot find number of header cards\n\
+\tin file\n\t%s",infile); return 0;
+  }
+  for (i=1; i<=nkeys && (!ptol || !pdeg); i++) {
+    if (fits_read_record(infits,i,card,&status)) {
+      INCLOSE; nferrormsg("UVES_rtharset(): Cannot read header card %d\n\
+\tfrom file\n\t%s",i,infile); return 0;
+    }
+    if (strncmp(card,"HIERARCH ESO PRO REC1 PARAM",27) ||
+	sscanf(card+27,"%d %s",&j,word)!=2 || strcmp(word,"NAME") ||
+	!UVES_rthval(card,value)) continue;
+    strlower(value);
+    if (!ptol && !strncmp(value,"tolerance",9)) ptol=j;
+    else if (!pdeg && !strncmp(value,"degree",6)) pdeg=j;
+  }
+  if (!ptol) {
+    INCLOSE;
+    nferrormsg("UVES_rtharset(): Cannot find/read header card containing\n\
+\twavelength calibration tolerance in/from FITS file\n\t%s.",infile); return 0;
+  }
+  sprintf(key,"%s%d%s","HIERARCH ESO PRO REC1 PARAM",ptol," VALUE");
+  if (fits_read_key(infits,TDOUBLE,key,&(ts->tol),comment,&status)) {
+    INCLOSE;
+    nferrormsg("UVES_rtharset(): Cannot read value of header card\n\
+\tHIERARCH ESO PRO REC1 PARAM%d from FITS file\n\t%s.",ptol,infile); return 0;
+  }
+  if (!pdeg) {
+    INCLOSE;
+    nferrormsg("UVES_rtharset(): Cannot find/read header card containing\n\
+\twavelength polynomial degree in/from FITS file\n\t%s.",infile); return 0;
+  }
+  sprintf(key,"%s%d%s","HIERARCH ESO PRO REC1 PARAM",pdeg," VALUE");
+  if (fits_read_key(infits,TINT,key,&(ts->deg),comment,&status)) {
+    INCLOSE;
+    nferrormsg("UVES_rtharset(): Cannot read value of header card\n\
+\tHIERARCH ESO PRO REC1 PARAM%d from FITS file\n\t%s.",pdeg,infile); return 0;
+  }
+  /* Move to HDU containing ThAr information */
+  if (fits_movrel_hdu(infits,4,&hdutype,&status)) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot move to extension %d (HDU %d)\n\
+\tin FITS file\n\t%s.",4,5,infile); return 0;
+  }
+  /* Check HDU type */
+  if (hdutype!=BINARY_TBL) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Extension %d (HDU %d) not a binary\n\
+\ttable in file\n\t%s",4,5,infile); return 0;
+  }
+  /* Find and read in the diffraction order numbers from HISTORY cards
+     in a single scan of the extension header */
+  if (fits_get_hdrspace(infits,&nkeys,&nmore,&status)) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot find number of header cards\n\
+\tin extension %d (HDU %d) of file\n\t%s",4,5,infile); return 0;
+  }
+  for (i=1; i<=nkeys && (!gotfo || !gotlo); i++) {
+    if (fits_read_record(infits,i,card,&status)) {
+      INCLOSE; nferrormsg("UVES_rtharset(): Cannot read header card %d\n\
+\tfrom extension %d (HDU %d) of file\n\t%s",i,4,5,infile); return 0;
+    }
+    if (!gotfo && !strncmp(card,"HISTORY FABSORD",15)) {
+      if (sscanf(card+15,"%d",&(ts->o_ids))!=1) {
+	INCLOSE; nferrormsg("UVES_rtharset(): Cannot read starting diffraction\n\
+\torder number from file \n\t%s",infile); return 0;
+      }
+      gotfo=1;
+    } else if (!gotlo && !strncmp(card,"HISTORY LABSORD",15)) {
+      if (sscanf(card+15,"%d",&(ts->o_ide))!=1) {
+	INCLOSE; nferrormsg("UVES_rtharset(): Cannot read ending diffraction\n\
+\torder number from file \n\t%s",infile); return 0;
+      }
+      gotlo=1;
+    }
+  }
+  if (!gotfo || !gotlo) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot find header record beginning\n\
+\twith %s in file \n\t%s",(gotfo) ? "HISTORY LABSORD" : "HISTORY FABSORD",
+			infile); return 0;
+  }
+  /* Calculate number of diffraction orders */
+  ts->no=abs(ts->o_ids-ts->o_ide+1);
+  /* Calculate diffraction order slope */
+  ts->o_slp=1; if (ts->o_ids>ts->o_ide) ts->o_slp=-1;
+  /* Find number of axes to be read in */
+  if (fits_get_num_cols(infits,&naxis,&status)) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot read number of columns %s\n\
+\tin FITS file\n\t%s","TFIELDS",infile); return 0;
+  }
+  if (naxis!=26) {
+    INCLOSE; nferrormsg("UVES_rtharset(): The binary table in file\n\t%s\n\
+\thas %d columns. It should have %d",infile,naxis,26); return 0;
+  }
+  /* Find number of rows to be read in */
+  if (fits_get_num_rows(infits,&nrows,&status)) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot read number of rows %s\n\
+\tin FITS file\n\t%s","NAXIS2",infile); return 0;
+  }
+  ts->n=nrows;
+
+  /* Resolve the column layout of the binary table */
+  for (j=0; j<NTHCOL; j++) {
+    if (fits_get_colnum(infits,CASEINSEN,UVES_thcolname[j],&(col[j]),&status)) {
+      INCLOSE; nferrormsg("UVES_rtharset(): Cannot find column '%s' in binary\n\
+\ttable in file\n\t%s",UVES_thcolname[j],infile); return 0;
+    }
+  }
+
+  /* Allocate a single block of memory for the ThAr line set and
+     order results, with the double precision arrays placed first */
+  if ((ts->blk=calloc(1,(size_t)(9*ts->n+ts->no)*sizeof(double)+
+		      (size_t)(4*ts->n+3*ts->no)*sizeof(int)+1))==NULL) {
+    INCLOSE; nferrormsg("UVES_rtharset(): Cannot allocate memory for ThAr\n\
+\tline and order arrays of lengths %d and %d",ts->n,ts->no); return 0;
+  }
+  ts->x=(double *)ts->blk; ts->h=ts->x+ts->n; ts->c=ts->h+ts->n;
+  ts->s=ts->c+ts->n; ts->w=ts->s+ts->n; ts->dis=ts->w+ts->n;
+  ts->wlc=ts->dis+ts->n; ts->wlf=ts->wlc+ts->n; ts->res=ts->wlf+ts->n;
+  ts->o_rms=ts->res+ts->n;
+  ts->ora=(int *)(ts->o_rms+ts->no); ts->orr=ts->ora+ts->n;
+  ts->sts=ts->orr+ts->n; ts->stp=ts->sts+ts->n; ts->o_id=ts->stp+ts->n;
+  ts->o_n=ts->o_id+ts->no; ts->o_np=ts->o_n+ts->no;
+  /* Label order id's */
+  for (i=0; i<ts->no; i++) ts->o_id[i]=ts->o_ids+i*ts->o_slp;
+
+  /* Read the relevant columns in chunks of the optimal number of rows,
+     so that each chunk of the table is only read from disk once */
+  data[0]=ts->x; data[1]=ts->h; data[2]=ts->c; data[3]=ts->s; data[4]=ts->w;
+  data[5]=ts->dis; data[6]=ts->wlc; data[7]=ts->wlf; data[8]=ts->ora;
+  data[9]=ts->orr; data[10]=ts->sts; data[11]=ts->stp;
+  if (fits_get_rowsize(infits,&nchunk,&status) || nchunk<1) {
+    status=0; nchunk=nrows;
+  }
+  for (first=0; first<nrows; first+=nread) {
+    nread=(nrows-first<nchunk) ? nrows-first : nchunk;
+    for (j=0; j<NTHCOL; j++) {
+      if (fits_read_col(infits,UVES_thcoltype[j],col[j],first+1,1,nread,&nulval,
+			(UVES_thcoltype[j]==TDOUBLE) ?
+			(void *)((double *)data[j]+first) :
+			(void *)((int *)data[j]+first),&anynul,&status)) {
+	INCLOSE; FREETS(*ts);
+	nferrormsg("UVES_rtharset(): Cannot read rows %ld to %ld of column\n\
+\t'%s' in binary table in file\n\t%s",first+1,first+nread,UVES_thcolname[j],
+		   infile); return 0;
+      }
+    }
+  }
+
+  /* Close input file */
+  INCLOSE;
+
+  return 1;
+
+}
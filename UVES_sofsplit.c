@@ -0,0 +1,46 @@
+/****************************************************************************
+* Write the SOF files for the individual reduction steps of a science
+* exposure from the records of its master SOF file. The SOF file for
+* each step, <base>_<step>.sof, lists the frame names and tags of all
+* records whose reduction step field contains the step name. This is
+* equivalent to what uves_makesof.csh does with awk.
+****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+int UVES_sofsplit(sofrec *recs, int nrec, char *base, manifest *mfst) {
+
+  int      i=0,j=0;
+  char     soffile[LNGSTRLEN]="\0";
+  FILE     *sof_file=NULL;
+  static char *step[NSOFSTEP]={"pred","ord","bias","flat","wav1","wav2",
+			       "std","sci"};
+
+  if (strlen(base)+10>=LNGSTRLEN) {
+    nferrormsg("UVES_sofsplit(): SOF file base name too long:\n\t%s",base);
+    return 0;
+  }
+
+  for (i=0; i<NSOFSTEP; i++) {
+    sprintf(soffile,"%s_%s.sof",base,step[i]);
+    if ((sof_file=UVES_mfopen(mfst,"Reduction step SOF file?",soffile))
+	==NULL) {
+      nferrormsg("UVES_sofsplit(): Cannot open SOF file\n\t%s for writing",
+		 soffile); return 0;
+    }
+    for (j=0; j<nrec; j++)
+      if (strstr(recs[j].red,step[i])!=NULL)
+	fprintf(sof_file,"%s %s\n",recs[j].file,recs[j].tag);
+    if (!UVES_mfclose(mfst,sof_file)) {
+      nferrormsg("UVES_sofsplit(): Cannot complete writing of SOF file\n\t%s",
+		 soffile); return 0;
+    }
+  }
+
+  return 1;
+
+}
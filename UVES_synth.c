@@ -0,0 +1,295 @@
+/****************************************************************************
+* Write a synthetic UVES archive of header-only FITS files for
+* benchmarking. Each night uses a few instrument settings (blue, red or
+* dichroic, with a binning, slit width and nightly grating encoder
+* values), observes flux standards and science targets with occasional
+* attached ThArs, and is followed by a morning calibration plan of
+* biases, flats, wavelength calibrations, order definitions and format
+* checks for each setting. Files are written to one directory per night
+* and named after their ARCFILE, like the ESO archive; their full path
+* names are written to listfile in the order written. Exactly nframes
+* files are written, so the last night is usually incomplete.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include "UVES_headsort.h"
+#include "UVES_hsbench.h"
+#include "const.h"
+#include "file.h"
+#include "error.h"
+
+/* Write one frame per arm of setting K and advance the count */
+#define SYNWRITE(K) \
+  if ((n=UVES_synthset(ndir,&frm,&(UVES_synset[set[K]]),enc[K],nframes-nwr, \
+		       list))<0) { \
+    fclose(list); \
+    nferrormsg("UVES_synth(): Unknown error returned from UVES_synthset()"); \
+    return 0; \
+  } \
+  nwr+=n;
+
+/* Instrument settings */
+static synset UVES_synset[SYNNSET]={
+  {"BLUE",346.0,0.0,101200,0},{"BLUE",437.0,0.0,98400,0},
+  {"RED",0.0,580.0,0,73100},{"RED",0.0,860.0,0,68900},
+  {"DICHR#1",346.0,580.0,101200,73100},{"DICHR#1",390.0,564.0,99800,73500},
+  {"DICHR#2",437.0,760.0,98400,70600},{"DICHR#2",437.0,860.0,98400,68900}
+};
+
+/* Flux standards */
+static char *UVES_synstd[SYNNSTD]={"LTT7987","EG274","HR4468","LTT3218",
+				   "GD71","FEIGE110","HR7950","LTT1020"};
+
+static unsigned long long UVES_synseed=1;
+
+/* Uniform random deviate in [0,1) from a 64-bit xorshift generator, so
+   the same seed gives the same archive on all platforms */
+static double UVES_synthran(void) {
+
+  UVES_synseed^=UVES_synseed>>12; UVES_synseed^=UVES_synseed<<25;
+  UVES_synseed^=UVES_synseed>>27;
+  return (double)((UVES_synseed*2685821657736338717ULL)>>11)/9007199254740992.0;
+
+}
+
+/* Calendar date (and time of day if full is set) of an MJD in ISO format */
+static void UVES_synthdate(double mjd, int full, char *str) {
+
+  long     ms=0,l=0,n=0,i=0,j=0;
+  int      d=0,m=0,y=0;
+
+  l=(long)floor(mjd)+68569+2400001; n=4*l/146097; l-=(146097*n+3)/4;
+  i=4000*(l+1)/1461001; l+=31-1461*i/4; j=80*l/2447; d=l-2447*j/80;
+  l=j/11; m=j+2-12*l; y=100*(n-49)+i+l;
+  if (!full) { sprintf(str,"%4.4d-%2.2d-%2.2d",y,m,d); return; }
+  ms=(long)((mjd-floor(mjd))*86400000.0);
+  sprintf(str,"%4.4d-%2.2d-%2.2dT%2.2ld:%2.2ld:%2.2ld.%3.3ld",y,m,d,
+	  ms/3600000,(ms/60000)%60,(ms/1000)%60,ms%1000);
+
+}
+
+/* Write a single header-only FITS file and add it to the list */
+static int UVES_synthwrite(char *ndir, synfrm *frm, FILE *list) {
+
+  double   val=0.0;
+  int      ival=0,status=0;
+  char     arcfile[NAMELEN]="\0",date[NAMELEN]="\0";
+  char     file[VLNGSTRLEN]="\0";
+  char     *sval=NULL;
+  fitsfile *outfits;
+
+  UVES_synthdate(frm->mjd,1,date);
+  sprintf(arcfile,"UVES.%s.fits",date);
+  if (strlen(ndir)+strlen(arcfile)+3>LNGSTRLEN) {
+    nferrormsg("UVES_synth(): File name too long:\n\t%s/%s",ndir,arcfile);
+    return 0;
+  }
+  sprintf(file,"!%s/%s",ndir,arcfile);
+  if (fits_create_file(&outfits,file,&status)) {
+    nferrormsg("UVES_synth(): Cannot create FITS file %s",file+1); return 0;
+  }
+  fits_create_img(outfits,BYTE_IMG,0,NULL,&status);
+  fits_write_key(outfits,TSTRING,"ARCFILE",arcfile,"Archive file name",&status);
+  fits_write_key(outfits,TDOUBLE,"MJD-OBS",&(frm->mjd),"Obs start",&status);
+  fits_write_key(outfits,TDOUBLE,"EXPTIME",&(frm->et),"Total integration time",
+		 &status);
+  if (strlen(frm->targ))
+    fits_write_key(outfits,TSTRING,"OBJECT",frm->targ,"Original target",
+		   &status);
+  fits_write_key(outfits,TSTRING,"HIERARCH ESO DPR CATG",frm->catg,
+		 "Observation category",&status);
+  fits_write_key(outfits,TSTRING,"HIERARCH ESO DPR TYPE",frm->type,
+		 "Observation type",&status);
+  if (strlen(frm->targ))
+    fits_write_key(outfits,TSTRING,"HIERARCH ESO OBS TARG NAME",frm->targ,
+		   "OB target name",&status);
+  val=(frm->arm) ? 21.0 : 42.0;
+  fits_write_key(outfits,TDOUBLE,"HIERARCH ESO DET EXP RDTTIME",&val,
+		 "Image readout time",&status);
+  val=(frm->arm) ? 1.5 : 2.5;
+  fits_write_key(outfits,TDOUBLE,"HIERARCH ESO DET EXP XFERTIM",&val,
+		 "Image transfer time",&status);
+  fits_write_key(outfits,TINT,"HIERARCH ESO DET WIN1 BINX",&(frm->bin),
+		 "Binning factor along X",&status);
+  fits_write_key(outfits,TINT,"HIERARCH ESO DET WIN1 BINY",&(frm->bin),
+		 "Binning factor along Y",&status);
+  if (!strcmp(frm->type,"BIAS")) {
+    sval=(frm->arm) ? "MIT/LL" : "EEV";
+    fits_write_key(outfits,TSTRING,"HIERARCH ESO DET CHIP1 NAME",sval,
+		   "Detector chip name",&status);
+  }
+  else {
+    val=12.5+0.5*UVES_synthran();
+    fits_write_key(outfits,TDOUBLE,"HIERARCH ESO INS TEMP1 MEAN",&val,
+		   "Blue arm temperature",&status);
+    val=13.5+0.5*UVES_synthran();
+    fits_write_key(outfits,TDOUBLE,"HIERARCH ESO INS TEMP2 MEAN",&val,
+		   "Red arm temperature",&status);
+    val=742.0+3.0*UVES_synthran();
+    fits_write_key(outfits,TDOUBLE,"HIERARCH ESO INS SENS26 MEAN",&val,
+		   "Barometric pressure",&status);
+    fits_write_key(outfits,TSTRING,"HIERARCH ESO INS MODE",frm->mode,
+		   "Instrument mode",&status);
+    sval=(frm->arm) ? "RED" : "BLUE";
+    fits_write_key(outfits,TSTRING,"HIERARCH ESO INS PATH",sval,
+		   "Optical path",&status);
+    fits_write_key(outfits,TDOUBLE,(frm->arm) ? "HIERARCH ESO INS GRAT2 WLEN" :
+		   "HIERARCH ESO INS GRAT1 WLEN",&(frm->wl),
+		   "Grating central wavelength",&status);
+    fits_write_key(outfits,TDOUBLE,(frm->arm) ? "HIERARCH ESO INS SLIT3 WID" :
+		   "HIERARCH ESO INS SLIT2 WID",&(frm->sw),"Slit width",&status);
+    ival=frm->enc;
+    fits_write_key(outfits,TINT,(frm->arm) ? "HIERARCH ESO INS GRAT2 ENC" :
+		   "HIERARCH ESO INS GRAT1 ENC",&ival,"Grating encoder value",
+		   &status);
+  }
+  fits_close_file(outfits,&status);
+  if (status) {
+    nferrormsg("UVES_synth(): Cannot write header of FITS file %s",file+1);
+    return 0;
+  }
+  fprintf(list,"%s\n",file+1);
+
+  return 1;
+
+}
+
+/* Write one frame in each arm used by a setting, stopping when enough
+   frames have been written. Returns the number written or -1 on error */
+static int UVES_synthset(char *ndir, synfrm *frm, synset *set, int *enc,
+			 int nleft, FILE *list) {
+
+  int      n=0;
+  int      arm=0;
+
+  strcpy(frm->mode,set->mode);
+  for (arm=0; arm<2 && n<nleft; arm++) {
+    if ((!arm && set->bwl==0.0) || (arm && set->rwl==0.0)) continue;
+    frm->arm=arm; frm->wl=(arm) ? set->rwl : set->bwl; frm->enc=enc[arm];
+    /* Red arm file starts a little later in dichroic modes */
+    if (arm && set->bwl>0.0) frm->mjd+=0.5/C_SECDAY;
+    if (!UVES_synthwrite(ndir,frm,list)) return -1;
+    n++;
+  }
+
+  return n;
+
+}
+
+int UVES_synth(char *dir, int nframes, unsigned long seed, char *listfile) {
+
+  double   t=0.0,tend=0.0,sw[SYNMAXSET];
+  int      night=0,nset=0,bin=0,nobj=0,nsci=0,nwr=0,n=0,obj=0;
+  int      set[SYNMAXSET],enc[SYNMAXSET][2];
+  int      i=0,j=0,k=0;
+  char     date[NAMELEN]="\0",targ[NAMELEN]="\0",ndir[LNGSTRLEN]="\0";
+  FILE     *list=NULL;
+  synfrm   frm;
+
+  UVES_synseed=(unsigned long long)seed*0x9E3779B97F4A7C15ULL+1;
+  if ((list=faskwopen("List of synthetic FITS files?",listfile,4))==NULL) {
+    nferrormsg("UVES_synth(): Cannot open file %s for writing",listfile);
+    return 0;
+  }
+
+  for (night=0; nwr<nframes; night++) {
+
+    /* Make directory for this night */
+    t=SYNMJD0+night;
+    UVES_synthdate(t,0,date);
+    if (strlen(dir)+strlen(date)+2>LNGSTRLEN-NAMELEN) {
+      fclose(list);
+      nferrormsg("UVES_synth(): Directory name too long:\n\t%s",dir); return 0;
+    }
+    sprintf(ndir,"%s/%s",dir,date);
+    if (!isdir(ndir) && mkdir(ndir,DIR_PERM)) {
+      fclose(list);
+      nferrormsg("UVES_synth(): Cannot create directory %s",ndir); return 0;
+    }
+
+    /* Choose settings, binning, slit widths and encoder values */
+    nset=1+(int)(SYNMAXSET*UVES_synthran());
+    bin=(UVES_synthran()<0.7) ? 1 : 2;
+    for (i=0; i<nset; i++) {
+      do {
+	set[i]=(int)(SYNNSET*UVES_synthran());
+	for (j=0; j<i && set[j]!=set[i]; j++);
+      } while (j<i);
+      sw[i]=0.8+0.2*(int)(3.0*UVES_synthran());
+      for (j=0; j<2; j++) enc[i][j]=((j) ? UVES_synset[set[i]].renc :
+				     UVES_synset[set[i]].benc)+
+			    (int)(7.0*UVES_synthran())-3;
+    }
+    memset(&frm,0,sizeof(synfrm)); frm.bin=bin;
+
+    /* Night: a standard then science exposures in each setting */
+    tend=t+SYNNIGHT;
+    for (i=0; i<nset && t<tend && nwr<nframes; i++) {
+      frm.sw=sw[i];
+      frm.mjd=t; frm.et=60.0+240.0*UVES_synthran();
+      strcpy(frm.type,"STD"); strcpy(frm.catg,"CALIB");
+      strcpy(frm.targ,UVES_synstd[(int)(SYNNSTD*UVES_synthran())]);
+      SYNWRITE(i);
+      t+=(frm.et+SYNOVHD)/C_SECDAY;
+      nobj=1+(int)(2.0*UVES_synthran());
+      for (j=0; j<nobj && t<tend && nwr<nframes; j++) {
+	obj=(int)(SYNNOBJ*UVES_synthran());
+	sprintf(targ,"J%2.2d%2.2d%c%2.2d%2.2d",obj%24,(obj*7)%60,
+		(obj%3) ? '-' : '+',(obj*13)%90,(obj*11)%60);
+	nsci=1+(int)(4.0*UVES_synthran());
+	for (k=0; k<nsci && t<tend && nwr<nframes; k++) {
+	  frm.mjd=t; frm.et=1200.0+2400.0*UVES_synthran(); strcpy(frm.targ,targ);
+	  strcpy(frm.type,"OBJECT"); strcpy(frm.catg,"SCIENCE");
+	  SYNWRITE(i);
+	  t+=(frm.et+SYNOVHD)/C_SECDAY;
+	  if (UVES_synthran()<SYNPATT && nwr<nframes) {
+	    frm.mjd=t; frm.et=15.0; frm.targ[0]='\0';
+	    strcpy(frm.type,"LAMP,WAVE"); strcpy(frm.catg,"CALIB");
+	    SYNWRITE(i);
+	    t+=(frm.et+SYNOVHD)/C_SECDAY;
+	  }
+	}
+      }
+    }
+
+    /* Morning: biases for each arm used, then flats, wavelength
+       calibrations, order definitions and format checks per setting */
+    t=SYNMJD0+night+SYNMORN; frm.targ[0]='\0'; frm.sw=0.0;
+    strcpy(frm.catg,"CALIB"); strcpy(frm.type,"BIAS"); frm.et=0.0;
+    for (j=0; j<2; j++) {
+      for (i=0; i<nset; i++)
+	if ((j) ? UVES_synset[set[i]].rwl>0.0 : UVES_synset[set[i]].bwl>0.0)
+	  break;
+      if (i==nset) continue;
+      for (k=0; k<SYNNBIAS && nwr<nframes; k++) {
+	frm.mjd=t; frm.arm=j;
+	if (!UVES_synthwrite(ndir,&frm,list)) {
+	  fclose(list);
+	  nferrormsg("UVES_synth(): Unknown error returned from UVES_synthwrite()");
+	  return 0;
+	}
+	nwr++; t+=SYNOVHD/C_SECDAY;
+      }
+    }
+    for (i=0; i<nset && nwr<nframes; i++) {
+      frm.sw=sw[i];
+      for (k=0; k<SYNNFLAT+3 && nwr<nframes; k++) {
+	frm.mjd=t;
+	if (k<SYNNFLAT) { strcpy(frm.type,"LAMP,FLAT"); frm.et=10.0; }
+	else if (k==SYNNFLAT) { strcpy(frm.type,"LAMP,WAVE"); frm.et=15.0; }
+	else if (k==SYNNFLAT+1) { strcpy(frm.type,"LAMP,ORDERDEF"); frm.et=5.0; }
+	else { strcpy(frm.type,"LAMP,FMTCHK"); frm.et=5.0; }
+	SYNWRITE(i);
+	t+=(frm.et+SYNOVHD)/C_SECDAY;
+      }
+    }
+
+  }
+  fclose(list);
+
+  return 1;
+
+}
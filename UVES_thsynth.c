@@ -0,0 +1,262 @@
+/****************************************************************************
+
+UVES_thsynth: Write a synthetic ThAr line table in the form of those
+written by the CPL uves_cal_wavecal command, for testing the
+tolerance-finding modes of UVES_wavres.
+
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "UVES_wavres.h"
+#include "memory.h"
+#include "error.h"
+
+/* Global declarations */
+char      *progname;
+
+/* Columns of the line table: those read by UVES_rtharset() first, in
+   the order of its tharset arrays, then placeholders so that the table
+   has the same number of columns as CPL line tables */
+static char *UVES_thscolname[THSNCOL]={"X","Peak","Background","Slope",
+				       "Xwidth","Pixel","Ident","WaveC",
+				       "AbsOrder","Y","Select","NLinSol",
+				       "Spare01","Spare02","Spare03","Spare04",
+				       "Spare05","Spare06","Spare07","Spare08",
+				       "Spare09","Spare10","Spare11","Spare12",
+				       "Spare13","Spare14"};
+
+static unsigned long long UVES_thsseed=1;
+
+/****************************************************************************
+* Print the usage message
+****************************************************************************/
+
+void usage(void) {
+
+  fprintf(stderr,"\n%s: Write a synthetic ThAr line table for testing\n\
+\tUVES_wavres\n",progname);
+
+  fprintf(stderr,"\nBy Michael Murphy");
+
+  fprintf(stderr,"\nUsage: %s [OPTIONS] [Output FITS file]\n",progname);
+
+  fprintf(stderr, "\nOptions:\n\
+  -h, -help        : Print this message.\n\
+  -chip = %1d        : Chip (0=blue; 1=redl; 2=redu).\n\
+  -nl = %-4d       : Number of lines per order used in polynomial solution.\n\
+  -tol = %5.3lf     : Tolerance used in polynomial solution [pix].\n\
+  -seed = %-4d     : Seed for line positions.\n\
+\nThe absolute residuals [pix] of the lines used in each order are spread\n\
+evenly between zero and the tolerance, so the RMS residual grows linearly\n\
+with the tolerance and the number of lines within it is known exactly.\n\
+Each order also has %d selected lines outside the tolerance and %d lines\n\
+which are not selected.\n\n",THSCHIP,THSNL,THSTOL,THSSEED,THSNREJ,THSNUNS);
+  exit(3);
+}
+
+/****************************************************************************
+* Uniform random deviate in [0,1) from a 64-bit xorshift generator, so
+* the same seed gives the same table on all platforms
+****************************************************************************/
+
+double UVES_thsran(void) {
+
+  UVES_thsseed^=UVES_thsseed>>12; UVES_thsseed^=UVES_thsseed<<25;
+  UVES_thsseed^=UVES_thsseed>>27;
+  return (double)((UVES_thsseed*2685821657736338717ULL)>>11)/9007199254740992.0;
+
+}
+
+/****************************************************************************
+* Fill a ThAr line set with nl used lines per order for a chip
+****************************************************************************/
+
+int UVES_thsfill(tharset *ts, int chip, int nl, double tol) {
+
+  double   cwl[3]={390.0,580.0,580.0};         /* Setting central wl [nm] */
+  double   lc=0.0,dis=0.0,r=0.0;
+  int      o_ids[3]={153,121,91};              /* First (bluest) order */
+  int      no[3]={32,33,26};                   /* Number of orders */
+  int      nlo=0,mid=0;
+  int      i=0,j=0,k=0;
+
+  memset(ts,0,sizeof(tharset));
+  ts->chip=chip; ts->cwl=cwl[chip]; ts->tol=tol; ts->deg=4;
+  ts->binx=ts->biny=1; ts->no=no[chip]; ts->o_ids=o_ids[chip]; ts->o_slp=-1;
+  ts->o_ide=ts->o_ids+(ts->no-1)*ts->o_slp;
+  nlo=nl+THSNREJ+THSNUNS; ts->n=ts->no*nlo;
+  if ((ts->x=darray(ts->n))==NULL || (ts->h=darray(ts->n))==NULL ||
+      (ts->c=darray(ts->n))==NULL || (ts->s=darray(ts->n))==NULL ||
+      (ts->w=darray(ts->n))==NULL || (ts->dis=darray(ts->n))==NULL ||
+      (ts->wlc=darray(ts->n))==NULL || (ts->wlf=darray(ts->n))==NULL ||
+      (ts->ora=iarray(ts->n))==NULL || (ts->orr=iarray(ts->n))==NULL ||
+      (ts->sts=iarray(ts->n))==NULL || (ts->stp=iarray(ts->n))==NULL) {
+    nferrormsg("UVES_thsfill(): Cannot allocate memory for line arrays\n\
+\tof length %d",ts->n); return 0;
+  }
+
+  /* Fill each order in turn. Order m has central wavelength
+     proportional to 1/m and a free spectral range of lc/m, which its
+     pixels cover with some overlap between orders */
+  mid=ts->o_ids+ts->o_slp*ts->no/2;
+  for (k=0,i=0; k<ts->no; k++) {
+    lc=10.0*cwl[chip]*(double)mid/(double)(ts->o_ids+k*ts->o_slp);
+    dis=1.3*lc/(double)(ts->o_ids+k*ts->o_slp)/(double)THSNPIX;
+    for (j=0; j<nlo; j++,i++) {
+      ts->orr[i]=k+1; ts->ora[i]=ts->o_ids+k*ts->o_slp;
+      ts->x[i]=(double)THSNPIX*UVES_thsran(); ts->dis[i]=dis;
+      ts->h[i]=1000.0+9000.0*UVES_thsran(); ts->c[i]=50.0+10.0*UVES_thsran();
+      ts->s[i]=0.01*(UVES_thsran()-0.5); ts->w[i]=2.0+0.5*UVES_thsran();
+      ts->wlc[i]=lc+dis*(ts->x[i]-0.5*(double)THSNPIX);
+      /* Used lines, then selected lines outside tolerance, then lines
+	 which are not selected */
+      if (j<nl) { r=tol*((double)j+0.5)/(double)nl; ts->sts[i]=ts->stp[i]=1; }
+      else if (j<nl+THSNREJ) {
+	r=tol*(1.0+((double)(j-nl)+0.5)/(double)THSNREJ); ts->sts[i]=1;
+      }
+      else r=3.0*tol*UVES_thsran();
+      if (UVES_thsran()<0.5) r=-r;
+      ts->wlf[i]=ts->wlc[i]+r*dis;
+    }
+  }
+
+  return 1;
+
+}
+
+/****************************************************************************
+* Write a ThAr line set as a CPL line table: recipe parameters and
+* setting in the primary header and the lines in a binary table in
+* extension 4, with empty extensions to make up the 10 HDUs of a CPL
+* line table
+****************************************************************************/
+
+int UVES_thswrite(tharset *ts, char *outfile) {
+
+  int      status=0,i=0;
+  char     *form[THSNCOL],*unit[THSNCOL];
+  char     sval[FLEN_VALUE]="\0",chipname[3][5]={"BLUE","REDL","REDU"};
+  double   *zero=NULL;
+  void     *data[NTHCOL];
+  fitsfile *outfits;
+
+  if ((zero=darray(ts->n))==NULL) {
+    nferrormsg("UVES_thswrite(): Cannot allocate memory for zero array\n\
+\tof length %d",ts->n); return 0;
+  }
+  for (i=0; i<ts->n; i++) zero[i]=0.0;
+  for (i=0; i<THSNCOL; i++) {
+    form[i]=(i>=8 && i<NTHCOL) ? "1J" : "1D"; unit[i]="";
+  }
+
+  /* Primary header */
+  if (fits_create_file(&outfits,outfile,&status)) {
+    free(zero);
+    nferrormsg("UVES_thswrite(): Cannot create FITS file %s",outfile);
+    return 0;
+  }
+  fits_create_img(outfits,BYTE_IMG,0,NULL,&status);
+  sprintf(sval,"LINE_TABLE_%s",chipname[ts->chip]);
+  fits_write_key(outfits,TSTRING,"OBJECT",sval,"Original target",&status);
+  fits_write_key(outfits,TSTRING,"HIERARCH ESO INS PATH",
+		 (ts->chip) ? "RED" : "BLUE","Optical path used",&status);
+  fits_write_key(outfits,TDOUBLE,(ts->chip) ? "HIERARCH ESO INS GRAT2 WLEN" :
+		 "HIERARCH ESO INS GRAT1 WLEN",&(ts->cwl),"Grating central \
+wavelength",&status);
+  fits_write_key(outfits,TINT,"HIERARCH ESO DET WIN1 BINX",&(ts->biny),
+		 "Binning factor along X",&status);
+  fits_write_key(outfits,TINT,"HIERARCH ESO DET WIN1 BINY",&(ts->binx),
+		 "Binning factor along Y",&status);
+  fits_write_key(outfits,TSTRING,"HIERARCH ESO PRO CATG",sval,
+		 "Category of pipeline product",&status);
+  fits_write_key(outfits,TSTRING,"HIERARCH ESO PRO REC1 PARAM1 NAME","degree",
+		 "Degrees of wavelength solution",&status);
+  sprintf(sval,"%d",ts->deg);
+  fits_write_key(outfits,TSTRING,"HIERARCH ESO PRO REC1 PARAM1 VALUE",sval,
+		 "Default: 4",&status);
+  fits_write_key(outfits,TSTRING,"HIERARCH ESO PRO REC1 PARAM2 NAME",
+		 "tolerance","Tolerance of fit",&status);
+  sprintf(sval,"%.3lf",ts->tol);
+  fits_write_key(outfits,TSTRING,"HIERARCH ESO PRO REC1 PARAM2 VALUE",sval,
+		 "Default: 0.07",&status);
+  /* Extensions 1 to 3 */
+  for (i=1; i<4; i++) fits_create_img(outfits,BYTE_IMG,0,NULL,&status);
+  /* Line table in extension 4 */
+  fits_create_tbl(outfits,BINARY_TBL,(LONGLONG)ts->n,THSNCOL,UVES_thscolname,
+		  form,unit,"LINETABLE",&status);
+  sprintf(sval,"FABSORD %d",ts->o_ids); fits_write_history(outfits,sval,&status);
+  sprintf(sval,"LABSORD %d",ts->o_ide); fits_write_history(outfits,sval,&status);
+  data[0]=ts->x; data[1]=ts->h; data[2]=ts->c; data[3]=ts->s; data[4]=ts->w;
+  data[5]=ts->dis; data[6]=ts->wlc; data[7]=ts->wlf; data[8]=ts->ora;
+  data[9]=ts->orr; data[10]=ts->sts; data[11]=ts->stp;
+  for (i=0; i<THSNCOL; i++)
+    fits_write_col(outfits,(i>=8 && i<NTHCOL) ? TINT : TDOUBLE,i+1,1,1,
+		   (LONGLONG)ts->n,(i<NTHCOL) ? data[i] : (void *)zero,&status);
+  /* Extensions 5 to 9 */
+  for (i=5; i<10; i++) fits_create_img(outfits,BYTE_IMG,0,NULL,&status);
+  fits_close_file(outfits,&status);
+  free(zero);
+  if (status) {
+    nferrormsg("UVES_thswrite(): Error writing FITS file %s",outfile);
+    return 0;
+  }
+
+  return 1;
+
+}
+
+/****************************************************************************
+* The main program
+
+  Things to do:
+
+****************************************************************************/
+
+int main(int argc, char *argv[]) {
+
+  double   tol=THSTOL;
+  int      chip=THSCHIP,nl=THSNL,seed=THSSEED;
+  int      i=0;
+  char     *outfile=NULL;
+  tharset  ts;
+
+  /* Define the program name from the command line input */
+  progname=((progname=strrchr(argv[0],'/'))==NULL) ? argv[0] : progname+1;
+  /* Scan command line for options */
+  while (++i<argc) {
+    if (!strcmp(argv[i],"-chip")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&chip)!=1 || chip<0 || chip>2)
+	usage();
+    }
+    else if (!strcmp(argv[i],"-nl")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&nl)!=1 || nl<1) usage();
+    }
+    else if (!strcmp(argv[i],"-tol")) {
+      if (++i>=argc || sscanf(argv[i],"%lf",&tol)!=1 || tol<=0.0) usage();
+    }
+    else if (!strcmp(argv[i],"-seed")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&seed)!=1) usage();
+    }
+    else if (!strcmp(argv[i],"-help") || !strcmp(argv[i],"-h")) usage();
+    else if (argv[i][0]=='-' || outfile!=NULL) usage();
+    else outfile=argv[i];
+  }
+  if (outfile==NULL) usage();
+
+  /* Make and write line set */
+  UVES_thsseed=(seed) ? (unsigned long long)seed : 1;
+  if (!UVES_thsfill(&ts,chip,nl,tol))
+    errormsg("Unknown error returned from UVES_thsfill()");
+  if (!UVES_thswrite(&ts,outfile))
+    errormsg("Unknown error returned from UVES_thswrite()");
+
+  /* Clean up */
+  free(ts.x); free(ts.h); free(ts.c); free(ts.s); free(ts.w); free(ts.dis);
+  free(ts.wlc); free(ts.wlf); free(ts.ora); free(ts.orr); free(ts.sts);
+  free(ts.stp);
+
+  return 1;
+
+}
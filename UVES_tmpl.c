@@ -0,0 +1,403 @@
+/****************************************************************************
+* Template engine for writing reduction scripts. Templates are compiled
+* once into a sequence of operations (literal text spans, field values
+* and sections) which are then rendered for each output file into a
+* reusable buffer.
+*
+* Template syntax:
+*   {{field}}            : Value of field
+*   {{#field}}...{{/field}} : Rendered only if field is set
+*   {{^field}}...{{/field}} : Rendered only if field is not set
+*   {{*list}}...{{/list}}   : Rendered once for each item in list, with
+*                             the item's fields overriding those outside
+*   {{!comment}}         : Ignored
+* A field is "set" if it has a value which is neither empty nor "0". A
+* section or comment tag which is alone on a line is removed along with
+* the rest of that line.
+****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "UVES_headsort.h"
+#include "file.h"
+#include "error.h"
+
+/* Names by which fields and lists are referred to in templates */
+static char *tmplfield[TF_NFIELD]={"prog","file","obj","cwl","ind","ci",
+  "cia","bin","swid","std","thar","atmo","flst","tol","tolw","tolc","minl",
+  "maxl","missing","nostdreq","nostd","dostd","redu","rmglob","arm","Arm",
+  "chip","ccd","lref","nord","deg","pcopt","chiparg","sof"};
+static char *tmpllist[TL_NLIST]={"chip","sci"};
+
+/****************************************************************************
+* Compile template source text into a list of operations
+****************************************************************************/
+
+tmpl *UVES_tmplcomp(char *name, char *text) {
+
+  int      nopmax=0,nstk=0,line=1,type=0,arg=0;
+  int      stk[TMPLNEST];
+  char     tag[NAMELEN]="\0";
+  char     *p=NULL,*q=NULL,*lit=NULL,*eol=NULL,*bol=NULL;
+  tmpl     *tp=NULL;
+  tmplop   *op=NULL;
+
+  /* Allocate memory for template and make our own copy of source */
+  if ((tp=(tmpl *)malloc(sizeof(tmpl)))==NULL) {
+    nferrormsg("UVES_tmplcomp(): Cannot allocate memory for template %s",name);
+    return NULL;
+  }
+  tp->nop=0; tp->op=NULL; snprintf(tp->name,NAMELEN,"%s",name);
+  if ((tp->text=(char *)malloc(strlen(text)+1))==NULL) {
+    free(tp);
+    nferrormsg("UVES_tmplcomp(): Cannot allocate memory for template %s",name);
+    return NULL;
+  }
+  strcpy(tp->text,text);
+
+  /* Scan through template source */
+  lit=p=tp->text;
+  while (1) {
+    q=strstr(p,"{{");
+    /* Make sure there's room for two more operations */
+    if (tp->nop+2>nopmax) {
+      nopmax=(nopmax) ? 2*nopmax : 64;
+      if ((op=(tmplop *)realloc(tp->op,(size_t)(nopmax*sizeof(tmplop))))
+	  ==NULL) {
+	nferrormsg("UVES_tmplcomp(): Cannot allocate memory for\n\
+\toperations in template %s",name); UVES_tmplfree(tp); return NULL;
+      }
+      tp->op=op;
+    }
+    /* Count lines for error messages */
+    for (eol=p; *eol && (q==NULL || eol<q); eol++) if (*eol=='\n') line++;
+    if (q==NULL) {
+      /* Final literal text */
+      if (*lit) {
+	op=&(tp->op[tp->nop++]); op->type=TO_LIT; op->arg=op->end=0;
+	op->off=lit-tp->text; op->len=strlen(lit);
+      }
+      break;
+    }
+    /* Parse tag */
+    if ((eol=strstr(q+2,"}}"))==NULL) {
+      nferrormsg("UVES_tmplcomp(): Unterminated tag on line %d\n\
+\tof template %s",line,name); UVES_tmplfree(tp); return NULL;
+    }
+    switch (q[2]) {
+    case '#': type=TO_IF; q++; break;
+    case '^': type=TO_NOT; q++; break;
+    case '*': type=TO_EACH; q++; break;
+    case '/': type=TO_END; q++; break;
+    case '!': type=-1; q++; break;
+    default: type=TO_FIELD; break;
+    }
+    if (type!=-1) {
+      if (eol-q-2<1 || eol-q-2>=NAMELEN) {
+	nferrormsg("UVES_tmplcomp(): Invalid tag on line %d\n\
+\tof template %s",line,name); UVES_tmplfree(tp); return NULL;
+      }
+      strncpy(tag,q+2,eol-q-2); tag[eol-q-2]='\0';
+      if (type==TO_EACH || (type==TO_END && nstk &&
+			    tp->op[stk[nstk-1]].type==TO_EACH)) {
+	for (arg=0; arg<TL_NLIST; arg++) if (!strcmp(tag,tmpllist[arg])) break;
+	if (arg==TL_NLIST) {
+	  nferrormsg("UVES_tmplcomp(): Unknown list '%s' on line %d\n\
+\tof template %s",tag,line,name); UVES_tmplfree(tp); return NULL;
+	}
+      }
+      else {
+	for (arg=0; arg<TF_NFIELD; arg++) if (!strcmp(tag,tmplfield[arg])) break;
+	if (arg==TF_NFIELD) {
+	  nferrormsg("UVES_tmplcomp(): Unknown field '%s' on line %d\n\
+\tof template %s",tag,line,name); UVES_tmplfree(tp); return NULL;
+	}
+      }
+    }
+    /* Re-point q to start of tag and eol to end of tag */
+    if (type!=TO_FIELD) q--;
+    eol+=2; p=eol;
+    /* Remove standalone section and comment tags with their lines */
+    if (type!=TO_FIELD) {
+      bol=q; while (bol>lit && (*(bol-1)==' ' || *(bol-1)=='\t')) bol--;
+      while (*eol==' ' || *eol=='\t') eol++;
+      if ((bol==tp->text || *(bol-1)=='\n') && (*eol=='\n' || !*eol)) {
+	q=bol; p=(*eol) ? eol+1 : eol; line++;
+      }
+    }
+    /* Literal text preceding tag */
+    if (q>lit) {
+      op=&(tp->op[tp->nop++]); op->type=TO_LIT; op->arg=op->end=0;
+      op->off=lit-tp->text; op->len=q-lit;
+    }
+    lit=p;
+    if (type==-1) continue;
+    /* Check section nesting */
+    if (type==TO_END) {
+      if (!nstk || tp->op[stk[nstk-1]].arg!=arg) {
+	nferrormsg("UVES_tmplcomp(): Unexpected end of section '%s'\n\
+\ton line %d of template %s",tag,line,name); UVES_tmplfree(tp); return NULL;
+      }
+      tp->op[stk[--nstk]].end=tp->nop;
+    }
+    op=&(tp->op[tp->nop]); op->type=type; op->arg=arg;
+    op->off=op->len=op->end=0;
+    if (type==TO_IF || type==TO_NOT || type==TO_EACH) {
+      if (nstk==TMPLNEST) {
+	nferrormsg("UVES_tmplcomp(): Sections nested too deeply on\n\
+\tline %d of template %s",line,name); UVES_tmplfree(tp); return NULL;
+      }
+      stk[nstk++]=tp->nop;
+    }
+    tp->nop++;
+  }
+  if (nstk) {
+    nferrormsg("UVES_tmplcomp(): Section '%s' not ended in template %s",
+	       (tp->op[stk[nstk-1]].type==TO_EACH) ?
+	       tmpllist[tp->op[stk[nstk-1]].arg] :
+	       tmplfield[tp->op[stk[nstk-1]].arg],name);
+    UVES_tmplfree(tp); return NULL;
+  }
+
+  return tp;
+
+}
+
+/****************************************************************************
+* Free memory associated with a compiled template
+****************************************************************************/
+
+void UVES_tmplfree(tmpl *tp) {
+
+  if (tp==NULL) return;
+  if (tp->op!=NULL) free(tp->op);
+  if (tp->text!=NULL) free(tp->text);
+  free(tp);
+
+}
+
+/****************************************************************************
+* Load a template from TMPLDIR/<name>.tmpl if it exists, otherwise use
+* the built-in template, and compile it
+****************************************************************************/
+
+tmpl *UVES_tmplload(int type, char *tmpldir) {
+
+  long     nbyte=0;
+  char     tmplfile[LNGSTRLEN]="\0";
+  char     *name=NULL,*text=NULL;
+  FILE     *tmpl_file=NULL;
+  tmpl     *tp=NULL;
+
+  if ((text=UVES_tmpldef(type,&name))==NULL) {
+    nferrormsg("UVES_tmplload(): Unknown template type %d",type); return NULL;
+  }
+  if (tmpldir==NULL) return UVES_tmplcomp(name,text);
+
+  /* Read template file if present */
+  if (strlen(tmpldir)+strlen(name)+strlen(TMPLEXT)+2>LNGSTRLEN) {
+    nferrormsg("UVES_tmplload(): Template directory name too long:\n\t%s",
+	       tmpldir); return NULL;
+  }
+  sprintf(tmplfile,"%s/%s%s",tmpldir,name,TMPLEXT);
+  if ((tmpl_file=faskropen("Template file?",tmplfile,4))==NULL)
+    return UVES_tmplcomp(name,text);
+  if (fseek(tmpl_file,0,SEEK_END) || (nbyte=ftell(tmpl_file))<0 ||
+      fseek(tmpl_file,0,SEEK_SET)) {
+    fclose(tmpl_file);
+    nferrormsg("UVES_tmplload(): Cannot determine size of template\n\
+\tfile %s",tmplfile); return NULL;
+  }
+  if ((text=(char *)malloc((size_t)(nbyte+1)))==NULL) {
+    fclose(tmpl_file);
+    nferrormsg("UVES_tmplload(): Cannot allocate memory for template\n\
+\tfile %s",tmplfile); return NULL;
+  }
+  if (fread(text,1,nbyte,tmpl_file)!=nbyte) {
+    fclose(tmpl_file); free(text);
+    nferrormsg("UVES_tmplload(): Cannot read template file %s",tmplfile);
+    return NULL;
+  }
+  fclose(tmpl_file); text[nbyte]='\0';
+  tp=UVES_tmplcomp(tmplfile,text); free(text);
+
+  return tp;
+
+}
+
+/****************************************************************************
+* Routines for setting field values and list items in template context
+****************************************************************************/
+
+/* Format a string into the context's arena, returning its offset */
+static int UVES_tmplfmt(tmplctx *ctx, char *fmt, va_list ap) {
+
+  int      n=0,off=0;
+  char     *arena=NULL;
+  va_list  ap2;
+
+  va_copy(ap2,ap); n=vsnprintf(NULL,0,fmt,ap2); va_end(ap2);
+  if (n<0) {
+    nferrormsg("UVES_tmplfmt(): Cannot format field value '%s'",fmt);
+    return -1;
+  }
+  if (ctx->narena+n+1>ctx->narenamax) {
+    ctx->narenamax=(ctx->narenamax) ? 2*ctx->narenamax : VVVLNGSTRLEN;
+    while (ctx->narena+n+1>ctx->narenamax) ctx->narenamax*=2;
+    if ((arena=(char *)realloc(ctx->arena,(size_t)ctx->narenamax))==NULL) {
+      nferrormsg("UVES_tmplfmt(): Cannot allocate memory for field values");
+      return -1;
+    }
+    ctx->arena=arena;
+  }
+  off=ctx->narena; vsprintf(ctx->arena+off,fmt,ap); ctx->narena+=n+1;
+
+  return off;
+
+}
+
+int UVES_tmplclear(tmplctx *ctx) {
+
+  int      i=0;
+
+  for (i=0; i<TF_NFIELD; i++) ctx->val[i]=-1;
+  for (i=0; i<TL_NLIST; i++) ctx->nitem[i]=0;
+  ctx->narena=0;
+
+  return 1;
+
+}
+
+int UVES_tmplset(tmplctx *ctx, int field, char *fmt, ...) {
+
+  va_list  ap;
+
+  va_start(ap,fmt); ctx->val[field]=UVES_tmplfmt(ctx,fmt,ap); va_end(ap);
+  if (ctx->val[field]<0) {
+    nferrormsg("UVES_tmplset(): Cannot set value of field '%s'",
+	       tmplfield[field]); return 0;
+  }
+
+  return 1;
+
+}
+
+int UVES_tmpladd(tmplctx *ctx, int list) {
+
+  int      i=0;
+  int      *item=NULL;
+
+  if (ctx->nitem[list]==ctx->nitemmax[list]) {
+    ctx->nitemmax[list]=(ctx->nitemmax[list]) ? 2*ctx->nitemmax[list] : 4;
+    if ((item=(int *)realloc(ctx->item[list],(size_t)(ctx->nitemmax[list]*
+					      TF_NFIELD*sizeof(int))))==NULL) {
+      nferrormsg("UVES_tmpladd(): Cannot allocate memory for items\n\
+\tof list '%s'",tmpllist[list]); return 0;
+    }
+    ctx->item[list]=item;
+  }
+  item=ctx->item[list]+TF_NFIELD*(ctx->nitem[list]++);
+  for (i=0; i<TF_NFIELD; i++) item[i]=-1;
+
+  return 1;
+
+}
+
+int UVES_tmplitem(tmplctx *ctx, int list, int field, char *fmt, ...) {
+
+  int      off=0;
+  va_list  ap;
+
+  va_start(ap,fmt); off=UVES_tmplfmt(ctx,fmt,ap); va_end(ap);
+  if (off<0) {
+    nferrormsg("UVES_tmplitem(): Cannot set value of field '%s'\n\
+\tin list '%s'",tmplfield[field],tmpllist[list]); return 0;
+  }
+  ctx->item[list][TF_NFIELD*(ctx->nitem[list]-1)+field]=off;
+
+  return 1;
+
+}
+
+/****************************************************************************
+* Render a compiled template into a buffer, appending to what is
+* already there
+****************************************************************************/
+
+/* Append bytes to render buffer */
+static int UVES_tmplcat(tmplbuf *buf, char *str, long len) {
+
+  char     *tmpbuf=NULL;
+
+  if (buf->n+len>buf->nmax) {
+    buf->nmax=(buf->nmax) ? 2*buf->nmax : VVVLNGSTRLEN;
+    while (buf->n+len>buf->nmax) buf->nmax*=2;
+    if ((tmpbuf=(char *)realloc(buf->buf,(size_t)buf->nmax))==NULL) {
+      nferrormsg("UVES_tmplcat(): Cannot allocate memory for render buffer");
+      return 0;
+    }
+    buf->buf=tmpbuf;
+  }
+  memcpy(buf->buf+buf->n,str,(size_t)len); buf->n+=len;
+
+  return 1;
+
+}
+
+/* Render operations i0 to i1-1 with field values val */
+static int UVES_tmplrun(tmpl *tp, tmplctx *ctx, tmplbuf *buf, int i0, int i1,
+			int *val) {
+
+  int      i=0,j=0,k=0,set=0;
+  int      ival[TF_NFIELD];
+  int      *item=NULL;
+  char     *v=NULL;
+  tmplop   *op=NULL;
+
+  for (i=i0; i<i1; i++) {
+    op=&(tp->op[i]);
+    switch (op->type) {
+    case TO_LIT:
+      if (!UVES_tmplcat(buf,tp->text+op->off,op->len)) return 0;
+      break;
+    case TO_FIELD:
+      if (val[op->arg]>=0) {
+	v=ctx->arena+val[op->arg];
+	if (!UVES_tmplcat(buf,v,strlen(v))) return 0;
+      }
+      break;
+    case TO_IF: case TO_NOT:
+      v=(val[op->arg]>=0) ? ctx->arena+val[op->arg] : NULL;
+      set=(v!=NULL && *v && strcmp(v,"0"));
+      if ((op->type==TO_IF)==set) {
+	if (!UVES_tmplrun(tp,ctx,buf,i+1,op->end,val)) return 0;
+      }
+      i=op->end;
+      break;
+    case TO_EACH:
+      for (j=0; j<ctx->nitem[op->arg]; j++) {
+	item=ctx->item[op->arg]+TF_NFIELD*j;
+	for (k=0; k<TF_NFIELD; k++) ival[k]=(item[k]>=0) ? item[k] : val[k];
+	if (!UVES_tmplrun(tp,ctx,buf,i+1,op->end,ival)) return 0;
+      }
+      i=op->end;
+      break;
+    }
+  }
+
+  return 1;
+
+}
+
+int UVES_tmplrend(tmpl *tp, tmplctx *ctx, tmplbuf *buf) {
+
+  if (!UVES_tmplrun(tp,ctx,buf,0,tp->nop,ctx->val)) {
+    nferrormsg("UVES_tmplrend(): Cannot render template %s",tp->name);
+    return 0;
+  }
+
+  return 1;
+
+}
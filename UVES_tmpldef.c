@@ -0,0 +1,251 @@
+/****************************************************************************
+* Built-in templates for the reduction scripts and Makefiles written by
+* UVES_wredscr(). Any of these may be overridden by a file <name>.tmpl
+* in the directory given by the -tmpldir option. See UVES_tmpl.c for the
+* template syntax.
+****************************************************************************/
+
+#include <stdlib.h>
+#include "UVES_headsort.h"
+
+/* MIDAS reduction preparation script */
+static char tmpl_reduce_prep_prg[]="\
+!!! {{file}}: MIDAS Reduction Preparation by {{prog}}\n\
+!!! Block 00\n\
+$ln -s {{thar}} thargood.fits\n\
+$ln -s {{atmo}} atmoexan.fits\n\
+$ln -s {{flst}} flxstd.fits\n\
+indisk/fits thargood.fits thar.tbl\n\
+!!! Block 01\n\
+create/icat images.cat *.fits\n\
+split/uves images.cat\n\
+";
+
+/* CPL reduction preparation script */
+static char tmpl_reduce_prep_cpl[]="\
+# {{file}}: CPL Reduction Preparation by {{prog}}\n\
+ln -s {{thar}} thargood.fits\n\
+ln -s {{atmo}} atmoexan.fits\n\
+ln -s {{flst}} flxstd.fits\n\
+";
+
+/* MIDAS reduction master script */
+static char tmpl_reduce_master_prg[]="\
+!!! {{file}}: MIDAS Reduction Master by {{prog}}\n\
+@@ reduce_prep.prg\n\
+{{*sci}}\n\
+@@ reduce_{{cwl}}_{{ind}}.prg\n\
+{{/sci}}\n\
+";
+
+/* CPL reduction master script */
+static char tmpl_reduce_master_cpl[]="\
+# {{file}}: MIDAS Reduction Master by {{prog}}\n\
+source reduce_prep.cpl\n\
+{{*sci}}\n\
+source reduce_{{cwl}}_{{ind}}.cpl\n\
+{{/sci}}\n\
+";
+
+/* Makefile with script-like commands for object directory */
+static char tmpl_makefile[]="\
+redun:\n\
+\t/bin/rm -f gnuplot* reduce_*_*_*.sof *_blue* *_red[lu]*\n\
+\t/bin/rm -f *~ *.bdf *.tbl *.tfits *.cat *.ascii *.fmt *.KEY *.plt *.lst \
+disp_res*.dat *free*.dat resolution*.dat middummclear.prg dat.dat\n\
+\n\
+clean:\n\
+\t/bin/rm -f gnuplot* reduce_*_*_*.sof *_blue* *_red[lu]*\n\
+\t/bin/rm -f *~ *.bdf *.tbl *.tfits *.cat *.ascii *.fmt *.KEY *.plt *.lst \
+disp_res*.dat *free*.dat resolution*.dat middummclear.prg dat.dat\n\
+\t/bin/rm -f atmoexan.fits thargood.fits flxstd.fits\n\
+\t/bin/rm -f *.ps *fxb*.fits err*.fits thar*sci*.fits thar*sky*.fits \
+wpol*.fits `ls *.dat | grep -v \"info_\"`\n\
+\n\
+tardir:\n\
+\tgtar -zcf ../{{obj}}.tar.gz ../{{obj}}/*.fits ../{{obj}}/wavres_*.dat \
+../{{obj}}/info_*.dat ../{{obj}}/phmod_*.ps ../{{obj}}/resol_*.ps \
+../{{obj}}/reduce_*.prg ../{{obj}}/reduce_*.cpl ../{{obj}}/reduce_*.sof \
+../{{obj}}/esorex_*.log ../{{obj}}/Makefile\n\
+";
+
+/* MIDAS reduction script for a single exposure */
+static char tmpl_reduce_prg[]="\
+!!! {{file}}: MIDAS Reduction Script by {{prog}}\n\
+{{#missing}}\n\
+!!! Cannot write script: No {{missing}} frames found\n\
+{{/missing}}\n\
+{{^missing}}\n\
+{{#nostdreq}}\n\
+!!! Not including STANDARDS on request\n\
+{{/nostdreq}}\n\
+{{#nostd}}\n\
+!!! No STD frames found.\n\
+{{/nostd}}\n\
+!!! Block 00\n\
+{{*chip}}\n\
+create/icat bias{{ci}}{{arm}}.cat bias_cal{{ci}}*_{{arm}}.bdf\n\
+create/icat flat{{ci}}{{arm}}.cat flat_cal{{ci}}*_{{arm}}.bdf\n\
+create/icat thar{{ci}}{{arm}}.cat thar_wav{{ci}}01_{{arm}}.bdf\n\
+create/icat sci{{ci}}{{arm}}.cat {{obj}}_sci{{ci}}{{arm}}.bdf\n\
+{{#dostd}}\n\
+add/icat sci{{ci}}{{arm}}.cat {{std}}_std{{ci}}01_{{arm}}.bdf\n\
+{{/dostd}}\n\
+{{/chip}}\n\
+!!! Block 01\n\
+{{*chip}}\n\
+set/echelle NBORDI={{nord}}\n\
+orderp/uves thar_ord{{ci}}01_{{arm}}.bdf ord{{ci}}{{arm}}.cat\n\
+pred/uves thar_fmt{{ci}}01_{{arm}}.bdf thar.tbl pred{{ci}}{{arm}}.cat 40,40 \
+0,0 ?\n\
+master/uves bias{{ci}}{{arm}}.cat mbias{{ci}}{{arm}}.cat\n\
+{{/chip}}\n\
+set/echelle NBORDI=0\n\
+!!! Block 02\n\
+{{*chip}}\n\
+create/icat ref{{ci}}{{arm}}.cat d{{cwl}}{{Arm}}{{bin}}.tbl ESO.PRO.CATG\n\
+add/icat ref{{ci}}{{arm}}.cat o{{cwl}}{{Arm}}{{bin}}.tbl\n\
+add/icat ref{{ci}}{{arm}}.cat b{{cwl}}{{Arm}}{{bin}}.tbl\n\
+add/icat ref{{ci}}{{arm}}.cat l{{cwl}}{{lref}}.tbl\n\
+add/icat ref{{ci}}{{arm}}.cat thar.tbl\n\
+add/icat ref{{ci}}{{arm}}.cat mbias{{ci}}{{arm}}.cat\n\
+{{/chip}}\n\
+!!! Block 03\n\
+{{*chip}}\n\
+write/descr d{{cwl}}{{Arm}}{{bin}}.tbl TOL {{tol}}\n\
+wavec/uves thar{{ci}}{{arm}}.cat wav{{ci}}{{arm}}.cat ref{{ci}}{{arm}}.cat \
+auto\n\
+add/icat ref{{ci}}{{arm}}.cat l{{cwl}}{{Arm}}{{bin}}_*.tbl\n\
+{{/chip}}\n\
+!!! Block 04\n\
+{{*chip}}\n\
+master/uves flat{{ci}}{{arm}}.cat + ref{{ci}}{{arm}}.cat bmeasure=median\n\
+add/icat ref{{ci}}{{arm}}.cat mf{{cwl}}_{{bin}}_{{swid}}_{{arm}}.bdf\n\
+{{/chip}}\n\
+!!! Block 05\n\
+{{*chip}}\n\
+reduce/uves sci{{ci}}{{arm}}.cat {{redu}}{{ci}}{{arm}}.cat \
+ref{{ci}}{{arm}}.cat e o median\n\
+{{/chip}}\n\
+!!! Block 06\n\
+{{*chip}}\n\
+outdisk/fits wfxb_{{obj}}_sci{{ci}}{{arm}}.bdf \
+wfxb_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+outdisk/fits errw{{obj}}_sci{{ci}}{{arm}}.bdf \
+errw{{obj}}_sci{{ci}}{{arm}}.fits\n\
+outdisk/fits fxb_{{obj}}_sci{{ci}}{{arm}}.bdf \
+fxb_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+outdisk/fits err_{{obj}}_sci{{ci}}{{arm}}.bdf \
+err_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+outdisk/fits x2_thar_wav{{ci}}01_{{arm}}.bdf \
+thar_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+outdisk/fits l{{cwl}}{{Arm}}{{bin}}_2.tbl \
+wpol_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+{{/chip}}\n\
+{{#dostd}}\n\
+{{*chip}}\n\
+outdisk/fits wfxb_{{std}}_std{{ci}}{{arm}}.bdf \
+wfxb_{{std}}_std{{ci}}{{arm}}.fits\n\
+outdisk/fits errw{{std}}_std{{ci}}{{arm}}.bdf \
+errw{{std}}_std{{ci}}{{arm}}.fits\n\
+outdisk/fits fxb_{{std}}_std{{ci}}{{arm}}.bdf \
+fxb_{{std}}_std{{ci}}{{arm}}.fits\n\
+outdisk/fits err_{{std}}_std{{ci}}{{arm}}.bdf \
+err_{{std}}_std{{ci}}{{arm}}.fits\n\
+{{/chip}}\n\
+{{/dostd}}\n\
+{{*chip}}\n\
+$mv -f pm_{{cwl}}_{{ccd}}.ps phmod{{ci}}{{arm}}.ps\n\
+{{/chip}}\n\
+{{*chip}}\n\
+$mv -f resol_l{{cwl}}{{Arm}}{{bin}}_2.tbl.ps resol{{ci}}{{arm}}.ps\n\
+{{/chip}}\n\
+{{*chip}}\n\
+$mv -f disp_res_l{{cwl}}{{Arm}}{{bin}}_2.tbl.dat wavres{{ci}}{{arm}}.dat\n\
+{{/chip}}\n\
+{{/missing}}\n\
+";
+
+/* CPL reduction script for a single exposure */
+static char tmpl_reduce_cpl[]="\
+# {{file}}: CPL Reduction Script by {{prog}}\n\
+{{#missing}}\n\
+# Cannot write script: No {{missing}} frames found\n\
+{{/missing}}\n\
+{{^missing}}\n\
+{{#nostdreq}}\n\
+# Not including STANDARDS on request\n\
+{{/nostdreq}}\n\
+{{#nostd}}\n\
+# No STD frames found.\n\
+{{/nostd}}\n\
+{{^sof}}\n\
+uves_makesof.csh {{cia}}\n\
+{{/sof}}\n\
+{{#sof}}\n\
+UVES_makesof {{cia}}\n\
+{{/sof}}\n\
+{{*chip}}\n\
+uves_itphmod.csh {{cia}}{{chiparg}}\n\
+#esorex uves_cal_predict {{pcopt}}--plotter='cat > gnuplot{{ci}}$$.gp' \
+--mbox_x=40 --mbox_y=40 --trans_x=0.0 --trans_y=0.0 reduce{{ci}}pred.sof\n\
+uves_filtplot.py {{cia}} -x -p phmod{{ci}}{{arm}}.ps XDIF YDIF XMOD YMOD\n\
+{{/chip}}\n\
+{{*chip}}\n\
+esorex uves_cal_orderpos {{pcopt}}reduce{{ci}}ord.sof\n\
+{{/chip}}\n\
+esorex uves_cal_mbias reduce{{ci}}bias.sof\n\
+esorex uves_cal_mflat reduce{{ci}}flat.sof\n\
+{{*chip}}\n\
+esorex uves_cal_wavecal {{pcopt}}--degree={{deg}} --tolerance={{tolc}} \
+--minlines={{minl}} --maxlines={{maxl}} reduce{{ci}}wav1.sof\n\
+{{/chip}}\n\
+{{#dostd}}\n\
+esorex uves_cal_response reduce{{ci}}std.sof\n\
+{{/dostd}}\n\
+esorex uves_obs_scired --debug reduce{{ci}}sci.sof\n\
+{{*chip}}\n\
+uves_itwavres.csh {{cia}} {{tolw}} {{deg}}{{chiparg}} nlines {{minl}} \
+{{maxl}}\n\
+#esorex uves_cal_wavecal --debug {{pcopt}}--extract.method=weighted \
+--plotter='cat > gnuplot{{ci}}$$.gp' --degree={{deg}} --tolerance={{tolw}} \
+--minlines={{minl}} --maxlines={{maxl}} reduce{{ci}}wav2.sof\n\
+UVES_wavres linetable_{{chip}}.fits > wavres{{ci}}{{arm}}.dat\n\
+uves_filtplot.py {{cia}} -x -p resol{{ci}}{{arm}}.ps WaveC Resol X Ynew\n\
+{{/chip}}\n\
+esorex uves_obs_scired --debug reduce{{ci}}sci.sof\n\
+uves_copyhead.csh {{cia}}\n\
+{{*chip}}\n\
+/bin/mv -f wfxb_{{chip}}.fits wfxb_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+/bin/mv -f errwfxb_{{chip}}.fits errw{{obj}}_sci{{ci}}{{arm}}.fits\n\
+/bin/mv -f fxb_{{chip}}.fits fxb_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+/bin/mv -f errfxb_{{chip}}.fits err_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+/bin/mv -f spectrum_{{chip}}_0_2.fits thar_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+/bin/mv -f spectrum_noise_{{chip}}_0_2.fits \
+errthar_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+/bin/mv -f linetable_{{chip}}.fits wpol_{{obj}}_sci{{ci}}{{arm}}.fits\n\
+{{/chip}}\n\
+/bin/mv -f esorex.log esorex_{{cia}}.log\n\
+{{#dostd}}\n\
+# WARNING: {{prog}} has not yet been updated to copy the pipeline\n\
+#   products for standard stars to files with standardized names. Please\n\
+#   contact the author if you require a certain naming convention \
+here.{{/dostd}}/bin/rm -f reduce{{ci}}*.sof {{rmglob}}\n\
+{{/missing}}\n\
+";
+
+char *UVES_tmpldef(int type, char **name) {
+
+  static char *tmplname[TT_NTMPL]={"reduce_prep.prg","reduce_prep.cpl",
+    "reduce_master.prg","reduce_master.cpl","Makefile","reduce.prg",
+    "reduce.cpl"};
+  static char *tmpltext[TT_NTMPL]={tmpl_reduce_prep_prg,tmpl_reduce_prep_cpl,
+    tmpl_reduce_master_prg,tmpl_reduce_master_cpl,tmpl_makefile,
+    tmpl_reduce_prg,tmpl_reduce_cpl};
+
+  if (type<0 || type>=TT_NTMPL) return NULL;
+  *name=tmplname[type];
+
+  return tmpltext[type];
+
+}
@@ -0,0 +1,64 @@
+/****************************************************************************
+* Calculate the average number of lines used in the polynomial
+* solution and the resulting RMS when the residuals are restricted to
+* lie within a given tolerance. This is the original, one tolerance at
+* a time, calculation which UVES_tolsweep() replaces. It is kept as the
+* reference implementation for UVES_wrbench.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+#include "UVES_wrbench.h"
+#include "memory.h"
+#include "error.h"
+
+int UVES_tolstat(tharset *ts, double tol, double *nav, double *rms) {
+
+  int     *sts=NULL;
+  int     n=0;
+  int     i=0;
+  statset stat;
+
+  /* Make sure input tolerance is sensible */
+  if (tol<=0.0) {
+    nferrormsg("UVES_tolstat(): Tolerance value entered (=%lf)\n\
+is invalid",tol); return 0;
+  }
+
+  /* Allocate a new status array for those lines with the right residuals */
+  if ((sts=iarray(ts->n))==NULL) {
+    nferrormsg("UVES_tolstat(): Cannot allocate memory for sts\n\
+\tarray of length %d",ts->n); return 0;
+  }
+  
+  /* Fill new status array */
+  for (i=0,n=0; i<ts->n; i++) {
+    sts[i]=0;
+    if (ts->stp[i] && fabs(ts->wlf[i]-ts->wlc[i])/ts->dis[i]<=tol) {
+      sts[i]=1; n++;
+    }
+  }
+
+  /* If no lines are found then exit */
+  if (n==0) {
+    free(sts);
+    nferrormsg("UVES_tolstat(): No lines can be found with residuals\n\
+\tless than or equal to tolerance entered (=%lf)",tol); return 0;
+  }
+
+  /* Calculate statistics */
+  if (!UVES_wbstats(ts->res,NULL,NULL,NULL,sts,ts->n,0,&stat)) {
+    free(sts); nferrormsg("UVES_tolstat(): Error returned from UVES_wbstats()");
+    return 0;
+  }
+
+  /* Set results values */
+  *nav=(double)n/(double)ts->no;
+  *rms=stat.rms;
+
+  /* Clean up */
+  free(sts);
+
+  return 1;
+
+}
@@ -0,0 +1,68 @@
+/****************************************************************************
+* Calculate the average number of lines used in the polynomial
+* solution and the resulting RMS when the residuals are restricted to
+* lie within each of a set of increasing tolerances. The lines are
+* sorted once by their residual in pixels and running sums of the
+* velocity residuals and their squares then give the statistics for
+* all tolerances in a single pass.
+****************************************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+#include "UVES_wavres.h"
+#include "sort.h"
+#include "error.h"
+
+int UVES_tolsweep(tharset *ts, double *tol, int ntol, double *nav,
+		  double *rms) {
+
+  double   sum=0.0,sumsq=0.0,ref=0.0,var=0.0,dummy=0.0;
+  int      m=0;
+  int      i=0,j=0;
+  twodble  *line=NULL;
+
+  /* Make sure input tolerances are sensible */
+  if (tol[0]<=0.0) {
+    nferrormsg("UVES_tolsweep(): Tolerance value entered (=%lf)\n\
+is invalid",tol[0]); return 0;
+  }
+
+  /* Collect residual in pixels (a) and in velocity (b) for each line
+     used in the polynomial solution */
+  if ((line=(twodble *)malloc((size_t)((ts->n+1)*sizeof(twodble))))==NULL) {
+    nferrormsg("UVES_tolsweep(): Cannot allocate memory for line\n\
+\tarray of length %d",ts->n); return 0;
+  }
+  for (i=0,m=0; i<ts->n; i++) {
+    if (ts->stp[i]) {
+      line[m].a=fabs(ts->wlf[i]-ts->wlc[i])/ts->dis[i]; line[m].b=ts->res[i];
+      ref+=line[m++].b;
+    }
+  }
+  /* Sums are taken relative to the mean of all used lines to avoid
+     loss of precision */
+  if (m) ref/=(double)m;
+  qsort(line,m,sizeof(twodble),qsort_twodarray);
+
+  /* Accumulate lines up to each tolerance in turn */
+  for (i=0,j=0; i<ntol; i++) {
+    while (j<m && line[j].a<=tol[i]) {
+      dummy=line[j++].b-ref; sum+=dummy; sumsq+=dummy*dummy;
+    }
+    /* If no lines are found then exit */
+    if (j==0) {
+      free(line);
+      nferrormsg("UVES_tolsweep(): No lines can be found with residuals\n\
+\tless than or equal to tolerance entered (=%lf)",tol[i]); return 0;
+    }
+    nav[i]=(double)j/(double)ts->no;
+    var=(j>1) ? (sumsq-sum*sum/(double)j)/(double)(j-1) : 0.0;
+    rms[i]=(var>0.0) ? sqrt(var) : 0.0;
+  }
+
+  /* Clean up */
+  free(line);
+
+  return 1;
+
+}
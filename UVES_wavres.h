@@ -0,0 +1,101 @@
+/***************************************************************************
+* Definitions, structures and function prototypes for UVES_WAVRES
+***************************************************************************/
+
+/* INCLUDE FILES */
+#include <stdio.h>
+#include <fitsio.h>
+#include <longnam.h>
+#include "charstr.h"
+
+/* DEFINITIONS */
+#define VERB 2
+#define TOLM 0
+#define TOLMIN  0.010   /* Minimum tolerance considered in tolerance-finding */
+#define TOLSTEP 0.005   /* Tolerance step between iterations                 */
+#define PREDNFAC 1.2    /* Line margin required for a confident prediction   */
+#define NTHCOL  12      /* Number of columns read from ThAr line table       */
+#define THSCHIP 1       /* Default chip of synthetic line tables             */
+#define THSNL   60      /* Default lines per order used in synthetic tables  */
+#define THSTOL  0.080   /* Default tolerance of synthetic line tables [pix]  */
+#define THSSEED 1       /* Default seed for synthetic line tables            */
+#define THSNREJ 6       /* Selected lines per order outside tolerance        */
+#define THSNUNS 4       /* Lines per order which are not selected            */
+#define THSNPIX 4096    /* Number of pixels along an order (unbinned)        */
+#define THSNCOL 26      /* Number of columns in CPL line tables              */
+#define INCLOSE status=0; fits_close_file(infits,&status);
+#define FREETS(TS) free((TS).blk); (TS).blk=NULL;
+#define FREETOL free(tol); free(nav); free(rms);
+#define TOLMOUT(FP,TS,ERR,TOL) fprintf(FP,"%.0lf %1d %1d %6.3lf %4d %6.2lf %9.4lf \
+%9.4lf %1d %6.3lf\n",(TS).cwl,(TS).binx,(TS).biny,(TS).tol,(TS).np,\
+(double)(TS).np/(double)(TS).no,(TS).mrmso,(TS).mrms,ERR,TOL);
+
+/* STRUCTURES */
+typedef struct ThArSet {
+  double cwl;           /* Nominal central wavelength of setting */
+  double mrms;          /* Mean RMS residual */
+  double mrmso;         /* Mean RMS residual per order */
+  double tol;           /* Tolerance parameter used in CPL reduction */
+  double *x;            /* Fitted pixel position */
+  double *h;            /* Fitted line height above continuum */
+  double *c;            /* Fitted continuum height */
+  double *s;            /* Fitted continuum slope */
+  double *w;            /* Fitted FWHM width of line [A] */
+  double *dis;          /* Dispersion [A/pix] */
+  double *wlf;          /* Wavelength from fit [A] */
+  double *wlc;          /* Wavelength from catalogue [A] */
+  double *res;          /* Residuals: wlf-wlc/wlc [m/s] */
+  double *o_rms;        /* RMS residuals in each order [m/s] */
+  int    chip;          /* Which CCD chip was used?: 0=blue; 1=redl; 2=redu */
+  int    deg;           /* Wavelength polynomial degree used in CPL reduction */
+  int    binx;          /* CCD Binning in spectral direction */
+  int    biny;          /* CCD Binning in spatial direction */
+  int    n;             /* Number of lines in set */
+  int    ns;            /* Number of lines selected */
+  int    np;            /* Number of lines used in polynomial solution */
+  int    no;            /* Number of orders processed */
+  int    nop;           /* Number of orders with lines used in polynomial solution */
+  int    o_ids;         /* Starting diffraction order */
+  int    o_ide;         /* Ending diffraction order */
+  int    o_slp;         /* Slope of diffraction order change with increasing index */
+  int    *ora;          /* Absolute order number */
+  int    *orr;          /* Relative order number */
+  int    *sts;          /* Status as selected line */
+  int    *stp;          /* Status as line used in polynomial fit */
+  int    *o_id;         /* Diffraction order numbers */
+  int    *o_n;          /* Number of lines in each order */
+  int    *o_np;         /* Number of lines in each order used in polynomial solution */
+  void   *blk;          /* Memory block holding all of the above arrays */
+} tharset;
+
+typedef struct WavResJob {
+  char    file[VLNGSTRLEN]; /* Input FITS file name */
+  char    *buf;         /* Text output for this file */
+  size_t  size;         /* Length of text output */
+  double  ntol;         /* New tolerance from tolerance-finding mode */
+  int     ok;           /* Was file processed successfully? */
+  int     flag;         /* Success flag from tolerance-finding mode */
+  tharset ts;           /* Results (scalar members only after processing) */
+} wrjob;
+
+typedef struct WavResPool {
+  wrjob   *job;         /* Array of jobs, one per input file */
+  int     njob;         /* Number of jobs */
+  int     tolm;         /* Tolerance-finding mode */
+  double  tolgrid;      /* Spacing of tolerance grid */
+  int     verb;         /* Verbosity level */
+  int     batch;        /* Batch mode: one output row per file */
+  int     absord;       /* Group lines by absolute order number? */
+} wrpool;
+
+/* FUNCTION PROTOTYPES */
+int UVES_ordstat(tharset *ts, int absord, char *infile);
+int UVES_rtharset(char *infile, tharset *ts);
+int UVES_tharstat(tharset *ts, int absord, char *infile);
+int UVES_tolparams(tharset *ts, double *nmin, double *RMStarg);
+int UVES_tolfind(tharset *ts, int tolm, double tolgrid, int *flag,
+		 double *ntol);
+int UVES_tolsweep(tharset *ts, double *tol, int ntol, double *nav,
+		  double *rms);
+int UVES_wrproc(wrjob *job, wrpool *pool);
+void UVES_wrwork(void *arg, int k);
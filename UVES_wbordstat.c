@@ -0,0 +1,77 @@
+/****************************************************************************
+* Calculate the number of lines, number of lines used in the polynomial
+* solution, and the RMS residual in each order of a ThAr line set. This
+* is the original calculation which UVES_ordstat() replaces: for each
+* order in turn the line list is searched for the lines in that order
+* and their RMS is found with UVES_wbstats(). Grouping by relative
+* order assumes, as CPL line tables do, that the lines are sorted by
+* relative order. It is kept as the reference implementation for
+* UVES_wrbench and, unlike the original, also groups by absolute order
+* when absord is set.
+****************************************************************************/
+
+#include <stdlib.h>
+#include "UVES_wrbench.h"
+#include "memory.h"
+#include "error.h"
+
+int UVES_wbordstat(tharset *ts, int absord) {
+
+  int      *sts=NULL;
+  int      i=0,j=0,k=0,l=0;
+  statset  stat;
+
+  /* Grouping by absolute order needs its own status array */
+  if (absord && (sts=iarray(ts->n))==NULL) {
+    nferrormsg("UVES_wbordstat(): Cannot allocate memory for sts\n\
+\tarray of length %d",ts->n); return 0;
+  }
+
+  /** Determine results for each order **/
+  for (i=0,ts->nop=0,ts->mrmso=0.0; i<ts->no; i++) {
+    stat.mean=stat.rms=0.0;
+    if (absord) {
+      /* Flag lines used in polynomial solution in this order */
+      l=ts->o_ids+i*ts->o_slp;
+      for (k=0,ts->o_n[i]=ts->o_np[i]=0; k<ts->n; k++) {
+	sts[k]=0;
+	if (ts->ora[k]==l) {
+	  ts->o_n[i]++; if (ts->stp[k]) { sts[k]=1; ts->o_np[i]++; }
+	}
+      }
+      if (ts->o_np[i] &&
+	  !UVES_wbstats(ts->res,NULL,NULL,NULL,sts,ts->n,0,&stat)) {
+	free(sts);
+	nferrormsg("UVES_wbordstat(): Error returned from UVES_wbstats()");
+	return 0;
+      }
+    } else {
+      /* Find first and last lines in this order and determine number
+	 of lines in this order */
+      l=i+1; j=0; while (j<ts->n && ts->orr[j]!=l) j++;
+      if (j!=ts->n) {
+	k=j+1; while (k<ts->n && ts->orr[k]==l) k++;
+	ts->o_n[i]=k-j;
+      } else ts->o_n[i]=0;
+      /* Determine the number of lines in this order used in the
+	 polynomial solution */
+      for (k=0,l=j,ts->o_np[i]=0; k<ts->o_n[i]; k++,l++)
+	if (ts->stp[l]) ts->o_np[i]++;
+      if (ts->o_np[i] &&
+	  !UVES_wbstats(&(ts->res[j]),NULL,NULL,NULL,&(ts->stp[j]),ts->o_n[i],0,
+			&stat)) {
+	nferrormsg("UVES_wbordstat(): Error returned from UVES_wbstats()");
+	return 0;
+      }
+    }
+    if (ts->o_n[i]) ts->nop++;
+    ts->o_rms[i]=stat.rms; ts->mrmso+=ts->o_rms[i];
+  }
+  if (ts->nop) ts->mrmso/=(double)ts->nop;
+
+  /* Clean up */
+  if (sts!=NULL) free(sts);
+
+  return 1;
+
+}
@@ -16,9 +16,10 @@ int UVES_wheadinfo(header *hdrs, int nhdrs, char *outfile) {
   FILE     *out_file;
 
   /* Open output file */
-  if ((out_file=faskwopen("Header info. output file?",outfile,4))==NULL)
-    errormsg("UVES_wheadinfo(): Cannot open header info output\n\
-\tfile %s for writing",outfile);
+  if ((out_file=faskwopen("Header info. output file?",outfile,4))==NULL) {
+    nferrormsg("UVES_wheadinfo(): Cannot open header info output\n\
+\tfile %s for writing",outfile); return 0;
+  }
 
   /* Loop over headers */
   for (i=0; i<nhdrs; i++) {
@@ -26,9 +27,11 @@ int UVES_wheadinfo(header *hdrs, int nhdrs, char *outfile) {
     if (!strncmp(hdrs[i].cwl,"blue",4)) temp=hdrs[i].tb;
     else if (!strncmp(hdrs[i].cwl,"red",3)) temp=hdrs[i].tr;
     else {
-      if (sscanf(hdrs[i].cwl,"%lf",&(cwl))!=1)
-	errormsg("UVES_calsrch(): Incorrect format of central wavelength \n\
-\tof frame\n\t%s",hdrs[i].file); 
+      if (sscanf(hdrs[i].cwl,"%lf",&(cwl))!=1) {
+	fclose(out_file);
+	nferrormsg("UVES_wheadinfo(): Incorrect format of central wavelength \n\
+\tof frame\n\t%s",hdrs[i].file); return 0;
+      }
       if (!hdrs[i].arm) temp=hdrs[i].tb;
       else temp=hdrs[i].tr;
     }
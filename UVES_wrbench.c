@@ -0,0 +1,459 @@
+/****************************************************************************
+
+UVES_wrbench: Time the statistics kernels used by UVES_wavres --
+stats(), median(), medianbuf(), the tolerance sweep and the per-order
+statistics -- on synthetic ThAr line lists, and check their results
+against the original reference implementations.
+
+****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "UVES_wrbench.h"
+#include "memory.h"
+#include "const.h"
+#include "error.h"
+
+/* Global declarations */
+char      *progname;
+
+/****************************************************************************
+* Print the usage message
+****************************************************************************/
+
+void usage(void) {
+
+  fprintf(stderr,"\n%s: Time the statistics kernels used by UVES_wavres\n\
+\tand check them against reference implementations\n",progname);
+
+  fprintf(stderr,"\nUsage: %s [OPTIONS]\n",progname);
+
+  fprintf(stderr, "\nOptions:\n\
+  -h, -help        : Print this message.\n\
+  -reps = %-4d      : Number of timed repetitions of each kernel.\n\
+  -seed = %-4d      : Seed for synthetic line lists and data arrays.\n\
+  -noheader        : Do not print the column header line.\n\
+\nOne line is printed for each kernel and case: kernel name, case\n\
+(option or chip, and tolerance grid for sweeps), number of elements,\n\
+mean and standard deviation over repetitions of the time per element\n\
+[ns], mean time per element for the reference implementation [ns], the\n\
+maximum relative difference between the two sets of results, and \"ok\"\n\
+or \"FAIL\". Elements are data points for stats(), median() and\n\
+medianbuf() and lines for the tolerance sweep and per-order statistics.\n\
+Each repetition calls the kernel enough times to take at least %.0lf ms.\n\
+The exit status is 2, instead of the usual 1, if any kernel fails its\n\
+check.\n\n",
+	  WBREPS,WBSEED,1.e3*WBMINT);
+  exit(3);
+}
+
+/****************************************************************************
+* Wall-clock time [s]
+****************************************************************************/
+
+double UVES_wbtime(void) {
+
+  struct   timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (double)ts.tv_sec+1.e-9*(double)ts.tv_nsec;
+
+}
+
+/****************************************************************************
+* Gaussian deviate with zero mean and unit variance (Box-Muller)
+****************************************************************************/
+
+double UVES_wbgauss(void) {
+
+  double   u=0.0;
+
+  while ((u=drand48())<=0.0);
+  return sqrt(-2.0*log(u))*cos(2.0*M_PI*drand48());
+
+}
+
+/****************************************************************************
+* Relative difference between two results
+****************************************************************************/
+
+double UVES_wbrdiff(double a, double b) {
+
+  double   m=0.0;
+
+  if (a==b) return 0.0;
+  m=(fabs(a)>fabs(b)) ? fabs(a) : fabs(b);
+  return fabs(a-b)/m;
+
+}
+
+/****************************************************************************
+* Maximum relative difference between the statistics calculated by
+* stats() (or median()) for the given option
+****************************************************************************/
+
+double UVES_wbsdiff(statset *a, statset *b, int opt, int med) {
+
+  double   d=0.0,e=0.0;
+
+#define WBSD(X) if ((e=UVES_wbrdiff(a->X,b->X))>d) d=e;
+  if (med) { WBSD(med); WBSD(siqr); return d; }
+  WBSD(mean); WBSD(rms); WBSD(prms); WBSD(nrms); WBSD(emean);
+  if (opt>=1) {
+    WBSD(meansig); WBSD(wmean); WBSD(ewmean); WBSD(rmssig); WBSD(chisq);
+    WBSD(rchisq);
+  }
+  if (opt>=2) { WBSD(med); WBSD(siqr); }
+  if (opt==3) { WBSD(emed); WBSD(esiqr); }
+#undef WBSD
+  return d;
+
+}
+
+/****************************************************************************
+* Make a synthetic ThAr line list for one chip. Lines are sorted by
+* relative order, as in CPL line tables, with per-order line counts,
+* dispersions, residuals and Select/NLinSol flags typical of real
+* wavelength calibrations. An error array for stats() is also filled.
+****************************************************************************/
+
+int UVES_wbsynth(tharset *ts, int chip, double **sig) {
+
+  double   cwl[WBNCHIP]={390.0,520.0,640.0};   /* Chip central wl [nm] */
+  double   lc=0.0,fsr=0.0,dis=0.0,r=0.0;
+  int      o_ids[WBNCHIP]={153,121,91};        /* First (bluest) order */
+  int      no[WBNCHIP]={32,33,26};             /* Number of orders */
+  int      nlo[WBNCHIP]={34,45,50};            /* Mean lines per order */
+  int      nmax=0,nl=0,mid=0;
+  int      i=0,k=0;
+
+  memset(ts,0,sizeof(tharset));
+  ts->chip=chip; ts->cwl=(chip) ? 580.0 : 390.0; ts->tol=WBTOL; ts->deg=4;
+  ts->binx=ts->biny=1; ts->no=no[chip]; ts->o_ids=o_ids[chip]; ts->o_slp=-1;
+  ts->o_ide=ts->o_ids+(ts->no-1)*ts->o_slp;
+  nmax=ts->no*(int)(1.3*(double)nlo[chip]+1.0);
+  if ((ts->x=darray(nmax))==NULL || (ts->dis=darray(nmax))==NULL ||
+      (ts->wlf=darray(nmax))==NULL || (ts->wlc=darray(nmax))==NULL ||
+      (ts->res=darray(nmax))==NULL || (*sig=darray(nmax))==NULL ||
+      (ts->ora=iarray(nmax))==NULL || (ts->orr=iarray(nmax))==NULL ||
+      (ts->sts=iarray(nmax))==NULL || (ts->stp=iarray(nmax))==NULL ||
+      (ts->o_id=iarray(ts->no))==NULL || (ts->o_n=iarray(ts->no))==NULL ||
+      (ts->o_np=iarray(ts->no))==NULL || (ts->o_rms=darray(ts->no))==NULL) {
+    nferrormsg("UVES_wbsynth(): Cannot allocate memory for line arrays\n\
+\tof length %d",nmax); return 0;
+  }
+
+  /* Fill each order in turn. Order m has central wavelength
+     proportional to 1/m and a free spectral range of lc/m, which its
+     pixels cover with some overlap between orders */
+  mid=ts->o_ids+ts->o_slp*ts->no/2;
+  for (k=0,ts->n=0; k<ts->no; k++) {
+    ts->o_id[k]=ts->o_ids+k*ts->o_slp;
+    lc=10.0*cwl[chip]*(double)mid/(double)ts->o_id[k];
+    fsr=lc/(double)ts->o_id[k]; dis=1.3*fsr/(double)WBNPIX;
+    nl=(int)((double)nlo[chip]*(0.7+0.6*drand48()));
+    for (i=0; i<nl; i++,ts->n++) {
+      ts->orr[ts->n]=k+1; ts->ora[ts->n]=ts->o_id[k];
+      ts->x[ts->n]=(double)WBNPIX*drand48(); ts->dis[ts->n]=dis;
+      ts->wlc[ts->n]=lc+dis*(ts->x[ts->n]-0.5*(double)WBNPIX);
+      r=WBRESPIX*UVES_wbgauss(); ts->wlf[ts->n]=ts->wlc[ts->n]+r*dis;
+      ts->sts[ts->n]=(drand48()<WBFSEL);
+      ts->stp[ts->n]=(ts->sts[ts->n] && fabs(r)<=ts->tol && drand48()<WBFPOL);
+      ts->res[ts->n]=(ts->sts[ts->n]) ?
+	C_C*(ts->wlf[ts->n]-ts->wlc[ts->n])/ts->wlc[ts->n] : 0.0;
+      (*sig)[ts->n]=C_C*dis/ts->wlc[ts->n]*WBRESPIX*(0.5+drand48());
+      if (ts->sts[ts->n]) ts->ns++;
+      if (ts->stp[ts->n]) ts->np++;
+    }
+  }
+
+  return 1;
+
+}
+
+/****************************************************************************
+* Free a synthetic ThAr line list
+****************************************************************************/
+
+void UVES_wbfree(tharset *ts) {
+
+  free(ts->x); free(ts->dis); free(ts->wlf); free(ts->wlc); free(ts->res);
+  free(ts->ora); free(ts->orr); free(ts->sts); free(ts->stp); free(ts->o_id);
+  free(ts->o_n); free(ts->o_np); free(ts->o_rms);
+
+}
+
+/****************************************************************************
+* Kernels to be timed, current and reference implementations
+****************************************************************************/
+
+int UVES_wbstatsk(wbarg *arg) {
+  return stats(arg->dat,arg->sig,NULL,NULL,arg->sts,arg->n,arg->opt,
+	       &(arg->stat));
+}
+
+int UVES_wbstatsr(wbarg *arg) {
+  return UVES_wbstats(arg->dat,arg->sig,NULL,NULL,arg->sts,arg->n,arg->opt,
+		      &(arg->stat));
+}
+
+int UVES_wbmediank(wbarg *arg) {
+  return median(arg->dat,arg->sts,arg->n,&(arg->stat),arg->opt);
+}
+
+int UVES_wbmedbufk(wbarg *arg) {
+  return medianbuf(arg->dat,arg->sts,arg->n,arg->buf,&(arg->stat),arg->opt);
+}
+
+int UVES_wbmedianr(wbarg *arg) {
+  return UVES_wbmedian(arg->dat,arg->sts,arg->n,&(arg->stat),arg->opt);
+}
+
+int UVES_wbsweepk(wbarg *arg) {
+  return UVES_tolsweep(arg->ts,arg->tol,arg->ntol,arg->nav,arg->rms);
+}
+
+int UVES_wbsweepr(wbarg *arg) {
+
+  int      i=0;
+
+  for (i=0; i<arg->ntol; i++)
+    if (!UVES_tolstat(arg->ts,arg->tol[i],&(arg->nav[i]),&(arg->rms[i])))
+      return 0;
+  return 1;
+
+}
+
+int UVES_wbordk(wbarg *arg) {
+  return UVES_ordstat(arg->ts,arg->absord,"synthetic line list");
+}
+
+int UVES_wbordr(wbarg *arg) {
+  return UVES_wbordstat(arg->ts,arg->absord);
+}
+
+/****************************************************************************
+* Time a kernel: the number of calls per repetition is doubled until
+* one repetition takes at least WBMINT, then the mean and standard
+* deviation of the time per element [ns] over nrep repetitions are
+* returned
+****************************************************************************/
+
+int UVES_wbrun(int (*kern)(wbarg *), wbarg *arg, int nelem, int nrep,
+	       double *mean, double *sd) {
+
+  double   t=0.0,x=0.0,delta=0.0,m2=0.0;
+  int      niter=0;
+  int      i=0,j=0;
+
+  /* Calibrate number of calls per repetition, which also warms up
+     caches and branch predictors */
+  for (niter=1; ; niter*=2) {
+    t=UVES_wbtime();
+    for (i=0; i<niter; i++) if (!kern(arg)) return 0;
+    if (UVES_wbtime()-t>=WBMINT || niter>=(1<<30)) break;
+  }
+
+  /* Timed repetitions, with Welford's streaming mean and variance */
+  for (j=0,*mean=0.0; j<nrep; j++) {
+    t=UVES_wbtime();
+    for (i=0; i<niter; i++) if (!kern(arg)) return 0;
+    x=1.e9*(UVES_wbtime()-t)/(double)niter/(double)nelem;
+    delta=x-*mean; *mean+=delta/(double)(j+1); m2+=delta*(x-*mean);
+  }
+  *sd=(nrep>1) ? sqrt(m2/(double)(nrep-1)) : 0.0;
+
+  return 1;
+
+}
+
+/****************************************************************************
+* Print results for one kernel and case, returning 1 if the check
+* passed
+****************************************************************************/
+
+int UVES_wbrep(char *kernel, char *wbcase, int n, double mean, double sd,
+	       double ref, double diff) {
+
+  int      ok=0;
+
+  ok=(diff<=WBRTOL);
+  fprintf(stdout,"%-9s %-12s %7d %10.2lf %9.2lf %10.2lf %9.2le %s\n",kernel,
+	  wbcase,n,mean,sd,ref,diff,(ok) ? "ok" : "FAIL");
+  fflush(stdout);
+  return ok;
+
+}
+
+/****************************************************************************
+* The main program
+
+  Things to do:
+
+****************************************************************************/
+
+int main(int argc, char *argv[]) {
+
+  double   grid[WBNGRID]=WBGRID;
+  double   mean=0.0,sd=0.0,ref=0.0,diff=0.0,d=0.0;
+  double   *sig[WBNCHIP],*mdat=NULL,*tol=NULL,*nav=NULL,*rms=NULL;
+  double   *nav_r=NULL,*rms_r=NULL,*o_rms=NULL;
+  double   mrmso=0.0;
+  int      medn[WBNMED]=WBMEDN;
+  int      nrep=WBREPS,seed=WBSEED,nohead=0,nfail=0,ntol=0,nop=0;
+  int      *msts=NULL,*o_n=NULL,*o_np=NULL;
+  int      i=0,j=0,k=0,l=0;
+  char     *chipname[WBNCHIP]={"blue","redl","redu"};
+  char     wbcase[NAMELEN]="\0";
+  tharset  ts[WBNCHIP];
+  statset  stat;
+  wbarg    arg;
+
+  /* Define the program name from the command line input */
+  progname=((progname=strrchr(argv[0],'/'))==NULL) ? argv[0] : progname+1;
+  /* Scan command line for options */
+  while (++i<argc) {
+    if (!strcmp(argv[i],"-reps")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&nrep)!=1 || nrep<1) usage();
+    }
+    else if (!strcmp(argv[i],"-seed")) {
+      if (++i>=argc || sscanf(argv[i],"%d",&seed)!=1) usage();
+    }
+    else if (!strcmp(argv[i],"-noheader")) nohead=1;
+    else if (!strcmp(argv[i],"-help") || !strcmp(argv[i],"-h")) usage();
+    else usage();
+  }
+
+  /* Make synthetic line lists */
+  srand48((long)seed);
+  for (k=0; k<WBNCHIP; k++)
+    if (!UVES_wbsynth(&(ts[k]),k,&(sig[k])))
+      errormsg("Unknown error returned from UVES_wbsynth()");
+  if (!nohead)
+    fprintf(stdout,"#kernel  case               n    ns/elem        sd \
+ref_ns/elem   maxdiff check\n");
+  memset(&arg,0,sizeof(wbarg));
+
+  /* stats(): each option on each line list, with the lines used in
+     the polynomial solution as valid points */
+  for (k=0; k<WBNCHIP; k++) {
+    arg.dat=ts[k].res; arg.sig=sig[k]; arg.sts=ts[k].stp; arg.n=ts[k].n;
+    for (j=0; j<=3; j++) {
+      arg.opt=j; sprintf(wbcase,"opt%d/%s",j,chipname[k]);
+      if (!UVES_wbrun(UVES_wbstatsr,&arg,arg.n,nrep,&ref,&sd))
+	errormsg("Error returned from UVES_wbstats()");
+      stat=arg.stat;
+      if (!UVES_wbrun(UVES_wbstatsk,&arg,arg.n,nrep,&mean,&sd))
+	errormsg("Error returned from stats()");
+      diff=UVES_wbsdiff(&(arg.stat),&stat,j,0);
+      if (!UVES_wbrep("stats",wbcase,arg.n,mean,sd,ref,diff)) nfail++;
+    }
+  }
+
+  /* median() and medianbuf(): Gaussian data with some points masked,
+     at various sizes. Timings are for opt=0; all options are checked.
+     medianbuf() uses a buffer allocated once, as in a loop */
+  if ((mdat=darray(medn[WBNMED-1]))==NULL || (msts=iarray(medn[WBNMED-1]))==NULL
+      || (arg.buf=darray(medn[WBNMED-1]))==NULL)
+    errormsg("Cannot allocate memory for median arrays of length %d",
+	     medn[WBNMED-1]);
+  for (i=0; i<medn[WBNMED-1]; i++) {
+    mdat[i]=UVES_wbgauss(); msts[i]=(drand48()>=WBFMASK);
+  }
+  arg.dat=mdat; arg.sts=msts; arg.sig=NULL;
+  for (l=0; l<WBNMED; l++) {
+    arg.n=medn[l]; sprintf(wbcase,"opt0");
+    for (j=2,diff=0.0; j>=0; j--) {
+      arg.opt=j;
+      if (!UVES_wbmedianr(&arg)) errormsg("Error returned from UVES_wbmedian()");
+      stat=arg.stat;
+      if (!UVES_wbmediank(&arg)) errormsg("Error returned from median()");
+      if ((d=UVES_wbsdiff(&(arg.stat),&stat,j,1))>diff) diff=d;
+    }
+    if (!UVES_wbrun(UVES_wbmedianr,&arg,arg.n,nrep,&ref,&sd))
+      errormsg("Error returned from UVES_wbmedian()");
+    if (!UVES_wbrun(UVES_wbmediank,&arg,arg.n,nrep,&mean,&sd))
+      errormsg("Error returned from median()");
+    if (!UVES_wbrep("median",wbcase,arg.n,mean,sd,ref,diff)) nfail++;
+    for (j=2,diff=0.0; j>=0; j--) {
+      arg.opt=j;
+      if (!UVES_wbmedianr(&arg)) errormsg("Error returned from UVES_wbmedian()");
+      stat=arg.stat;
+      if (!UVES_wbmedbufk(&arg)) errormsg("Error returned from medianbuf()");
+      if ((d=UVES_wbsdiff(&(arg.stat),&stat,j,1))>diff) diff=d;
+    }
+    if (!UVES_wbrun(UVES_wbmedbufk,&arg,arg.n,nrep,&mean,&sd))
+      errormsg("Error returned from medianbuf()");
+    if (!UVES_wbrep("medianbuf",wbcase,arg.n,mean,sd,ref,diff)) nfail++;
+  }
+
+  /* Tolerance sweep: UVES_tolsweep() against UVES_tolstat() at each
+     tolerance, on the grids used by UVES_wavres in tolerance-finding
+     mode */
+  for (l=0; l<WBNGRID; l++) {
+    ntol=(int)((WBTOL-TOLMIN)/grid[l])+1;
+    if ((tol=darray(ntol))==NULL || (nav=darray(ntol))==NULL ||
+	(rms=darray(ntol))==NULL || (nav_r=darray(ntol))==NULL ||
+	(rms_r=darray(ntol))==NULL)
+      errormsg("Cannot allocate memory for tolerance arrays of length %d",ntol);
+    for (i=0; i<ntol; i++) tol[i]=TOLMIN+grid[l]*(double)i;
+    arg.tol=tol; arg.ntol=ntol;
+    for (k=0; k<WBNCHIP; k++) {
+      arg.ts=&(ts[k]); sprintf(wbcase,"%s/%.4lf",chipname[k],grid[l]);
+      arg.nav=nav_r; arg.rms=rms_r;
+      if (!UVES_wbrun(UVES_wbsweepr,&arg,ts[k].n,nrep,&ref,&sd))
+	errormsg("Error returned from UVES_tolstat()");
+      arg.nav=nav; arg.rms=rms;
+      if (!UVES_wbrun(UVES_wbsweepk,&arg,ts[k].n,nrep,&mean,&sd))
+	errormsg("Error returned from UVES_tolsweep()");
+      for (i=0,diff=0.0; i<ntol; i++) {
+	if ((d=UVES_wbrdiff(nav[i],nav_r[i]))>diff) diff=d;
+	if ((d=UVES_wbrdiff(rms[i],rms_r[i]))>diff) diff=d;
+      }
+      if (!UVES_wbrep("tolsweep",wbcase,ts[k].n,mean,sd,ref,diff)) nfail++;
+    }
+    free(tol); free(nav); free(rms); free(nav_r); free(rms_r);
+  }
+
+  /* Per-order statistics, grouping by relative and absolute order */
+  for (k=0; k<WBNCHIP; k++) {
+    if ((o_n=iarray(ts[k].no))==NULL || (o_np=iarray(ts[k].no))==NULL ||
+	(o_rms=darray(ts[k].no))==NULL)
+      errormsg("Cannot allocate memory for order arrays of length %d",
+	       ts[k].no);
+    arg.ts=&(ts[k]);
+    for (l=0; l<=1; l++) {
+      arg.absord=l; sprintf(wbcase,"%s/%s",(l) ? "abs" : "rel",chipname[k]);
+      if (!UVES_wbrun(UVES_wbordr,&arg,ts[k].n,nrep,&ref,&sd))
+	errormsg("Error returned from UVES_wbordstat()");
+      for (j=0; j<ts[k].no; j++) {
+	o_n[j]=ts[k].o_n[j]; o_np[j]=ts[k].o_np[j]; o_rms[j]=ts[k].o_rms[j];
+      }
+      nop=ts[k].nop; mrmso=ts[k].mrmso;
+      if (!UVES_wbrun(UVES_wbordk,&arg,ts[k].n,nrep,&mean,&sd))
+	errormsg("Error returned from UVES_ordstat()");
+      diff=(nop!=ts[k].nop) ? 1.0 : UVES_wbrdiff(mrmso,ts[k].mrmso);
+      for (j=0; j<ts[k].no; j++) {
+	if (o_n[j]!=ts[k].o_n[j] || o_np[j]!=ts[k].o_np[j]) diff=1.0;
+	if ((d=UVES_wbrdiff(o_rms[j],ts[k].o_rms[j]))>diff) diff=d;
+      }
+      if (!UVES_wbrep("ordstat",wbcase,ts[k].n,mean,sd,ref,diff)) nfail++;
+    }
+    free(o_n); free(o_np); free(o_rms);
+  }
+
+  /* Clean up */
+  for (k=0; k<WBNCHIP; k++) { UVES_wbfree(&(ts[k])); free(sig[k]); }
+  free(mdat); free(msts); free(arg.buf);
+
+  if (nfail) {
+    nferrormsg("%d kernel(s) disagree with their reference\n\
+\timplementations by more than a relative %.1le",nfail,WBRTOL);
+    return 2;
+  }
+
+  return 1;
+
+}
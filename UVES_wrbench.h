@@ -0,0 +1,49 @@
+/***************************************************************************
+* Definitions, structures and function prototypes for UVES_WRBENCH
+***************************************************************************/
+
+/* INCLUDE FILES */
+#include "UVES_wavres.h"
+#include "stats.h"
+
+/* DEFINITIONS */
+#define WBREPS       15  /* Default number of timed repetitions               */
+#define WBSEED        1  /* Default seed for synthetic line lists            */
+#define WBMINT   2.0e-3  /* Min. time for one timed repetition [s]           */
+#define WBRTOL   1.0e-9  /* Max. relative difference from reference results  */
+#define WBNMED        6  /* Number of array sizes for median() benchmark     */
+#define WBMEDN {3,10,100,1000,10000,100000} /* Array sizes for median()      */
+#define WBFMASK    0.15  /* Fraction of masked points in median() arrays     */
+#define WBNCHIP       3  /* Number of synthetic line lists (one per chip)    */
+#define WBFSEL     0.85  /* Fraction of lines selected (Select)              */
+#define WBFPOL     0.90  /* Fraction of selected lines within tolerance used
+			    in polynomial solution (NLinSol)                 */
+#define WBRESPIX   0.04  /* RMS line position residual [pix]                 */
+#define WBNPIX     4096  /* Number of pixels along an order (unbinned)       */
+#define WBTOL      0.07  /* Tolerance used in polynomial solution [pix]      */
+#define WBNGRID       2  /* Number of tolerance grids for sweep benchmark    */
+#define WBGRID {TOLSTEP,0.0005} /* Tolerance grid spacings [pix]             */
+
+/* STRUCTURES */
+typedef struct WrBenchArg {
+  double   *dat;        /* Data array for stats(), median() and medianbuf() */
+  double   *sig;        /* Error array for stats() */
+  double   *buf;        /* Scratch buffer for medianbuf() */
+  double   *tol;        /* Tolerance grid for sweeps */
+  double   *nav;        /* Average number of lines per order at each tol */
+  double   *rms;        /* RMS residual at each tol */
+  int      *sts;        /* Status array for stats(), median() and medianbuf() */
+  int      n;           /* Number of data points */
+  int      opt;         /* Option passed to stats() or median() */
+  int      ntol;        /* Number of tolerances in sweep */
+  int      absord;      /* Group lines by absolute order number? */
+  tharset  *ts;         /* ThAr line set */
+  statset  stat;        /* Results from stats() and median() */
+} wbarg;
+
+/* FUNCTION PROTOTYPES */
+int UVES_tolstat(tharset *ts, double tol, double *nav, double *rms);
+int UVES_wbmedian(double *dat, int *sts, int ndat, statset *stat, int opt);
+int UVES_wbordstat(tharset *ts, int absord);
+int UVES_wbstats(double *dat, double *sig, double *efl, double *wgt, int *sts,
+		 int ndat, int opt, statset *stat);
@@ -0,0 +1,48 @@
+/****************************************************************************
+DSELECT: Return the k-th smallest value (k=0 being the smallest) of the
+double precision array arr[0..n-1] using quickselect with median-of-three
+partitioning. The array is rearranged on output so that arr[k] holds the
+returned value, all elements arr[0..k-1] are less than or equal to it and
+all elements arr[k+1..n-1] are greater than or equal to it. The caller
+must ensure that k<n.
+****************************************************************************/
+
+#include "sort.h"
+
+#define DSWAP(a,b) { temp=(a); (a)=(b); (b)=temp; }
+
+double dselect(unsigned long k, unsigned long n, double *arr) {
+
+  double        a=0.0,temp=0.0;
+  unsigned long l=0,ir=0,mid=0;
+  register unsigned long i=0,j=0;
+
+  l=0; ir=n-1;
+  for (;;) {
+    if (ir<=l+1) {
+      /* Active partition contains one or two elements */
+      if (ir==l+1 && arr[ir]<arr[l]) DSWAP(arr[l],arr[ir]);
+      return arr[k];
+    }
+    /* Choose median of left, centre and right elements as the
+       partitioning element and arrange that arr[l]<=arr[l+1]<=arr[ir] */
+    mid=(l+ir)>>1;
+    DSWAP(arr[mid],arr[l+1]);
+    if (arr[l]>arr[ir]) DSWAP(arr[l],arr[ir]);
+    if (arr[l+1]>arr[ir]) DSWAP(arr[l+1],arr[ir]);
+    if (arr[l]>arr[l+1]) DSWAP(arr[l],arr[l+1]);
+    /* Partition around the partitioning element */
+    i=l+1; j=ir; a=arr[l+1];
+    for (;;) {
+      do i++; while (arr[i]<a);
+      do j--; while (arr[j]>a);
+      if (j<i) break;
+      DSWAP(arr[i],arr[j]);
+    }
+    arr[l+1]=arr[j]; arr[j]=a;
+    /* Keep the partition which contains the k-th element */
+    if (j>=k) ir=j-1;
+    if (j<=k) l=i;
+  }
+
+}
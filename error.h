@@ -8,9 +8,14 @@ ERROR.H: Include file containing the function prototypes handling errors
 
 /* DEFINITIONS */
 #define MAXNERR 3  /* Maximum number of errors allowed */
+#define NFERRLEN 2048 /* Length of copy of last non-fatal error message */
 
 /* STRUCTURES */
 
+/* GLOBALS */
+extern __thread char nferrlast[NFERRLEN]; /* Last message sent by
+					     nferrormsg() in this thread */
+
 /* Prototypes */
 void    errormsg(char *fmt, ...);
 void    nferrormsg(char *fmt, ...);
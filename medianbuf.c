@@ -0,0 +1,83 @@
+/****************************************************************************
+MEDIANBUF: Function to calculate the median and 68% semi-interquartile
+range of a double array using a scratch buffer provided by the caller
+
+This is the same as median() except that the valid elements of dat are
+copied into buf, which must have at least ndat elements, and the
+required order statistics are found by selection (dselect()) rather
+than by sorting the whole array. No memory is allocated, so this
+should be used when medians are found repeatedly in a loop. buf may be
+the same as dat, in which case dat is rearranged on output. buf is not
+used when ndat<=2 and may then be NULL. See median() for the meaning of
+sts and opt.
+
+****************************************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+#include "sort.h"
+#include "stats.h"
+#include "error.h"
+
+int medianbuf(double *dat, int *sts, int ndat, double *buf, statset *stat,
+	      int opt) {
+
+  double       lo=0.0,hi=0.0;
+  int          snull=0,nval=0,sidx=0;
+  register int i=0;
+
+  /* Determine iff sts was passed as null or not */
+  if (sts==NULL) snull=1;
+
+  /* Return with non-fatal error if number of elements zero */
+  if (ndat==0) {
+    nferrormsg("medianbuf(): Number of data points passed is zero"); return 0;
+  } else if (ndat==1) {
+    stat->med=(snull || sts[0]==1) ? dat[0] : 0.0; stat->siqr=0.0; return 1;
+  }
+  if (ndat==2) {
+    if (snull || (sts[0]==1 && sts[1]==1)) {
+      if (opt==0) stat->med=0.5*(dat[0]+dat[1]);
+      else if (opt==1) stat->med=(dat[0]<dat[1]) ? dat[0] : dat[1];
+      else if (opt==2) stat->med=(dat[0]>dat[1]) ? dat[0] : dat[1];
+      stat->siqr=0.5*fabs(dat[0]-dat[1]); return 1;
+    } else if (sts[0]==1) {
+      stat->med=dat[0]; stat->siqr=0.0; return 1;
+    } else if (sts[1]==1) {
+      stat->med=dat[1]; stat->siqr=0.0; return 1;
+    } else { stat->med=stat->siqr=0.0; return 1; }
+  }
+
+  /* Check scratch buffer */
+  if (buf==NULL) {
+    nferrormsg("medianbuf(): Scratch buffer passed as NULL"); return 0;
+  }
+
+  /* Copy the valid elements into the scratch buffer */
+  for (i=0,nval=0; i<ndat; i++) if (snull || sts[i]==1) buf[nval++]=dat[i];
+  /* Find indices of median value and semi-interquartile range */
+  if (nval) { sidx=nval/2; i=(int)(MED_QR*(double)nval); }
+
+  /* Find the median */
+  if (!nval) stat->med=stat->siqr=0.0;
+  else if (nval==1) { stat->med=buf[0]; stat->siqr=0.0; }
+  else if (nval==2) {
+    if (opt==0) stat->med=0.5*(buf[0]+buf[1]);
+    else if (opt==1) stat->med=(buf[0]<buf[1]) ? buf[0] : buf[1];
+    else if (opt==2) stat->med=(buf[0]>buf[1]) ? buf[0] : buf[1];
+    stat->siqr=0.5*fabs(buf[0]-buf[1]);
+  } else if (isodd(nval)) {
+    stat->med=dselect(sidx,nval,buf);
+    stat->siqr=0.5*(dselect(sidx+i,nval,buf)-dselect(sidx-i,nval,buf));
+  } else {
+    lo=dselect(sidx-1,nval,buf); hi=dselect(sidx,nval,buf);
+    if (opt==0) stat->med=0.5*(lo+hi);
+    else if (opt==1) stat->med=lo;
+    else if (opt==2) stat->med=hi;
+    stat->siqr=0.25*(-dselect(sidx-i-1,nval,buf)-dselect(sidx-i,nval,buf)+
+		     dselect(sidx+i-1,nval,buf)+dselect(sidx+i,nval,buf));
+  }
+
+  return 1;
+
+}
@@ -1,17 +1,26 @@
 /***************************************************************************
-* Send a non-fatal error message to the terminal
+* Send a non-fatal error message to the terminal, keeping a copy of it
+* in nferrlast so that callers may record why an operation failed. The
+* copy is private to each thread, so worker threads may report errors
+* concurrently.
 ***************************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include <stdarg.h>
+#include "error.h"
+
+__thread char nferrlast[NFERRLEN]="\0";
 
 void nferrormsg(char *fmt, ...) {
 
   va_list       args;
+  char          buf[NFERRLEN];
   extern char   *progname;
 
   va_start(args, fmt);
-  fprintf(stderr, "\a%s: ERROR: ", progname);
-  vfprintf(stderr, fmt, args);
-  fprintf(stderr, "\n");
+  vsnprintf(buf, NFERRLEN, fmt, args);
+  va_end(args);
+  fprintf(stderr, "\a%s: ERROR: %s\n", progname, buf);
+  strcpy(nferrlast, buf);
 }
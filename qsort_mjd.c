@@ -1,13 +1,17 @@
 /****************************************************************************
-* Qsort routine to sort headers in order of increasing MJD
+* Qsort routine to sort headers in order of increasing MJD. Headers with
+* the same MJD are sorted by file name so that the order does not depend
+* on the order of the input list (see UVES_hsshard.c)
 ****************************************************************************/
 
+#include <string.h>
 #include "UVES_headsort.h"
 
 int qsort_mjd(const void *hdr1, const void *hdr2) {
 
   if (((header *)hdr1)->mjd > ((header *)hdr2)->mjd) return 1;
-  else if (((header *)hdr1)->mjd == ((header *)hdr2)->mjd) return 0;
+  else if (((header *)hdr1)->mjd == ((header *)hdr2)->mjd)
+    return strcmp(((header *)hdr1)->file,((header *)hdr2)->file);
   else return -1;
 
 }
@@ -57,6 +57,8 @@ int ksprob_2dist(double *data1, unsigned long n1, double *data2,
 int ksprob_2fdist(float *data1, unsigned long n1, float *data2,
 		  unsigned long n2, double *d, double *prob);
 int median(double *dat, int *sts, int ndat, statset *stat, int opt);
+int medianbuf(double *dat, int *sts, int ndat, double *buf, statset *stat,
+	      int opt);
 int medianfilter(double *dat, double *err, int ndat, double medsig,
 		 statset *stat, int *clip, int opt);
 int medianrun(double *dat, double *med, int *sts, int ndat, int nfilt);
@@ -68,6 +70,8 @@ int spearman(double *data1, double *data2, unsigned long n, double *d, double *z
 	     double *probd, double *rs, double *probrs);
 int stats(double *dat, double *sig, double *efl, double *wgt, int *sts, int ndat,
 	  int opt, statset *stat);
+int statsbuf(double *dat, double *sig, double *efl, double *wgt, int *sts,
+	     int ndat, int opt, statset *stat, double *buf);
 int utest(double *data1, unsigned long n1, double *data2, unsigned long n2,
 	  double *U, double *prob);
 int wwruns(double *dat, int *sts, int ndat, statset *stat, double med, int opt1,
@@ -0,0 +1,204 @@
+/****************************************************************************
+STATSBUF: Function to calculate various statistics for given input
+arrays using a scratch buffer provided by the caller
+
+DESCRIPTION: The user must input a data array, dat, of length ndat. All
+other double precision arrays can be left as NULL if the user doesn't
+wish to calculate any weighted quantities. If the status array, sts,
+is not NULL then it should be 1 when the pixel is valid and any other
+quantity when invalid. If it is NULL then all pixels are assumed to be
+valid. If the user enters a non-NULL sigma array, sig, but keeps the
+expected fluctuation array, efl, and weights array, wgt, as NULL then
+weighted quantites are calculated using 1/sigma^2 weighting and
+chisq. is calculated assuming that sigma also estimates the expected
+fluctuations. If the efl or wgt arrays are non-NULL then they are used
+in the appropriate ways. The weighting used is 1/wgt^2 (i.e. the wgt
+array is really the inverse square-root of the weights really used).
+
+This is the same as stats() except that the medians for opt>=2 are
+found with medianbuf() in buf, which must then have at least ndat
+elements. No memory is allocated, so this should be used when
+statistics are found repeatedly in a loop. buf is not used when opt<2
+and may then be NULL.
+
+USAGE: opt = 0 when only the mean, rms, positive and negative rms and
+               error in the mean are to be calculated (i.e. unweighted
+               quantities).
+       opt = 1 when all weighted quantities are to be calculated as well.
+       opt = 2 when the median (and semi-interquartile range) is to be
+               calculated in addition to weighted quantities.
+       opt = 3 when the median sigma is to be calculated in addition
+               to all the above.
+
+All quantities except the positive and negative RMS are accumulated in
+a single pass over the arrays, whatever the value of opt. Sums are taken
+about the first valid data and sigma values, so that the mean, RMS,
+weighted mean and chisquared follow from them without loss of
+precision. Invalid elements are replaced by those reference values
+instead of being branched around, so the loops are free of branches and
+NaNs or zero sigmas in invalid elements do not reach the sums. The
+positive and negative RMS need the mean to divide the data, so a
+second, equally branch-free pass over the data array alone gives them.
+
+****************************************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+#include "stats.h"
+#include "error.h"
+
+/* Accumulate the unweighted sums for element I with validity VALID */
+#define STATSDAT(I,VALID) \
+  v=(VALID); d=(v) ? dat[I]-ref : 0.0; nval+=v; sum+=d; sumsq+=d*d;
+
+/* Accumulate the unweighted and weighted sums for element I with
+   validity VALID. With no expected fluctuation array, chisquared uses
+   the sigma array, whatever the weights */
+#define STATSWGT(I,VALID) \
+  STATSDAT(I,VALID) \
+  ds=(v) ? sig[I]-sref : 0.0; sumsig+=ds; sumsigsq+=ds*ds; \
+  e=(v) ? sig[I] : 1.0; ce=1.0/(e*e); \
+  if (wgt==NULL) w=ce; \
+  else { e=(v) ? wgt[I] : 1.0; w=1.0/(e*e); sumsigonsigsq+=(v) ? sig[I]*sig[I]*w*w : 0.0; } \
+  if (efl!=NULL) { \
+    e=(v) ? efl[I] : 1.0; sumeflonsigsq+=(v) ? e*e*w*w : 0.0; ce=1.0/(e*e); \
+  } \
+  w=(v) ? w : 0.0; ce=(v) ? ce : 0.0; \
+  sum1onsigsq+=w; sumdatonsigsq+=w*d; sumce+=ce; sumced+=ce*d; sumcedsq+=ce*d*d;
+
+int statsbuf(double *dat, double *sig, double *efl, double *wgt, int *sts,
+	     int ndat, int opt, statset *stat, double *buf) {
+
+  double       ref=0.0,sref=0.0,sum=0.0,sumsq=0.0,sumsig=0.0,sumsigsq=0.0;
+  double       sumdatonsigsq=0.0,sumeflonsigsq=0.0,sumsigonsigsq=0.0;
+  double       sum1onsigsq=0.0,sumce=0.0,sumced=0.0,sumcedsq=0.0;
+  double       d=0.0,ds=0.0,e=0.0,w=0.0,ce=0.0,dw=0.0;
+  int          snull=0,wopt=0,nval=0,npos=0,nneg=0,v=0;
+  register int i=0;
+
+  /** Do for all values of opt **/
+  /* Check that data array is usable */
+  if (dat==NULL) { nferrormsg("statsbuf(): Data array passed as NULL"); return 0; }
+
+  /* Is STS to be used? */
+  if (sts==NULL) snull=1;
+
+  /* Are weighted quantities to be calculated? */
+  wopt=(opt && sig!=NULL);
+
+  /* Initialise unweighted and weighted quantities */
+  stat->rms=stat->prms=stat->nrms=stat->mean=stat->emean=0.0;
+  if (opt) {
+    stat->meansig=stat->rmssig=stat->wmean=stat->ewmean=stat->eflwmean=0.0;
+    stat->chisq=stat->rchisq=0.0;
+  }
+
+  /* Reference values about which sums are taken: the first valid data
+     and sigma values */
+  for (i=0; i<ndat; i++) {
+    if (snull || sts[i]==1) { ref=dat[i]; if (wopt) sref=sig[i]; break; }
+  }
+
+  /* Single pass: accumulate the sums for the mean and RMS of the data
+     and, if required, the mean and RMS of the sigma array, the weighted
+     mean, its error and expected fluctuation, and chisquared about the
+     weighted mean */
+  if (!wopt) {
+    if (snull) for (i=0; i<ndat; i++) { STATSDAT(i,1) }
+    else for (i=0; i<ndat; i++) { STATSDAT(i,sts[i]==1) }
+  } else {
+    if (snull) for (i=0; i<ndat; i++) { STATSWGT(i,1) }
+    else for (i=0; i<ndat; i++) { STATSWGT(i,sts[i]==1) }
+  }
+
+  /* Check to make sure we have an non-NULL sig array */
+  if (opt && nval && sig==NULL) {
+    nferrormsg("statsbuf(): Sigma array passed as NULL.\n\
+Must be non-NULL when using opt = %d\t",opt); return 0;
+  }
+
+  if (nval) {
+    /* Mean, RMS and error in mean of data */
+    stat->mean=ref+sum/(double)nval;
+    d=(nval>1) ? (sumsq-sum*sum/(double)nval)/(double)(nval-1) : 0.0;
+    stat->rms=(d>0.0) ? sqrt(d) : 0.0;
+    stat->emean=stat->rms/sqrt((double)nval);
+
+    /* Second pass over the data alone: positive and negative RMS about
+       the mean */
+    if (snull) {
+      for (i=0; i<ndat; i++) {
+	d=dat[i]-stat->mean; v=(d<0.0);
+	nneg+=v; npos+=1-v; stat->nrms+=(v) ? d*d : 0.0;
+	stat->prms+=(v) ? 0.0 : d*d;
+      }
+    } else {
+      for (i=0; i<ndat; i++) {
+	d=(sts[i]==1) ? dat[i]-stat->mean : 0.0; v=(d<0.0);
+	nneg+=v; npos+=(sts[i]==1)-v; stat->nrms+=(v) ? d*d : 0.0;
+	stat->prms+=(v) ? 0.0 : d*d;
+      }
+    }
+    if (!npos) stat->prms=0.0;
+    else if (npos==1) stat->prms=sqrt(stat->prms);
+    else stat->prms=sqrt(stat->prms/((double)(npos-1)));
+    if (!nneg) stat->nrms=0.0;
+    else if (nneg==1) stat->nrms=sqrt(stat->nrms);
+    else stat->nrms=sqrt(stat->nrms/((double)(nneg-1)));
+  }
+
+  /* Calculate mean 1-sigma error and its RMS, weighted mean, error in
+     weighted mean, expected fluctuation in weighted mean and
+     chisquared about the weighted mean */
+  if (wopt && nval) {
+    stat->meansig=sref+sumsig/(double)nval;
+    d=(nval>1) ? (sumsigsq-sumsig*sumsig/(double)nval)/(double)(nval-1) : 0.0;
+    stat->rmssig=(d>0.0) ? sqrt(d) : 0.0;
+    dw=sumdatonsigsq/sum1onsigsq; stat->wmean=ref+dw;
+    stat->ewmean=(wgt==NULL) ? 1.0/sqrt(sum1onsigsq) :
+      sqrt(sumsigonsigsq)/sum1onsigsq;
+    if (efl!=NULL) stat->eflwmean=sqrt(sumeflonsigsq)/sum1onsigsq;
+    stat->chisq=sumcedsq-2.0*dw*sumced+dw*dw*sumce;
+    if (stat->chisq<0.0) stat->chisq=0.0;
+  }
+
+  /* Return if we don't want to calculate weighted quantities */
+  if (!opt) return 1;
+
+  /* Return here if nval is zero */
+  if (!nval && opt==1) return 1;
+  else if (!nval && opt==2) { stat->med=stat->siqr=0.0; return 1; }
+  else if (!nval && opt==3) { stat->med=stat->siqr=stat->emed=0.0; return 1; }
+
+  stat->rchisq=(nval>1) ? stat->chisq/((double)(nval-1)) : 0.0;
+  
+  /* Return here if medians are not required */
+  if (opt==1) return 1;
+
+  /* Check the scratch buffer used for all medians */
+  if (buf==NULL) {
+    nferrormsg("statsbuf(): Scratch buffer passed as NULL.\n\
+Must be non-NULL when using opt = %d\t",opt); return 0;
+  }
+
+  /* Find the median and semi-interquartile range of the data */
+  if (opt==2) {
+    if (!medianbuf(dat,sts,ndat,buf,stat,0)) {
+      nferrormsg("statsbuf(): Error returned from medianbuf()\n\
+\twhen taking median of dat array"); return 0;
+    }
+  } else if (opt==3) {
+    if (!medianbuf(sig,sts,ndat,buf,stat,0)) {
+      nferrormsg("statsbuf(): Error returned from medianbuf()\n\
+\twhen taking median of sig array"); return 0;
+    }
+    stat->emed=stat->med; stat->esiqr=stat->siqr; stat->med=stat->siqr=0.0;
+    if (!medianbuf(dat,sts,ndat,buf,stat,0)) {
+      nferrormsg("statsbuf(): Error returned from medianbuf()\n\
+\twhen taking median of dat array"); return 0;
+    }
+  }
+
+  return 1;
+
+}
@@ -0,0 +1,19 @@
+/****************************************************************************
+* Decide how many worker threads to use for njob jobs. A requested
+* number, nthread, of zero means the number of processors online. The
+* result is at least 1 and at most NTHREADMAX and njob.
+****************************************************************************/
+
+#include <unistd.h>
+#include "thpool.h"
+
+int thnum(int nthread, int njob) {
+
+  if (!nthread && (nthread=(int)sysconf(_SC_NPROCESSORS_ONLN))<1) nthread=1;
+  if (nthread>NTHREADMAX) nthread=NTHREADMAX;
+  if (nthread>njob) nthread=njob;
+  if (nthread<1) nthread=1;
+
+  return nthread;
+
+}
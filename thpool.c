@@ -0,0 +1,64 @@
+/****************************************************************************
+* Run njob jobs, numbered 0 to njob-1, with nthread worker threads. Each
+* worker repeatedly takes the next job from the pool and calls
+* work(arg,k) for it until none are left, so jobs are done in no
+* particular order and work() must only write to the results of job
+* k. With nthread<=1 the jobs are done in order in the calling
+* thread. Use thnum() to choose nthread. If not all workers can be
+* started, those which were do all the jobs between them, or the
+* calling thread does if none were.
+****************************************************************************/
+
+#include <stdlib.h>
+#include "thpool.h"
+#include "error.h"
+
+/* Worker thread: take jobs from the pool until none are left */
+static void *thpool_worker(void *arg) {
+
+  int      k=0;
+  thpool   *pool=(thpool *)arg;
+
+  while (1) {
+    pthread_mutex_lock(&(pool->lock));
+    k=pool->next++;
+    pthread_mutex_unlock(&(pool->lock));
+    if (k>=pool->njob) break;
+    pool->work(pool->arg,k);
+  }
+
+  return NULL;
+
+}
+
+int thpool_run(int nthread, int njob, void (*work)(void *arg, int k),
+	       void *arg) {
+
+  int       nstart=0;
+  register int k=0;
+  pthread_t thread[NTHREADMAX];
+  thpool    pool;
+
+  pool.njob=njob; pool.next=0; pool.work=work; pool.arg=arg;
+  if (nthread>NTHREADMAX) nthread=NTHREADMAX;
+
+  /* Do all jobs in this thread */
+  if (nthread<=1) {
+    for (k=0; k<njob; k++) work(arg,k);
+    return 1;
+  }
+
+  /* Start the workers and wait for them to finish */
+  pthread_mutex_init(&(pool.lock),NULL);
+  for (nstart=0; nstart<nthread; nstart++)
+    if (pthread_create(&(thread[nstart]),NULL,thpool_worker,&pool)) break;
+  if (nstart<nthread)
+    warnmsg("thpool_run(): Cannot create worker thread %d: running %d\n\
+\tjobs with %d thread(s) instead of %d",nstart+1,njob,(nstart) ? nstart : 1,nthread);
+  if (!nstart) thpool_worker(&pool);
+  for (k=0; k<nstart; k++) pthread_join(thread[k],NULL);
+  pthread_mutex_destroy(&(pool.lock));
+
+  return 1;
+
+}
@@ -0,0 +1,23 @@
+/***************************************************************************
+THPOOL.H: Include file for the worker thread pool routines.
+***************************************************************************/
+
+/* INCLUDE FILES */
+#include <pthread.h>
+
+/* DEFINITIONS */
+#define NTHREADMAX 64   /* Maximum number of worker threads                 */
+
+/* STRUCTURES */
+typedef struct ThreadPool {
+  int    njob;          /* Number of jobs */
+  int    next;          /* Next job to be taken by a worker thread */
+  void   (*work)(void *arg, int k); /* Function doing job k */
+  void   *arg;          /* Argument passed to work() */
+  pthread_mutex_t lock; /* Lock protecting next */
+} thpool;
+
+/* PROTOTYPES */
+int thnum(int nthread, int njob);
+int thpool_run(int nthread, int njob, void (*work)(void *arg, int k),
+	       void *arg);